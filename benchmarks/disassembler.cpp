@@ -0,0 +1,73 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/disassembler.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    constexpr std::size_t WORD_COUNT = 1 << 20;
+    constexpr int ROUNDS = 8;
+
+    // Instruction mix of a typical loop body
+    constexpr std::string_view KERNEL = R"(
+        loop:   lw    $t0, 0($a0)
+                addiu $a0, $a0, 4
+                addu  $v0, $v0, $t0
+                sll   $t1, $t0, 2
+                andi  $t1, $t1, 0xff
+                sw    $t1, -4($a1)
+                bnezc $a2, loop
+                jr    $ra
+    )";
+
+    std::vector<uint32_t> kernel_words() {
+        Assembler::LabelTable<4> labels;
+        std::vector<uint32_t> kernel;
+        (void)Assembler::assemble(
+            KERNEL, 0, labels, [&](uint32_t word) { kernel.push_back(word); });
+
+        std::vector<uint32_t> words(WORD_COUNT);
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            words[i] = kernel[i % kernel.size()];
+        }
+        return words;
+    }
+
+    std::vector<uint32_t> random_words() {
+        std::mt19937 rng(1234);
+        std::vector<uint32_t> words(WORD_COUNT);
+        for (uint32_t& word : words) word = rng();
+        return words;
+    }
+
+    void run(const char* name, const std::vector<uint32_t>& words) {
+        char buffer[Disassembler::MAX_TEXT_SIZE];
+        std::size_t characters = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; ++round) {
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                characters += Disassembler::disassemble(
+                    0x400000 + static_cast<uint32_t>(i) * 4, words[i],
+                    {buffer, sizeof(buffer)});
+            }
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        const double instructions = double(words.size()) * ROUNDS;
+        std::printf("%-8s %12.0f instructions/s (%zu characters)\n", name,
+                    instructions / elapsed.count(), characters);
+    }
+} // namespace
+
+int main() {
+    run("kernel", kernel_words());
+    run("random", random_words());
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace mips_emulator;
+
+// Field extraction through the bit field structs and through the shift and
+// mask accessors. Kept out of line so that the generated code can be
+// compared with e.g. objdump -d --no-show-raw-insn.
+[[gnu::noinline]] uint32_t
+sum_bitfield_fields(const std::vector<Instruction>& instructions) {
+    uint32_t sum = 0;
+    for (const Instruction instr : instructions) {
+        sum += instr.general.op + instr.rtype.rs + instr.rtype.rt +
+               instr.rtype.rd + instr.rtype.shamt + instr.rtype.func +
+               instr.itype.imm + instr.longimm_itype.imm + instr.jtype.address;
+    }
+    return sum;
+}
+
+[[gnu::noinline]] uint32_t
+sum_accessor_fields(const std::vector<Instruction>& instructions) {
+    uint32_t sum = 0;
+    for (const Instruction instr : instructions) {
+        sum += instr.get_opcode() + instr.get_rs() + instr.get_rt() +
+               instr.get_rd() + instr.get_shamt() + instr.get_func() +
+               instr.get_imm() + instr.get_long_imm() + instr.get_address();
+    }
+    return sum;
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t WORD_COUNT = 1 << 20;
+    constexpr int ROUNDS = 32;
+
+    template <typename Func>
+    void run_decode(const char* name, const std::vector<Instruction>& words,
+                    Func&& sum_fields) {
+        uint32_t sum = 0;
+        const auto start = Clock::now();
+        for (int round = 0; round < ROUNDS; ++round) sum += sum_fields(words);
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        const double count = double(words.size()) * ROUNDS;
+        std::printf("%-10s %8.1f M instructions/s (sum %08x)\n", name,
+                    count / elapsed.count() / 1e6, sum);
+    }
+
+    // Counts down from a0, mixing ALU, shift, memory and branch instructions
+    constexpr std::string_view KERNEL = R"(
+        loop:   addiu $a0, $a0, -1
+                sll   $t1, $a0, 2
+                andi  $t1, $t1, 0xfc
+                addu  $t2, $t2, $t1
+                sw    $t2, 0x100($t1)
+                lw    $t3, 0x100($t1)
+                xor   $t4, $t3, $a0
+                ext   $t5, $t4, 3, 8
+                bnezc $a0, loop
+        done:   bc    done
+    )";
+
+    void run_executor() {
+        StaticMemory<0x1000> memory;
+        Assembler::LabelMap labels;
+        (void)Assembler::assemble_into(memory, KERNEL, 0, labels);
+
+        uint32_t done = 0;
+        labels.find("done", done);
+
+        RegisterFile reg_file;
+        reg_file.set_unsigned(RegisterName::e_a0, 1 << 22);
+
+        uint64_t count = 0;
+        const auto start = Clock::now();
+        while (reg_file.get_pc() != done) {
+            if (!Executor::step(reg_file, memory)) break;
+            ++count;
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        std::printf("%-10s %8.1f M instructions/s\n", "executor",
+                    double(count) / elapsed.count() / 1e6);
+    }
+} // namespace
+
+int main() {
+    std::mt19937 rng(1234);
+    std::vector<Instruction> words;
+    words.reserve(WORD_COUNT);
+    for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+        words.emplace_back(static_cast<uint32_t>(rng()));
+    }
+
+    run_decode("bitfields", words, sum_bitfield_fields);
+    run_decode("accessors", words, sum_accessor_fields);
+    run_executor();
+    return 0;
+}
@@ -0,0 +1,1184 @@
+#pragma once
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/result.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mips_emulator {
+    enum class AssemblerError : uint8_t {
+        unknown_mnemonic,
+        invalid_operand,
+        invalid_register,
+        undefined_label,
+        duplicate_label,
+        too_many_labels,
+        out_of_range,
+        unaligned_target,
+        write_failed,
+    };
+
+    struct AssemblyError {
+        AssemblerError error;
+        // 1 based source line
+        uint32_t line;
+    };
+
+    // Assembler for the subset of MIPS32r6 implemented by the executor.
+    //
+    // One statement per line, '#' starts a comment. Lines may start with
+    // any number of "label:" definitions. Registers are written $0-$31 or by
+    // name ($t0, $sp, ...), immediates in decimal or 0x hex, memory operands
+    // as offset($base). Immediates may also be %hi(x) or %lo(x) of a label
+    // or number. Branch and jump targets are labels or absolute addresses.
+    // The .word directive emits up to four values or label addresses,
+    // .space n emits n zero bytes.
+    //
+    // Everything is constexpr so firmware can be assembled and pre-decoded
+    // at compile time, see assemble_firmware. assemble_into is the runtime
+    // counterpart for programs built on the fly, such as benchmark kernels.
+    namespace Assembler {
+        using Func = Instruction::Func;
+        using IOp = Instruction::ITypeOpcode;
+        using JOp = Instruction::JTypeOpcode;
+
+        constexpr uint32_t rtype(const Func func, const uint8_t rd,
+                                 const uint8_t rs, const uint8_t rt,
+                                 const uint8_t shamt = 0) {
+            return (uint32_t(rs & 31) << 21) | (uint32_t(rt & 31) << 16) |
+                   (uint32_t(rd & 31) << 11) | (uint32_t(shamt & 31) << 6) |
+                   static_cast<uint8_t>(func);
+        }
+
+        constexpr uint32_t itype(const IOp op, const uint8_t rt,
+                                 const uint8_t rs, const uint16_t imm) {
+            return (uint32_t(static_cast<uint8_t>(op)) << 26) |
+                   (uint32_t(rs & 31) << 21) | (uint32_t(rt & 31) << 16) |
+                   imm;
+        }
+
+        constexpr uint32_t longimm_itype(const IOp op, const uint8_t rs,
+                                         const uint32_t imm) {
+            return (uint32_t(static_cast<uint8_t>(op)) << 26) |
+                   (uint32_t(rs & 31) << 21) | (imm & 0x1fffff);
+        }
+
+        constexpr uint32_t jtype(const JOp op, const uint32_t address) {
+            return (uint32_t(static_cast<uint8_t>(op)) << 26) |
+                   (address & 0x3ffffff);
+        }
+
+        constexpr uint32_t regimm_itype(const Instruction::RegimmITypeOp op,
+                                        const uint8_t rs, const uint16_t imm) {
+            return (uint32_t(Instruction::REGIMM_OPCODE) << 26) |
+                   (uint32_t(rs & 31) << 21) |
+                   (uint32_t(static_cast<uint8_t>(op)) << 16) | imm;
+        }
+
+        constexpr uint32_t special3(const Instruction::Special3Func func,
+                                    const uint8_t extra, const uint8_t rd,
+                                    const uint8_t rs, const uint8_t rt) {
+            return (uint32_t(Instruction::SPECIAL3_OPCODE) << 26) |
+                   (uint32_t(rs & 31) << 21) | (uint32_t(rt & 31) << 16) |
+                   (uint32_t(rd & 31) << 11) | (uint32_t(extra & 31) << 6) |
+                   static_cast<uint8_t>(func);
+        }
+
+        constexpr uint32_t pcrel_type1(const uint8_t rs,
+                                       const Instruction::PCRelFunc1 func,
+                                       const uint32_t imm) {
+            return (uint32_t(Instruction::PCREL_OPCODE) << 26) |
+                   (uint32_t(rs & 31) << 21) |
+                   (uint32_t(static_cast<uint8_t>(func)) << 19) |
+                   (imm & 0x7ffff);
+        }
+
+        constexpr uint32_t pcrel_type2(const uint8_t rs,
+                                       const Instruction::PCRelFunc2 func,
+                                       const uint16_t imm) {
+            return (uint32_t(Instruction::PCREL_OPCODE) << 26) |
+                   (uint32_t(rs & 31) << 21) |
+                   (uint32_t(static_cast<uint8_t>(func)) << 16) | imm;
+        }
+
+        // Operand layouts
+        enum class Format : uint8_t {
+            e_rd_rs_rt,
+            e_rd_rt_rs,
+            e_rd_rt_sa,
+            e_rd_rs,
+            e_rs,
+            e_rs_hb,
+            e_rs_rt,
+            // Sign extended immediates
+            e_rt_rs_imm,
+            e_rt_imm,
+            // Zero extended or upper immediates
+            e_rt_rs_uimm,
+            e_rt_uimm,
+            e_rt_mem,
+            e_mem,
+            e_rs_rt_target,
+            e_rs_target,
+            e_regimm,
+            e_rt_target_rs0,
+            e_rt_target_rsrt,
+            e_rs_rt_target_compact,
+            e_rs_rt_target_ordered,
+            e_rs_rt_target_overflow,
+            e_rs_target21,
+            e_target_jump,
+            e_target26,
+            e_pop_rt_imm,
+            e_pcrel1,
+            e_pcrel2,
+            e_bshfl,
+            e_align,
+            e_ext,
+            e_ins,
+            e_cache,
+            e_none,
+            e_word,
+            e_space,
+        };
+
+        struct Mnemonic {
+            std::string_view name;
+            Format format;
+            // Opcode or function depending on the format
+            uint8_t code;
+            // Fixed field, shamt for R-Type, rt for regimm, etc
+            uint8_t extra;
+        };
+
+        constexpr uint8_t op(const IOp value) {
+            return static_cast<uint8_t>(value);
+        }
+        constexpr uint8_t op(const Func value) {
+            return static_cast<uint8_t>(value);
+        }
+        constexpr uint8_t op(const JOp value) {
+            return static_cast<uint8_t>(value);
+        }
+
+        constexpr Mnemonic MNEMONICS[] = {
+            // Aliases come before the instructions they alias so that the
+            // disassembler prefers them
+
+            // R-Type
+            {"nop", Format::e_none, op(Func::e_sll), 0},
+            {"move", Format::e_rd_rs, op(Func::e_or), 0},
+            {"add", Format::e_rd_rs_rt, op(Func::e_add), 0},
+            {"addu", Format::e_rd_rs_rt, op(Func::e_addu), 0},
+            {"sub", Format::e_rd_rs_rt, op(Func::e_sub), 0},
+            {"subu", Format::e_rd_rs_rt, op(Func::e_subu), 0},
+            {"mul", Format::e_rd_rs_rt, op(Func::e_sop30), 2},
+            {"muh", Format::e_rd_rs_rt, op(Func::e_sop30), 3},
+            {"mulu", Format::e_rd_rs_rt, op(Func::e_sop31), 2},
+            {"muhu", Format::e_rd_rs_rt, op(Func::e_sop31), 3},
+            {"div", Format::e_rd_rs_rt, op(Func::e_sop32), 2},
+            {"mod", Format::e_rd_rs_rt, op(Func::e_sop32), 3},
+            {"divu", Format::e_rd_rs_rt, op(Func::e_sop33), 2},
+            {"modu", Format::e_rd_rs_rt, op(Func::e_sop33), 3},
+            {"and", Format::e_rd_rs_rt, op(Func::e_and), 0},
+            {"or", Format::e_rd_rs_rt, op(Func::e_or), 0},
+            {"xor", Format::e_rd_rs_rt, op(Func::e_xor), 0},
+            {"nor", Format::e_rd_rs_rt, op(Func::e_nor), 0},
+            {"slt", Format::e_rd_rs_rt, op(Func::e_slt), 0},
+            {"sltu", Format::e_rd_rs_rt, op(Func::e_sltu), 0},
+            {"seleqz", Format::e_rd_rs_rt, op(Func::e_seleqz), 0},
+            {"selnez", Format::e_rd_rs_rt, op(Func::e_selnez), 0},
+            {"sllv", Format::e_rd_rt_rs, op(Func::e_sllv), 0},
+            {"srlv", Format::e_rd_rt_rs, op(Func::e_srlv), 0},
+            {"rotrv", Format::e_rd_rt_rs, op(Func::e_srlv), 1},
+            {"srav", Format::e_rd_rt_rs, op(Func::e_srav), 0},
+            {"sll", Format::e_rd_rt_sa, op(Func::e_sll), 0},
+            {"srl", Format::e_rd_rt_sa, op(Func::e_srl), 0},
+            {"rotr", Format::e_rd_rt_sa, op(Func::e_srl), 1},
+            {"sra", Format::e_rd_rt_sa, op(Func::e_sra), 0},
+            {"clz", Format::e_rd_rs, op(Func::e_clz), 1},
+            {"clo", Format::e_rd_rs, op(Func::e_clo), 1},
+            {"jr", Format::e_rs, op(Func::e_jr), 0},
+            {"jalr", Format::e_rs, op(Func::e_jalr), 31},
+            {"jr.hb", Format::e_rs_hb, op(Func::e_jr), 0},
+            {"jalr.hb", Format::e_rs_hb, op(Func::e_jalr), 31},
+            {"teq", Format::e_rs_rt, op(Func::e_teq), 0},
+            {"tge", Format::e_rs_rt, op(Func::e_tge), 0},
+            {"tgeu", Format::e_rs_rt, op(Func::e_tgeu), 0},
+            {"tlt", Format::e_rs_rt, op(Func::e_tlt), 0},
+            {"tltu", Format::e_rs_rt, op(Func::e_tltu), 0},
+            {"tne", Format::e_rs_rt, op(Func::e_tne), 0},
+
+            // I-Type
+            {"lui", Format::e_rt_uimm, op(IOp::e_aui), 0},
+            {"li", Format::e_rt_imm, op(IOp::e_addiu), 0},
+            {"addiu", Format::e_rt_rs_imm, op(IOp::e_addiu), 0},
+            {"slti", Format::e_rt_rs_imm, op(IOp::e_slti), 0},
+            {"sltiu", Format::e_rt_rs_imm, op(IOp::e_sltiu), 0},
+            {"andi", Format::e_rt_rs_uimm, op(IOp::e_andi), 0},
+            {"ori", Format::e_rt_rs_uimm, op(IOp::e_ori), 0},
+            {"xori", Format::e_rt_rs_uimm, op(IOp::e_xori), 0},
+            {"aui", Format::e_rt_rs_uimm, op(IOp::e_aui), 0},
+            {"lb", Format::e_rt_mem, op(IOp::e_lb), 0},
+            {"lbu", Format::e_rt_mem, op(IOp::e_lbu), 0},
+            {"lh", Format::e_rt_mem, op(IOp::e_lh), 0},
+            {"lhu", Format::e_rt_mem, op(IOp::e_lhu), 0},
+            {"lw", Format::e_rt_mem, op(IOp::e_lw), 0},
+            {"sb", Format::e_rt_mem, op(IOp::e_sb), 0},
+            {"sh", Format::e_rt_mem, op(IOp::e_sh), 0},
+            {"sw", Format::e_rt_mem, op(IOp::e_sw), 0},
+
+            // Branches with delay slots
+            {"beq", Format::e_rs_rt_target, op(IOp::e_beq), 0},
+            {"bne", Format::e_rs_rt_target, op(IOp::e_bne), 0},
+            {"blez", Format::e_rs_target, op(IOp::e_pop06), 0},
+            {"bgtz", Format::e_rs_target, op(IOp::e_pop07), 0},
+            {"bgez", Format::e_regimm, 0,
+             static_cast<uint8_t>(Instruction::RegimmITypeOp::e_bgez)},
+            {"bltz", Format::e_regimm, 0,
+             static_cast<uint8_t>(Instruction::RegimmITypeOp::e_bltz)},
+            {"j", Format::e_target_jump, op(JOp::e_j), 0},
+            {"jal", Format::e_target_jump, op(JOp::e_jal), 0},
+
+            // Compact branches
+            {"blezalc", Format::e_rt_target_rs0, op(IOp::e_pop06), 0},
+            {"bgezalc", Format::e_rt_target_rsrt, op(IOp::e_pop06), 0},
+            {"bgeuc", Format::e_rs_rt_target_compact, op(IOp::e_pop06), 0},
+            {"bgtzalc", Format::e_rt_target_rs0, op(IOp::e_pop07), 0},
+            {"bltzalc", Format::e_rt_target_rsrt, op(IOp::e_pop07), 0},
+            {"bltuc", Format::e_rs_rt_target_compact, op(IOp::e_pop07), 0},
+            {"beqzalc", Format::e_rt_target_rs0, op(IOp::e_pop10), 0},
+            {"beqc", Format::e_rs_rt_target_ordered, op(IOp::e_pop10), 0},
+            {"bovc", Format::e_rs_rt_target_overflow, op(IOp::e_pop10), 0},
+            {"bnezalc", Format::e_rt_target_rs0, op(IOp::e_pop30), 0},
+            {"bnec", Format::e_rs_rt_target_ordered, op(IOp::e_pop30), 0},
+            {"bnvc", Format::e_rs_rt_target_overflow, op(IOp::e_pop30), 0},
+            {"blezc", Format::e_rt_target_rs0, op(IOp::e_pop26), 0},
+            {"bgezc", Format::e_rt_target_rsrt, op(IOp::e_pop26), 0},
+            {"bgec", Format::e_rs_rt_target_compact, op(IOp::e_pop26), 0},
+            {"bgtzc", Format::e_rt_target_rs0, op(IOp::e_pop27), 0},
+            {"bltzc", Format::e_rt_target_rsrt, op(IOp::e_pop27), 0},
+            {"bltc", Format::e_rs_rt_target_compact, op(IOp::e_pop27), 0},
+            {"beqzc", Format::e_rs_target21, op(IOp::e_pop66), 0},
+            {"bnezc", Format::e_rs_target21, op(IOp::e_pop76), 0},
+            {"jic", Format::e_pop_rt_imm, op(IOp::e_pop66), 0},
+            {"jialc", Format::e_pop_rt_imm, op(IOp::e_pop76), 0},
+            {"bc", Format::e_target26, op(JOp::e_bc), 0},
+            {"balc", Format::e_target26, op(JOp::e_balc), 0},
+
+            // PC relative
+            {"addiupc", Format::e_pcrel1,
+             static_cast<uint8_t>(Instruction::PCRelFunc1::e_addiupc), 0},
+            {"lwpc", Format::e_pcrel1,
+             static_cast<uint8_t>(Instruction::PCRelFunc1::e_lwpc), 0},
+            {"auipc", Format::e_pcrel2,
+             static_cast<uint8_t>(Instruction::PCRelFunc2::e_auipc), 0},
+            {"aluipc", Format::e_pcrel2,
+             static_cast<uint8_t>(Instruction::PCRelFunc2::e_aluipc), 0},
+
+            // Special3
+            {"bitswap", Format::e_bshfl,
+             static_cast<uint8_t>(Instruction::Special3BSHFLFunc::e_bitswap),
+             0},
+            {"wsbh", Format::e_bshfl,
+             static_cast<uint8_t>(Instruction::Special3BSHFLFunc::e_wsbh), 0},
+            {"seb", Format::e_bshfl,
+             static_cast<uint8_t>(Instruction::Special3BSHFLFunc::e_seb), 0},
+            {"seh", Format::e_bshfl,
+             static_cast<uint8_t>(Instruction::Special3BSHFLFunc::e_seh), 0},
+            {"align", Format::e_align,
+             static_cast<uint8_t>(Instruction::Special3BSHFLFunc::e_align_0),
+             0},
+            {"ext", Format::e_ext, 0, 0},
+            {"ins", Format::e_ins, 0, 0},
+
+            // Cache maintenance
+            {"synci", Format::e_mem, 0,
+             static_cast<uint8_t>(Instruction::RegimmITypeOp::e_synci)},
+            {"cache", Format::e_cache, 0, 0},
+
+            // Directives
+            {".word", Format::e_word, 0, 0},
+            {".space", Format::e_space, 0, 0},
+        };
+
+        constexpr std::string_view REGISTER_NAMES[] = {
+            "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+            "t0",   "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+            "s0",   "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+            "t8",   "t9", "k0", "k1", "gp", "sp", "fp", "ra",
+        };
+
+        // Labels known to a single assembly, with a fixed capacity so that it
+        // can be used in constant expressions
+        template <std::size_t capacity>
+        class LabelTable {
+        public:
+            constexpr bool add(const std::string_view name,
+                               const uint32_t address) {
+                if (count == capacity) return false;
+                names[count] = name;
+                addresses[count] = address;
+                ++count;
+                return true;
+            }
+
+            constexpr bool find(const std::string_view name,
+                                uint32_t& address) const {
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (names[i] == name) {
+                        address = addresses[i];
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            constexpr std::size_t get_size() const noexcept { return count; }
+
+        private:
+            std::array<std::string_view, capacity> names = {};
+            std::array<uint32_t, capacity> addresses = {};
+            std::size_t count = 0;
+        };
+
+        constexpr bool is_space(const char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        constexpr std::string_view trim(std::string_view text) {
+            while (!text.empty() && is_space(text.front())) {
+                text.remove_prefix(1);
+            }
+            while (!text.empty() && is_space(text.back())) {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
+
+        constexpr bool is_identifier(const std::string_view text) {
+            if (text.empty() || (text[0] >= '0' && text[0] <= '9')) {
+                return false;
+            }
+            for (const char c : text) {
+                const bool valid = (c >= 'a' && c <= 'z') ||
+                                   (c >= 'A' && c <= 'Z') ||
+                                   (c >= '0' && c <= '9') || c == '_' ||
+                                   c == '.';
+                if (!valid) return false;
+            }
+            return true;
+        }
+
+        constexpr bool parse_number(std::string_view text, int64_t& value) {
+            text = trim(text);
+            bool negative = false;
+            if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+                negative = text[0] == '-';
+                text.remove_prefix(1);
+            }
+
+            uint32_t base = 10;
+            if (text.size() > 2 && text[0] == '0' &&
+                (text[1] == 'x' || text[1] == 'X')) {
+                base = 16;
+                text.remove_prefix(2);
+            }
+            if (text.empty()) return false;
+
+            int64_t result = 0;
+            for (const char c : text) {
+                uint32_t digit = 0;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                }
+                else if (base == 16 && c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                }
+                else if (base == 16 && c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                }
+                else {
+                    return false;
+                }
+                if (digit >= base) return false;
+
+                result = result * base + digit;
+                if (result > 0xffffffff) return false;
+            }
+
+            value = negative ? -result : result;
+            return true;
+        }
+
+        constexpr bool parse_register(std::string_view text, uint8_t& reg) {
+            text = trim(text);
+            if (text.size() < 2 || text[0] != '$') return false;
+            text.remove_prefix(1);
+
+            int64_t index = 0;
+            if (parse_number(text, index)) {
+                if (index < 0 || index > 31) return false;
+                reg = static_cast<uint8_t>(index);
+                return true;
+            }
+
+            if (text == "s8") text = "fp";
+            for (uint8_t i = 0; i < 32; ++i) {
+                if (REGISTER_NAMES[i] == text) {
+                    reg = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        constexpr const Mnemonic* find_mnemonic(const std::string_view name) {
+            for (const Mnemonic& mnemonic : MNEMONICS) {
+                if (mnemonic.name == name) return &mnemonic;
+            }
+            return nullptr;
+        }
+
+        // A source line split into its parts
+        struct Statement {
+            std::string_view labels;
+            std::string_view mnemonic;
+            std::array<std::string_view, 4> operands = {};
+            std::size_t operand_count = 0;
+            bool too_many_operands = false;
+        };
+
+        constexpr Statement parse_statement(std::string_view line) {
+            Statement statement;
+
+            const std::size_t comment = line.find('#');
+            if (comment != std::string_view::npos) {
+                line = line.substr(0, comment);
+            }
+            line = trim(line);
+
+            // Leading labels are kept together and split by the caller
+            std::size_t labels_end = 0;
+            for (std::size_t colon = line.find(':');
+                 colon != std::string_view::npos;
+                 colon = line.find(':', labels_end)) {
+                if (!is_identifier(
+                        trim(line.substr(labels_end, colon - labels_end)))) {
+                    break;
+                }
+                labels_end = colon + 1;
+            }
+            statement.labels = line.substr(0, labels_end);
+            line = trim(line.substr(labels_end));
+            if (line.empty()) return statement;
+
+            std::size_t name_end = 0;
+            while (name_end < line.size() && !is_space(line[name_end])) {
+                ++name_end;
+            }
+            statement.mnemonic = line.substr(0, name_end);
+
+            std::string_view operands = trim(line.substr(name_end));
+            while (!operands.empty()) {
+                if (statement.operand_count == statement.operands.size()) {
+                    statement.too_many_operands = true;
+                    break;
+                }
+
+                const std::size_t comma = operands.find(',');
+                statement.operands[statement.operand_count++] =
+                    trim(operands.substr(0, comma));
+                if (comma == std::string_view::npos) break;
+                operands.remove_prefix(comma + 1);
+            }
+
+            return statement;
+        }
+
+        constexpr uint32_t operand_count(const Format format) {
+            switch (format) {
+                case Format::e_none: return 0;
+                case Format::e_rs:
+                case Format::e_rs_hb:
+                case Format::e_mem:
+                case Format::e_target_jump:
+                case Format::e_target26:
+                case Format::e_word:
+                case Format::e_space: return 1;
+                case Format::e_rd_rs:
+                case Format::e_rs_rt:
+                case Format::e_rt_imm:
+                case Format::e_rt_uimm:
+                case Format::e_rt_mem:
+                case Format::e_rs_target:
+                case Format::e_regimm:
+                case Format::e_rt_target_rs0:
+                case Format::e_rt_target_rsrt:
+                case Format::e_rs_target21:
+                case Format::e_pop_rt_imm:
+                case Format::e_pcrel1:
+                case Format::e_pcrel2:
+                case Format::e_bshfl:
+                case Format::e_cache: return 2;
+                case Format::e_rd_rs_rt:
+                case Format::e_rd_rt_rs:
+                case Format::e_rd_rt_sa:
+                case Format::e_rt_rs_imm:
+                case Format::e_rt_rs_uimm:
+                case Format::e_rs_rt_target:
+                case Format::e_rs_rt_target_compact:
+                case Format::e_rs_rt_target_ordered:
+                case Format::e_rs_rt_target_overflow: return 3;
+                case Format::e_align:
+                case Format::e_ext:
+                case Format::e_ins: return 4;
+            }
+            return 0;
+        }
+
+        // Value of a .word operand, a number or a label's address
+        template <typename Labels>
+        constexpr Result<uint32_t, AssemblerError>
+        word_value(const std::string_view operand, const Labels& labels) {
+            int64_t value = 0;
+            if (parse_number(operand, value)) {
+                if (value < -0x80000000ll || value > 0xffffffffll) {
+                    return AssemblerError::out_of_range;
+                }
+                return static_cast<uint32_t>(value);
+            }
+
+            uint32_t address = 0;
+            if (!labels.find(operand, address)) {
+                return AssemblerError::undefined_label;
+            }
+            return address;
+        }
+
+        // Immediate operand, a number or the %hi/%lo half of a .word value.
+        // %hi is adjusted for the sign extension of %lo so that
+        // "lui $t0, %hi(x)" followed by "addiu $t0, $t0, %lo(x)" yields x.
+        template <typename Labels>
+        constexpr Result<int64_t, AssemblerError>
+        parse_immediate(std::string_view text, const Labels& labels) {
+            text = trim(text);
+
+            int64_t value = 0;
+            if (parse_number(text, value)) return value;
+
+            const std::string_view prefix = text.substr(0, 4);
+            const bool high = prefix == "%hi(";
+            if ((!high && prefix != "%lo(") || text.back() != ')') {
+                return AssemblerError::invalid_operand;
+            }
+
+            const auto word =
+                word_value(trim(text.substr(4, text.size() - 5)), labels);
+            if (word.is_error()) return word.get_error();
+
+            const uint32_t address = word.get_value();
+            if (high) return int64_t(((address + 0x8000) >> 16) & 0xffff);
+            return int64_t(static_cast<int16_t>(address & 0xffff));
+        }
+
+        // Encodes a single statement located at address
+        template <typename Labels>
+        constexpr Result<uint32_t, AssemblerError>
+        encode(const Mnemonic& mnemonic, const Statement& statement,
+               const uint32_t address, const Labels& labels) {
+            using E = AssemblerError;
+
+            const auto& operands = statement.operands;
+            if (statement.too_many_operands ||
+                statement.operand_count != operand_count(mnemonic.format)) {
+                return E::invalid_operand;
+            }
+
+            std::array<uint8_t, 4> regs = {};
+            const auto reg = [&](const std::size_t i) {
+                return parse_register(operands[i], regs[i]);
+            };
+
+            int64_t imm = 0;
+            const auto number = [&](const std::size_t i, const int64_t min,
+                                    const int64_t max) -> Result<bool, E> {
+                const auto value = parse_immediate(operands[i], labels);
+                if (value.is_error()) return value.get_error();
+                imm = value.get_value();
+                if (imm < min || imm > max) return E::out_of_range;
+                return true;
+            };
+
+            // offset($base), the offset may be omitted
+            uint8_t base = 0;
+            const auto memory = [&](const std::size_t i, const int64_t min,
+                                    const int64_t max) -> Result<bool, E> {
+                const std::string_view operand = operands[i];
+                const std::size_t open = operand.rfind('(');
+                if (open == std::string_view::npos || operand.back() != ')') {
+                    return E::invalid_operand;
+                }
+
+                const std::string_view base_name =
+                    operand.substr(open + 1, operand.size() - open - 2);
+                if (!parse_register(base_name, base)) {
+                    return E::invalid_register;
+                }
+
+                const std::string_view displacement =
+                    trim(operand.substr(0, open));
+                if (!displacement.empty()) {
+                    const auto value = parse_immediate(displacement, labels);
+                    if (value.is_error()) return value.get_error();
+                    imm = value.get_value();
+                    if (imm < min || imm > max) return E::out_of_range;
+                }
+                return true;
+            };
+
+            // Labels or absolute addresses
+            uint32_t target = 0;
+            const auto resolve = [&](const std::size_t i) -> Result<bool, E> {
+                int64_t value = 0;
+                if (parse_number(operands[i], value)) {
+                    target = static_cast<uint32_t>(value);
+                }
+                else if (!labels.find(operands[i], target)) {
+                    return E::undefined_label;
+                }
+                if (target & 3) return E::unaligned_target;
+                return true;
+            };
+
+            // Word offset from the instruction after the branch
+            const auto offset = [&](const std::size_t i,
+                                    const uint32_t bits) -> Result<bool, E> {
+                const auto resolved = resolve(i);
+                if (resolved.is_error()) return resolved.get_error();
+
+                const int64_t words =
+                    (static_cast<int64_t>(target) - (int64_t(address) + 4)) /
+                    4;
+                const int64_t limit = int64_t(1) << (bits - 1);
+                if (words < -limit || words >= limit) return E::out_of_range;
+
+                imm = words & ((int64_t(1) << bits) - 1);
+                return true;
+            };
+
+            const Func func = static_cast<Func>(mnemonic.code);
+            const IOp iop = static_cast<IOp>(mnemonic.code);
+
+            switch (mnemonic.format) {
+                case Format::e_none: return rtype(func, 0, 0, 0, 0);
+
+                case Format::e_rd_rs_rt: {
+                    if (!reg(0) || !reg(1) || !reg(2)) {
+                        return E::invalid_register;
+                    }
+                    return rtype(func, regs[0], regs[1], regs[2],
+                                 mnemonic.extra);
+                }
+                case Format::e_rd_rt_rs: {
+                    if (!reg(0) || !reg(1) || !reg(2)) {
+                        return E::invalid_register;
+                    }
+                    return rtype(func, regs[0], regs[2], regs[1],
+                                 mnemonic.extra);
+                }
+                case Format::e_rd_rt_sa: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    const auto checked = number(2, 0, 31);
+                    if (checked.is_error()) return checked.get_error();
+                    return rtype(func, regs[0], mnemonic.extra, regs[1],
+                                 static_cast<uint8_t>(imm));
+                }
+                case Format::e_rd_rs: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    return rtype(func, regs[0], regs[1], 0, mnemonic.extra);
+                }
+                case Format::e_rs: {
+                    if (!reg(0)) return E::invalid_register;
+                    return rtype(func, mnemonic.extra, regs[0], 0);
+                }
+                case Format::e_rs_hb: {
+                    if (!reg(0)) return E::invalid_register;
+                    return rtype(func, mnemonic.extra, regs[0], 0,
+                                 Instruction::HAZARD_BARRIER_HINT);
+                }
+                case Format::e_rs_rt: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    return rtype(func, 0, regs[0], regs[1]);
+                }
+
+                case Format::e_rt_rs_imm:
+                case Format::e_rt_rs_uimm: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    const auto checked =
+                        mnemonic.format == Format::e_rt_rs_imm
+                            ? number(2, -0x8000, 0x7fff)
+                            : number(2, 0, 0xffff);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, regs[0], regs[1],
+                                 static_cast<uint16_t>(imm));
+                }
+                case Format::e_rt_imm:
+                case Format::e_rt_uimm: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = mnemonic.format == Format::e_rt_imm
+                                             ? number(1, -0x8000, 0x7fff)
+                                             : number(1, 0, 0xffff);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, regs[0], 0, static_cast<uint16_t>(imm));
+                }
+                case Format::e_rt_mem: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = memory(1, -0x8000, 0x7fff);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, regs[0], base,
+                                 static_cast<uint16_t>(imm));
+                }
+                case Format::e_mem: {
+                    const auto checked = memory(0, -0x8000, 0x7fff);
+                    if (checked.is_error()) return checked.get_error();
+                    return regimm_itype(
+                        static_cast<Instruction::RegimmITypeOp>(mnemonic.extra),
+                        base, static_cast<uint16_t>(imm));
+                }
+
+                case Format::e_rs_rt_target: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    const auto checked = offset(2, 16);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, regs[1], regs[0],
+                                 static_cast<uint16_t>(imm));
+                }
+                case Format::e_rs_target: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = offset(1, 16);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, 0, regs[0], static_cast<uint16_t>(imm));
+                }
+                case Format::e_regimm: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = offset(1, 16);
+                    if (checked.is_error()) return checked.get_error();
+                    return regimm_itype(
+                        static_cast<Instruction::RegimmITypeOp>(mnemonic.extra),
+                        regs[0], static_cast<uint16_t>(imm));
+                }
+
+                // The compact branches share opcodes and are told apart by
+                // which registers are zero or equal
+                case Format::e_rt_target_rs0:
+                case Format::e_rt_target_rsrt: {
+                    if (!reg(0)) return E::invalid_register;
+                    if (regs[0] == 0) return E::invalid_register;
+                    const auto checked = offset(1, 16);
+                    if (checked.is_error()) return checked.get_error();
+
+                    const uint8_t rs =
+                        mnemonic.format == Format::e_rt_target_rs0 ? 0
+                                                                   : regs[0];
+                    return itype(iop, regs[0], rs, static_cast<uint16_t>(imm));
+                }
+                case Format::e_rs_rt_target_compact:
+                case Format::e_rs_rt_target_ordered:
+                case Format::e_rs_rt_target_overflow: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    uint8_t rs = regs[0];
+                    uint8_t rt = regs[1];
+
+                    if (mnemonic.format == Format::e_rs_rt_target_overflow) {
+                        // Commutative, encoded with rs >= rt
+                        if (rs < rt) {
+                            rs = regs[1];
+                            rt = regs[0];
+                        }
+                    }
+                    else {
+                        if (rs == 0 || rt == 0 || rs == rt) {
+                            return E::invalid_register;
+                        }
+                        // Commutative, encoded with rs < rt
+                        if (mnemonic.format ==
+                                Format::e_rs_rt_target_ordered &&
+                            rs > rt) {
+                            rs = regs[1];
+                            rt = regs[0];
+                        }
+                    }
+
+                    const auto checked = offset(2, 16);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, rt, rs, static_cast<uint16_t>(imm));
+                }
+                case Format::e_rs_target21: {
+                    if (!reg(0)) return E::invalid_register;
+                    if (regs[0] == 0) return E::invalid_register;
+                    const auto checked = offset(1, 21);
+                    if (checked.is_error()) return checked.get_error();
+                    return longimm_itype(iop, regs[0],
+                                         static_cast<uint32_t>(imm));
+                }
+                case Format::e_pop_rt_imm: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = number(1, -0x8000, 0xffff);
+                    if (checked.is_error()) return checked.get_error();
+                    return itype(iop, regs[0], 0, static_cast<uint16_t>(imm));
+                }
+
+                case Format::e_target_jump: {
+                    const auto resolved = resolve(0);
+                    if (resolved.is_error()) return resolved.get_error();
+                    if (((address + 4) ^ target) & 0xf0000000) {
+                        return E::out_of_range;
+                    }
+                    return jtype(static_cast<JOp>(mnemonic.code), target >> 2);
+                }
+                case Format::e_target26: {
+                    const auto checked = offset(0, 26);
+                    if (checked.is_error()) return checked.get_error();
+                    return jtype(static_cast<JOp>(mnemonic.code),
+                                 static_cast<uint32_t>(imm));
+                }
+
+                case Format::e_pcrel1: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = number(1, -0x40000, 0x7ffff);
+                    if (checked.is_error()) return checked.get_error();
+                    return pcrel_type1(
+                        regs[0],
+                        static_cast<Instruction::PCRelFunc1>(mnemonic.code),
+                        static_cast<uint32_t>(imm));
+                }
+                case Format::e_pcrel2: {
+                    if (!reg(0)) return E::invalid_register;
+                    const auto checked = number(1, -0x8000, 0xffff);
+                    if (checked.is_error()) return checked.get_error();
+                    return pcrel_type2(
+                        regs[0],
+                        static_cast<Instruction::PCRelFunc2>(mnemonic.code),
+                        static_cast<uint16_t>(imm));
+                }
+
+                case Format::e_bshfl: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+                    return special3(Instruction::Special3Func::e_bshfl,
+                                    mnemonic.code, regs[0], 0, regs[1]);
+                }
+                case Format::e_align: {
+                    if (!reg(0) || !reg(1) || !reg(2)) {
+                        return E::invalid_register;
+                    }
+                    const auto checked = number(3, 0, 3);
+                    if (checked.is_error()) return checked.get_error();
+                    return special3(Instruction::Special3Func::e_bshfl,
+                                    mnemonic.code | static_cast<uint8_t>(imm),
+                                    regs[0], regs[1], regs[2]);
+                }
+                case Format::e_ext:
+                case Format::e_ins: {
+                    if (!reg(0) || !reg(1)) return E::invalid_register;
+
+                    int64_t pos = 0;
+                    int64_t size = 0;
+                    if (!parse_number(operands[2], pos) ||
+                        !parse_number(operands[3], size)) {
+                        return E::invalid_operand;
+                    }
+                    if (pos < 0 || size < 1 || pos + size > 32) {
+                        return E::out_of_range;
+                    }
+
+                    // EXT stores size - 1, INS the most significant bit
+                    if (mnemonic.format == Format::e_ext) {
+                        return special3(Instruction::Special3Func::e_ext,
+                                        static_cast<uint8_t>(pos),
+                                        static_cast<uint8_t>(size - 1),
+                                        regs[1], regs[0]);
+                    }
+                    return special3(Instruction::Special3Func::e_ins,
+                                    static_cast<uint8_t>(pos),
+                                    static_cast<uint8_t>(pos + size - 1),
+                                    regs[1], regs[0]);
+                }
+
+                case Format::e_cache: {
+                    // Operation in rt and a 9 bit offset above bit 6
+                    const auto operation = number(0, 0, 31);
+                    if (operation.is_error()) return operation.get_error();
+                    const uint8_t rt = static_cast<uint8_t>(imm);
+
+                    imm = 0;
+                    const auto checked = memory(1, -0x100, 0xff);
+                    if (checked.is_error()) return checked.get_error();
+                    return (uint32_t(Instruction::SPECIAL3_OPCODE) << 26) |
+                           (uint32_t(base) << 21) | (uint32_t(rt) << 16) |
+                           (uint32_t(imm & 0x1ff) << 7) |
+                           static_cast<uint8_t>(
+                               Instruction::Special3Func::e_cache);
+                }
+
+                // Directives are emitted by assemble()
+                case Format::e_word:
+                case Format::e_space: break;
+            }
+
+            return E::unknown_mnemonic;
+        }
+
+        // Size in bytes of a statement
+        constexpr Result<uint32_t, AssemblerError>
+        statement_size(const Mnemonic& mnemonic, const Statement& statement) {
+            using E = AssemblerError;
+
+            switch (mnemonic.format) {
+                case Format::e_word: {
+                    if (statement.too_many_operands ||
+                        statement.operand_count == 0) {
+                        return E::invalid_operand;
+                    }
+                    return static_cast<uint32_t>(statement.operand_count * 4);
+                }
+                case Format::e_space: {
+                    int64_t size = 0;
+                    if (statement.too_many_operands ||
+                        statement.operand_count != 1 ||
+                        !parse_number(statement.operands[0], size)) {
+                        return E::invalid_operand;
+                    }
+                    // Keeps the following statements word aligned
+                    if (size < 0 || (size & 3) != 0) return E::out_of_range;
+                    return static_cast<uint32_t>(size);
+                }
+                default: return 4;
+            }
+        }
+
+        // Calls func(line_number, statement) for every line of source
+        template <typename Func>
+        constexpr Result<void, AssemblyError>
+        for_each_statement(std::string_view source, Func&& func) {
+            uint32_t line_number = 1;
+            while (true) {
+                const std::size_t end = source.find('\n');
+                const auto result =
+                    func(line_number, parse_statement(source.substr(0, end)));
+                if (result.is_error()) {
+                    return AssemblyError{result.get_error(), line_number};
+                }
+
+                if (end == std::string_view::npos) break;
+                source.remove_prefix(end + 1);
+                ++line_number;
+            }
+            return {};
+        }
+
+        // Assembles source located at origin, calling emit(word) for every
+        // word in order. Labels are collected in a first pass so that they
+        // can be referenced before they're defined, and only added to labels
+        // once the whole source assembled. Returns the size in bytes.
+        template <typename Labels, typename Emit>
+        constexpr Result<uint32_t, AssemblyError>
+        assemble(const std::string_view source, const uint32_t origin,
+                 Labels& labels, Emit&& emit) {
+            using E = AssemblerError;
+
+            Labels defined = labels;
+            uint32_t address = origin;
+            const auto define = [&](uint32_t,
+                                    const Statement& statement)
+                -> Result<void, E> {
+                std::string_view names = statement.labels;
+                while (!names.empty()) {
+                    const std::size_t colon = names.find(':');
+                    const std::string_view name =
+                        trim(names.substr(0, colon));
+                    names.remove_prefix(colon + 1);
+
+                    uint32_t existing = 0;
+                    if (defined.find(name, existing)) {
+                        return E::duplicate_label;
+                    }
+                    if (!defined.add(name, address)) return E::too_many_labels;
+                }
+
+                if (statement.mnemonic.empty()) return {};
+                const Mnemonic* mnemonic = find_mnemonic(statement.mnemonic);
+                if (mnemonic == nullptr) return E::unknown_mnemonic;
+
+                const auto size = statement_size(*mnemonic, statement);
+                if (size.is_error()) return size.get_error();
+                address += size.get_value();
+                return {};
+            };
+
+            const auto first = for_each_statement(source, define);
+            if (first.is_error()) return first.get_error();
+
+            const uint32_t size = address - origin;
+            address = origin;
+            const auto encode_statement =
+                [&](uint32_t, const Statement& statement) -> Result<void, E> {
+                if (statement.mnemonic.empty()) return {};
+                const Mnemonic& mnemonic = *find_mnemonic(statement.mnemonic);
+
+                if (mnemonic.format == Format::e_word) {
+                    for (std::size_t i = 0; i < statement.operand_count; ++i) {
+                        const auto word =
+                            word_value(statement.operands[i], defined);
+                        if (word.is_error()) return word.get_error();
+                        emit(word.get_value());
+                    }
+                }
+                else if (mnemonic.format == Format::e_space) {
+                    const uint32_t size =
+                        statement_size(mnemonic, statement).get_value();
+                    for (uint32_t i = 0; i < size; i += 4) emit(0);
+                }
+                else {
+                    const auto word =
+                        encode(mnemonic, statement, address, defined);
+                    if (word.is_error()) return word.get_error();
+                    emit(word.get_value());
+                }
+
+                address += statement_size(mnemonic, statement).get_value();
+                return {};
+            };
+
+            const auto second = for_each_statement(source, encode_statement);
+            if (second.is_error()) return second.get_error();
+
+            labels = std::move(defined);
+            return size;
+        }
+
+        // Number of words source assembles to, ignoring any errors
+        constexpr std::size_t count_words(const std::string_view source) {
+            std::size_t count = 0;
+            const auto counter = [&count](uint32_t, const Statement& statement)
+                -> Result<void, AssemblerError> {
+                if (statement.mnemonic.empty()) return {};
+
+                const Mnemonic* mnemonic = find_mnemonic(statement.mnemonic);
+                if (mnemonic == nullptr) {
+                    ++count;
+                    return {};
+                }
+                const auto size = statement_size(*mnemonic, statement);
+                count += size.is_error() ? 1 : size.get_value() / 4;
+                return {};
+            };
+            (void)for_each_statement(source, counter);
+            return count;
+        }
+
+        constexpr std::size_t MAX_FIRMWARE_LABELS = 256;
+
+        // Firmware assembled and decoded at compile time
+        template <std::size_t N>
+        struct Firmware {
+            uint32_t origin;
+            uint64_t key;
+            std::array<uint32_t, N> words;
+            std::array<DecodedInstruction, N> decoded;
+
+            constexpr std::size_t get_size() const noexcept { return N; }
+        };
+
+        // Not constexpr on purpose: reaching this while evaluating a
+        // constant expression turns the assembly error into a compile error
+        inline void invalid_firmware(const AssemblyError) { std::abort(); }
+
+        // Assembles and pre-decodes firmware, meant to initialize a constexpr
+        // variable:
+        //
+        //   constexpr std::string_view SOURCE = "...";
+        //   constexpr auto FIRMWARE = Assembler::assemble_firmware<
+        //       Assembler::count_words(SOURCE)>(SOURCE, 0x1000);
+        //
+        // FIRMWARE.words can then be written to memory and FIRMWARE.decoded
+        // attached to a DecodedImage without any decoding at runtime.
+        template <std::size_t N>
+        constexpr Firmware<N> assemble_firmware(const std::string_view source,
+                                                const uint32_t origin) {
+            Firmware<N> firmware = {origin, 0, {}, {}};
+
+            LabelTable<MAX_FIRMWARE_LABELS> labels;
+            std::size_t count = 0;
+            const auto result =
+                assemble(source, origin, labels, [&](const uint32_t word) {
+                    if (count < N) firmware.words[count] = word;
+                    ++count;
+                });
+            if (result.is_error()) invalid_firmware(result.get_error());
+            if (count != N) {
+                invalid_firmware({AssemblerError::out_of_range, 0});
+            }
+
+            firmware.key = DecodedImage::hash({firmware.words.data(), N});
+            firmware.decoded = predecode(origin, firmware.words);
+            return firmware;
+        }
+
+        // Labels of a runtime assembly. Names are copied so that addresses
+        // can still be looked up once the source is gone.
+        class LabelMap {
+        public:
+            bool add(const std::string_view name, const uint32_t address) {
+                return labels.emplace(name, address).second;
+            }
+
+            bool find(const std::string_view name, uint32_t& address) const {
+                const auto it = labels.find(name);
+                if (it == labels.end()) return false;
+                address = it->second;
+                return true;
+            }
+
+            void clear() { labels.clear(); }
+            std::size_t get_size() const noexcept { return labels.size(); }
+
+        private:
+            std::map<std::string, uint32_t, std::less<>> labels;
+        };
+
+        // Assembles source located at origin and writes it to memory in the
+        // guest byte order. The labels are kept in labels, which may already
+        // hold labels from earlier assemblies, e.g. a shared runtime library.
+        // labels is left as is unless the source was written. Returns the
+        // size in bytes.
+        template <typename Memory>
+        Result<uint32_t, AssemblyError>
+        assemble_into(Memory& memory, const std::string_view source,
+                      const uint32_t origin, LabelMap& labels) {
+            std::vector<uint32_t> words;
+            const auto emit = [&words](const uint32_t word) {
+                words.push_back(word);
+            };
+            LabelMap defined = labels;
+            const auto result = assemble(source, origin, defined, emit);
+            if (result.is_error()) return result;
+
+            if (memory.write_words(origin, {words.data(), words.size()})
+                    .is_error()) {
+                return AssemblyError{AssemblerError::write_failed, 0};
+            }
+            labels = std::move(defined);
+            return result;
+        }
+    } // namespace Assembler
+} // namespace mips_emulator
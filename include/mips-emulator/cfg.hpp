@@ -0,0 +1,269 @@
+#pragma once
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/instruction_info.hpp"
+#include "mips-emulator/register_name.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mips_emulator {
+    enum class EdgeKind : uint8_t {
+        // Next block in memory, also the return site of a call
+        e_fall_through,
+        // Taken side of a direct branch or jump
+        e_branch,
+        // Direct call
+        e_call,
+    };
+
+    struct Edge {
+        uint32_t target;
+        EdgeKind kind;
+    };
+
+    namespace BlockFlag {
+        // Entry point, symbol or call target
+        constexpr uint8_t e_function = 1 << 0;
+        // Ends in a call, the return site is a fall through edge
+        constexpr uint8_t e_call = 1 << 1;
+        // Ends in jr $ra
+        constexpr uint8_t e_return = 1 << 2;
+        // Ends in a jump or call through any other register
+        constexpr uint8_t e_indirect = 1 << 3;
+        // Ends in a word that can't be fetched or decoded
+        constexpr uint8_t e_invalid = 1 << 4;
+    } // namespace BlockFlag
+
+    struct BasicBlock {
+        uint32_t start;
+        // One past the last instruction, delay slot included
+        uint32_t end;
+        uint8_t flags;
+        std::vector<Edge> successors;
+
+        uint32_t get_instruction_count() const { return (end - start) / 4; }
+    };
+
+    // Jump or call whose target is only known at run time
+    struct IndirectSite {
+        uint32_t address;
+        // Start of the block the site ends
+        uint32_t block;
+        bool is_call;
+    };
+
+    // Control flow graph recovered by following direct branches from a set
+    // of entry points, e.g. the ELF entry and the function symbols.
+    //
+    // NOTE: Code only reachable through indirect jumps is not discovered,
+    // those sites are listed so that a caller can resolve them at run time.
+    // A branch into a delay slot starts a new block there, the delay slot
+    // is then part of both blocks.
+    class ControlFlowGraph {
+    public:
+        template <typename Memory>
+        void recover(Memory& memory, Span<const uint32_t> entries) {
+            clear();
+
+            std::set<uint32_t> leaders;
+            std::vector<uint32_t> worklist;
+            const auto add_leader = [&](const uint32_t address) {
+                if (leaders.insert(address).second) {
+                    worklist.push_back(address);
+                }
+            };
+
+            for (std::size_t i = 0; i < entries.get_size(); ++i) {
+                functions.insert(entries[i]);
+                add_leader(entries[i]);
+            }
+
+            // Walks sequentially from each leader until the flow leaves
+            // through a branch or reaches text that was already walked
+            std::unordered_map<uint32_t, uint32_t> text;
+            std::unordered_set<uint32_t> walked;
+            const auto fetch = [&](const uint32_t address) {
+                const auto result = memory.fetch(address);
+                if (result.is_error()) return false;
+                text.emplace(address, result.get_value());
+                return true;
+            };
+
+            while (!worklist.empty()) {
+                uint32_t address = worklist.back();
+                worklist.pop_back();
+
+                while (walked.insert(address).second && fetch(address)) {
+                    const Terminator end = get_terminator(address, text);
+                    if (end.op == Op::e_invalid) break;
+                    if (!get_op_info(end.op).is_branch()) {
+                        address += 4;
+                        continue;
+                    }
+
+                    if (get_op_info(end.op).has_delay_slot()) {
+                        fetch(address + 4);
+                    }
+                    if (end.target_known) {
+                        if (end.is_call) functions.insert(end.target);
+                        add_leader(end.target);
+                    }
+                    if (end.falls_through) add_leader(end.fall_through);
+                    break;
+                }
+            }
+
+            for (const uint32_t leader : leaders) {
+                add_block(leader, leaders, text);
+            }
+        }
+
+        void clear() {
+            blocks.clear();
+            functions.clear();
+            indirect_sites.clear();
+        }
+
+        // Block containing address, the latest starting one if a delay slot
+        // is shared
+        const BasicBlock* find_block(const uint32_t address) const {
+            auto it = blocks.upper_bound(address);
+            if (it == blocks.begin()) return nullptr;
+            --it;
+            return address < it->second.end ? &it->second : nullptr;
+        }
+
+        const std::map<uint32_t, BasicBlock>& get_blocks() const {
+            return blocks;
+        }
+        const std::set<uint32_t>& get_functions() const { return functions; }
+        const std::vector<IndirectSite>& get_indirect_sites() const {
+            return indirect_sites;
+        }
+
+    private:
+        // How control leaves the instruction at address
+        struct Terminator {
+            Op op;
+            uint32_t target;
+            uint32_t fall_through;
+            bool target_known;
+            bool falls_through;
+            bool is_call;
+            bool is_return;
+        };
+
+        static Terminator
+        get_terminator(const uint32_t address,
+                       const std::unordered_map<uint32_t, uint32_t>& text) {
+            const uint32_t raw = text.at(address);
+            const DecodedInstruction decoded =
+                decode_instruction(address, raw);
+
+            Terminator end = {};
+            end.op = decode_op(raw);
+            const OpInfo& info = get_op_info(end.op);
+            if (!info.is_branch()) return end;
+
+            const Instruction instr(raw);
+            const bool indirect = info.flags & OpFlag::e_indirect;
+            const bool link = info.flags & OpFlag::e_link;
+
+            // beq $x, $x is the unconditional b
+            const bool always = end.op == Op::e_beq &&
+                                instr.get_rs() == instr.get_rt();
+            const bool conditional =
+                (info.flags & OpFlag::e_conditional) && !always;
+
+            end.target = decoded.target;
+            end.fall_through = decoded.get_fall_through(address);
+            end.target_known = !indirect;
+            end.falls_through = conditional || link;
+            end.is_call = link;
+            end.is_return = end.op == Op::e_jr &&
+                            instr.get_rs() ==
+                                static_cast<uint8_t>(RegisterName::e_ra);
+            return end;
+        }
+
+        void add_block(const uint32_t start, const std::set<uint32_t>& leaders,
+                       const std::unordered_map<uint32_t, uint32_t>& text) {
+            BasicBlock& block = blocks[start];
+            block.start = start;
+            block.flags = functions.count(start) ? BlockFlag::e_function : 0;
+
+            uint32_t address = start;
+            while (true) {
+                if (text.find(address) == text.end()) {
+                    block.end = address;
+                    block.flags |= BlockFlag::e_invalid;
+                    return;
+                }
+
+                const Terminator end = get_terminator(address, text);
+                if (end.op == Op::e_invalid) {
+                    block.end = address + 4;
+                    block.flags |= BlockFlag::e_invalid;
+                    return;
+                }
+
+                const OpInfo& info = get_op_info(end.op);
+                if (info.is_branch()) {
+                    block.end = address + 4;
+                    if (info.has_delay_slot()) {
+                        if (!text.count(block.end)) {
+                            block.flags |= BlockFlag::e_invalid;
+                            return;
+                        }
+                        block.end += 4;
+                    }
+                    add_successors(block, address, end);
+                    return;
+                }
+
+                address += 4;
+                if (leaders.count(address) || !text.count(address)) {
+                    block.end = address;
+                    if (text.count(address)) {
+                        block.successors.push_back(
+                            {address, EdgeKind::e_fall_through});
+                    }
+                    else {
+                        block.flags |= BlockFlag::e_invalid;
+                    }
+                    return;
+                }
+            }
+        }
+
+        void add_successors(BasicBlock& block, const uint32_t address,
+                            const Terminator& end) {
+            if (end.is_call) block.flags |= BlockFlag::e_call;
+            if (end.is_return) block.flags |= BlockFlag::e_return;
+
+            if (end.target_known) {
+                const EdgeKind kind =
+                    end.is_call ? EdgeKind::e_call : EdgeKind::e_branch;
+                block.successors.push_back({end.target, kind});
+            }
+            else if (!end.is_return) {
+                block.flags |= BlockFlag::e_indirect;
+                indirect_sites.push_back({address, block.start, end.is_call});
+            }
+
+            if (end.falls_through) {
+                block.successors.push_back(
+                    {end.fall_through, EdgeKind::e_fall_through});
+            }
+        }
+
+        std::map<uint32_t, BasicBlock> blocks;
+        std::set<uint32_t> functions;
+        std::vector<IndirectSite> indirect_sites;
+    };
+} // namespace mips_emulator
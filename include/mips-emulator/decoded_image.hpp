@@ -0,0 +1,471 @@
+#pragma once
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/mapped_file.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/result.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mips_emulator {
+    enum class ImageError : uint8_t {
+        open_failed,
+        write_failed,
+        invalid_format,
+        key_mismatch,
+    };
+
+    namespace DecodeFlag {
+        constexpr uint8_t e_valid = 1 << 0;
+        // First instruction of a basic block
+        constexpr uint8_t e_leader = 1 << 1;
+        // Any control transfer, target is set unless it's indirect
+        constexpr uint8_t e_branch = 1 << 2;
+        // Branch without a delay slot
+        constexpr uint8_t e_compact = 1 << 3;
+        constexpr uint8_t e_indirect = 1 << 4;
+        // SYNCI, CACHE or a hazard barrier, see InvalidationMode
+        constexpr uint8_t e_sync = 1 << 5;
+        // Load or store off a base register, see AccessSite
+        constexpr uint8_t e_access = 1 << 6;
+    } // namespace DecodeFlag
+
+    struct DecodedInstruction {
+        uint32_t raw;
+        uint32_t target;
+        uint8_t type;
+        uint8_t flags;
+        uint16_t reserved;
+
+        constexpr Instruction::Type get_type() const noexcept {
+            return static_cast<Instruction::Type>(type);
+        }
+
+        constexpr bool is_valid() const noexcept {
+            return flags & DecodeFlag::e_valid;
+        }
+        constexpr bool is_leader() const noexcept {
+            return flags & DecodeFlag::e_leader;
+        }
+        constexpr bool is_branch() const noexcept {
+            return flags & DecodeFlag::e_branch;
+        }
+
+        // Address of the first instruction after the branch and its delay slot
+        constexpr uint32_t
+        get_fall_through(const uint32_t address) const noexcept {
+            return address + ((flags & DecodeFlag::e_compact) ? 4 : 8);
+        }
+    };
+
+    static_assert(std::is_trivially_copyable_v<DecodedInstruction>,
+                  "DecodedInstruction is stored as is in image files");
+
+    // Decodes a single instruction located at address. Fields are extracted
+    // with shifts so that images can be built in constant expressions.
+    constexpr DecodedInstruction decode_instruction(const uint32_t address,
+                                                    const uint32_t raw) {
+        using Type = Instruction::Type;
+        using IOp = Instruction::ITypeOpcode;
+        using JOp = Instruction::JTypeOpcode;
+        using Func = Instruction::Func;
+        using RegimmOp = Instruction::RegimmITypeOp;
+
+        DecodedInstruction decoded = {raw, 0, 0, 0, 0};
+
+        const auto type = Instruction::decode_type(raw);
+        if (type.is_error()) return decoded;
+
+        decoded.type = static_cast<uint8_t>(type.get_value());
+        decoded.flags = DecodeFlag::e_valid;
+
+        const uint8_t op = raw >> 26;
+        const uint8_t rs = (raw >> 21) & 0x1f;
+        const uint8_t rt = (raw >> 16) & 0x1f;
+
+        // Sign extends the low bits of raw into a byte offset
+        const auto offset = [raw](const uint32_t bits) {
+            const uint32_t sign = 1u << (bits - 1);
+            const uint32_t imm = raw & ((1u << bits) - 1);
+            return ((imm ^ sign) - sign) << 2;
+        };
+
+        // Offsets are relative to the instruction after the branch
+        const uint32_t next = address + 4;
+        const auto branch = [&decoded](const uint32_t target,
+                                       const bool compact) {
+            decoded.flags |= DecodeFlag::e_branch;
+            if (compact) decoded.flags |= DecodeFlag::e_compact;
+            decoded.target = target;
+        };
+        const auto indirect = [&branch, &decoded](const bool compact) {
+            branch(0, compact);
+            decoded.flags |= DecodeFlag::e_indirect;
+        };
+
+        switch (type.get_value()) {
+            case Type::e_rtype: {
+                const Func func = static_cast<Func>(raw & 0x3f);
+                if (func == Func::e_jr || func == Func::e_jalr) {
+                    indirect(false);
+                    if ((raw >> 6) & Instruction::HAZARD_BARRIER_HINT) {
+                        decoded.flags |= DecodeFlag::e_sync;
+                    }
+                }
+                break;
+            }
+            case Type::e_itype:
+            case Type::e_longimm_itype: {
+                switch (static_cast<IOp>(op)) {
+                    case IOp::e_beq:
+                    case IOp::e_bne: branch(next + offset(16), false); break;
+
+                    // BLEZ and BGTZ have delay slots, the rest of the POP
+                    // encodings are compact branches
+                    case IOp::e_pop06:
+                    case IOp::e_pop07:
+                        branch(next + offset(16), rt != 0);
+                        break;
+                    case IOp::e_pop10:
+                    case IOp::e_pop30:
+                    case IOp::e_pop26:
+                    case IOp::e_pop27: branch(next + offset(16), true); break;
+
+                    case IOp::e_lb:
+                    case IOp::e_lh:
+                    case IOp::e_lw:
+                    case IOp::e_lbu:
+                    case IOp::e_lhu:
+                    case IOp::e_sb:
+                    case IOp::e_sh:
+                    case IOp::e_sw:
+                        decoded.flags |= DecodeFlag::e_access;
+                        break;
+
+                    // JIC/JIALC or BEQZC/BNEZC
+                    case IOp::e_pop66:
+                    case IOp::e_pop76: {
+                        if (rs == 0) {
+                            indirect(true);
+                        }
+                        else {
+                            branch(next + offset(21), true);
+                        }
+                        break;
+                    }
+                    default: break;
+                }
+                break;
+            }
+            case Type::e_jtype: {
+                switch (static_cast<JOp>(op)) {
+                    case JOp::e_j:
+                    case JOp::e_jal:
+                        branch((next & 0xf0000000) | ((raw & 0x3ffffff) << 2),
+                               false);
+                        break;
+                    case JOp::e_bc:
+                    case JOp::e_balc: branch(next + offset(26), true); break;
+                }
+                break;
+            }
+            case Type::e_regimm_itype: {
+                if (static_cast<RegimmOp>(rt) == RegimmOp::e_synci) {
+                    decoded.flags |= DecodeFlag::e_sync;
+                }
+                else {
+                    branch(next + offset(16), false);
+                }
+                break;
+            }
+            case Type::e_special3_type_cache:
+                decoded.flags |= DecodeFlag::e_sync;
+                break;
+            default: break;
+        }
+
+        return decoded;
+    }
+
+    // Decodes text located at base and marks the basic block leaders
+    template <std::size_t N>
+    constexpr std::array<DecodedInstruction, N>
+    predecode(const uint32_t base, const std::array<uint32_t, N>& text) {
+        std::array<DecodedInstruction, N> decoded = {};
+        for (std::size_t i = 0; i < N; ++i) {
+            decoded[i] = decode_instruction(base + i * 4, text[i]);
+        }
+
+        const auto mark_leader = [&decoded, base](const uint32_t address) {
+            const uint32_t offset = address - base;
+            if ((offset & 3) == 0 && offset / 4 < N) {
+                decoded[offset / 4].flags |= DecodeFlag::e_leader;
+            }
+        };
+
+        if (N != 0) mark_leader(base);
+        for (std::size_t i = 0; i < N; ++i) {
+            if (!decoded[i].is_branch()) continue;
+
+            if (!(decoded[i].flags & DecodeFlag::e_indirect)) {
+                mark_leader(decoded[i].target);
+            }
+            mark_leader(decoded[i].get_fall_through(base + i * 4));
+        }
+
+        return decoded;
+    }
+
+    // Pre-decoded text segment.
+    //
+    // Every word of the segment is decoded once, block leaders and branch
+    // targets included, so the executor can skip get_type(). Images can be
+    // saved and mapped back in later, keyed by a hash of the text they were
+    // decoded from, so a warm start does no decoding at all.
+    //
+    // NOTE: The image is a snapshot of the text. It has to be rebuilt when
+    // the text is modified.
+    class DecodedImage {
+    public:
+        using Address = uint32_t;
+
+        static constexpr uint32_t FORMAT_VERSION = 2;
+
+        static constexpr uint64_t hash(Span<const uint32_t> text) {
+            // FNV-1a over whole words
+            uint64_t hash = 0xcbf29ce484222325;
+            for (std::size_t i = 0; i < text.get_size(); ++i) {
+                hash = (hash ^ text[i]) * 0x100000001b3;
+            }
+            return hash;
+        }
+
+        // Reads size bytes of text at address as host order words
+        template <typename Memory>
+        static Result<void, MemoryError>
+        read_text(Memory& memory, const Address address, const uint32_t size,
+                  std::vector<uint32_t>& text) {
+            text.resize(size / 4);
+            const auto result = memory.read_block(
+                address,
+                {reinterpret_cast<uint8_t*>(text.data()), text.size() * 4});
+            if (result.is_error()) return result;
+
+            for (uint32_t& word : text) word = to_host<Memory::ENDIAN>(word);
+            return {};
+        }
+
+        void decode(const Address address, Span<const uint32_t> text) {
+            decode(address, text, 1);
+        }
+
+        // Decodes the text split across up to thread_count host threads.
+        // Each thread decodes a chunk and marks the leaders inside of it,
+        // leaders in other chunks are marked once all threads are done.
+        void decode(const Address address, Span<const uint32_t> text,
+                    const unsigned thread_count) {
+            file.reset();
+            external = nullptr;
+            base = address;
+            count = static_cast<uint32_t>(text.get_size());
+            key = hash(text);
+            owned.resize(count);
+
+            const uint32_t chunks = std::max<uint32_t>(
+                1, std::min<uint32_t>(thread_count, count / MIN_CHUNK_SIZE));
+            const uint32_t chunk_size = (count + chunks - 1) / chunks;
+
+            std::vector<std::vector<Address>> remote(chunks);
+            std::vector<std::thread> threads;
+            threads.reserve(chunks - 1);
+            for (uint32_t i = 1; i < chunks; ++i) {
+                threads.emplace_back([&, i]() {
+                    decode_chunk(text, i * chunk_size,
+                                 std::min(count, (i + 1) * chunk_size),
+                                 remote[i]);
+                });
+            }
+            decode_chunk(text, 0, std::min(count, chunk_size), remote[0]);
+
+            for (std::thread& thread : threads) thread.join();
+
+            if (count != 0) owned[0].flags |= DecodeFlag::e_leader;
+            for (const auto& leaders : remote) {
+                for (const Address leader : leaders) mark_leader(leader);
+            }
+        }
+
+        [[nodiscard]] Result<void, ImageError> save(const char* path) const {
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            if (!stream) return ImageError::open_failed;
+
+            const Header header = make_header(base, count, key);
+            stream.write(reinterpret_cast<const char*>(&header),
+                         sizeof(header));
+            stream.write(reinterpret_cast<const char*>(get_data()),
+                         static_cast<std::streamsize>(
+                             count * sizeof(DecodedInstruction)));
+
+            if (!stream) return ImageError::write_failed;
+            return {};
+        }
+
+        // Maps a saved image decoded from text at address. The entries are
+        // used in place.
+        [[nodiscard]] Result<void, ImageError>
+        load(const char* path, const Address address,
+             Span<const uint32_t> text) {
+            auto mapped =
+                MappedFile::open(path, MappedFile::Mode::e_read_only);
+            if (mapped == nullptr) return ImageError::open_failed;
+
+            if (mapped->get_size() < sizeof(Header)) {
+                return ImageError::invalid_format;
+            }
+
+            Header header;
+            std::memcpy(&header, mapped->get_data(), sizeof(header));
+
+            const Header expected =
+                make_header(header.base, header.count, header.key);
+            if (std::memcmp(header.magic, expected.magic,
+                            sizeof(header.magic)) != 0 ||
+                header.version != FORMAT_VERSION ||
+                header.byte_order != expected.byte_order ||
+                mapped->get_size() !=
+                    sizeof(Header) +
+                        header.count * sizeof(DecodedInstruction)) {
+                return ImageError::invalid_format;
+            }
+
+            if (header.base != address || header.count != text.get_size() ||
+                header.key != hash(text)) {
+                return ImageError::key_mismatch;
+            }
+
+            owned.clear();
+            external = nullptr;
+            file = std::move(mapped);
+            base = header.base;
+            count = header.count;
+            key = header.key;
+            return {};
+        }
+
+        // Uses entries built elsewhere, typically by predecode() at compile
+        // time, in place. The entries have to outlive the image.
+        void attach(const Address address,
+                    Span<const DecodedInstruction> entries,
+                    const uint64_t entries_key) {
+            owned.clear();
+            file.reset();
+            external = entries.get_data();
+            base = address;
+            count = static_cast<uint32_t>(entries.get_size());
+            key = entries_key;
+        }
+
+        const DecodedInstruction* lookup(const Address address) const {
+            const Address offset = address - base;
+            if ((offset & 3) != 0 || offset / 4 >= count) return nullptr;
+            return get_data() + offset / 4;
+        }
+
+        Address get_base() const noexcept { return base; }
+        uint32_t get_size() const noexcept { return count; }
+        uint64_t get_key() const noexcept { return key; }
+        bool is_mapped() const noexcept { return file != nullptr; }
+
+        const DecodedInstruction* get_data() const {
+            if (file != nullptr) {
+                return reinterpret_cast<const DecodedInstruction*>(
+                    file->get_data() + sizeof(Header));
+            }
+            if (external != nullptr) return external;
+            return owned.data();
+        }
+
+    private:
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            // Entries are stored in host byte order
+            uint32_t byte_order;
+            uint64_t key;
+            uint32_t base;
+            uint32_t count;
+        };
+
+        static_assert(sizeof(Header) % alignof(DecodedInstruction) == 0,
+                      "Entries following the header must be aligned");
+
+        static Header make_header(const Address base, const uint32_t count,
+                                  const uint64_t key) {
+            Header header = {{'M', 'I', 'P', 'S', 'D', 'E', 'C', 0},
+                             FORMAT_VERSION,
+                             0x01020304,
+                             key,
+                             base,
+                             count};
+            return header;
+        }
+
+        // Smallest number of words worth handing to a separate thread
+        static constexpr uint32_t MIN_CHUNK_SIZE = 4096;
+
+        void decode_chunk(Span<const uint32_t> text, const uint32_t begin,
+                          const uint32_t end, std::vector<Address>& remote) {
+            for (uint32_t i = begin; i < end; ++i) {
+                owned[i] = decode_instruction(base + i * 4, text[i]);
+            }
+
+            // Only entries in this chunk may be touched until every thread
+            // is done
+            const auto leader = [&](const Address address) {
+                const Address offset = address - base;
+                if ((offset & 3) != 0 || offset / 4 >= count) return;
+
+                const uint32_t index = offset / 4;
+                if (index >= begin && index < end) {
+                    owned[index].flags |= DecodeFlag::e_leader;
+                }
+                else {
+                    remote.push_back(address);
+                }
+            };
+
+            for (uint32_t i = begin; i < end; ++i) {
+                const DecodedInstruction& decoded = owned[i];
+                if (!decoded.is_branch()) continue;
+
+                if (!(decoded.flags & DecodeFlag::e_indirect)) {
+                    leader(decoded.target);
+                }
+                leader(decoded.get_fall_through(base + i * 4));
+            }
+        }
+
+        void mark_leader(const Address address) {
+            const Address offset = address - base;
+            if ((offset & 3) == 0 && offset / 4 < count) {
+                owned[offset / 4].flags |= DecodeFlag::e_leader;
+            }
+        }
+
+        std::vector<DecodedInstruction> owned;
+        std::shared_ptr<MappedFile> file;
+        const DecodedInstruction* external = nullptr;
+        Address base = 0;
+        uint32_t count = 0;
+        uint64_t key = 0;
+    };
+} // namespace mips_emulator
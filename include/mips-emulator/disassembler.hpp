@@ -0,0 +1,432 @@
+#pragma once
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace mips_emulator {
+    // Disassembler built on the assembler's mnemonic table, so that its
+    // output assembles back to the same words.
+    //
+    // Candidate mnemonics are indexed by opcode, and by function for R-Type
+    // instructions, at compile time. Disassembling a word is a table lookup
+    // followed by a check of the fields that tell the candidates apart.
+    // Nothing is allocated, text is written to caller provided buffers.
+    namespace Disassembler {
+        using Assembler::Format;
+        using Assembler::Mnemonic;
+        using IOp = Instruction::ITypeOpcode;
+
+        // Large enough for any instruction, including the terminator
+        constexpr std::size_t MAX_TEXT_SIZE = 48;
+
+        // Most mnemonics sharing an opcode, the special3 ones
+        constexpr std::size_t MAX_CANDIDATES = 8;
+
+        struct Candidates {
+            std::array<uint8_t, MAX_CANDIDATES> indices;
+            uint8_t count;
+        };
+
+        using CandidateTable = std::array<Candidates, 64>;
+
+        constexpr bool is_rtype(const Format format) {
+            switch (format) {
+                case Format::e_rd_rs_rt:
+                case Format::e_rd_rt_rs:
+                case Format::e_rd_rt_sa:
+                case Format::e_rd_rs:
+                case Format::e_rs:
+                case Format::e_rs_hb:
+                case Format::e_rs_rt:
+                case Format::e_none: return true;
+                default: return false;
+            }
+        }
+
+        // Primary opcode of the words a mnemonic assembles to
+        constexpr uint8_t opcode_of(const Mnemonic& mnemonic) {
+            switch (mnemonic.format) {
+                case Format::e_regimm:
+                case Format::e_mem: return Instruction::REGIMM_OPCODE;
+                case Format::e_pcrel1:
+                case Format::e_pcrel2: return Instruction::PCREL_OPCODE;
+                case Format::e_bshfl:
+                case Format::e_align:
+                case Format::e_ext:
+                case Format::e_ins:
+                case Format::e_cache: return Instruction::SPECIAL3_OPCODE;
+                default: return mnemonic.code;
+            }
+        }
+
+        constexpr CandidateTable build_table(const bool rtype) {
+            CandidateTable table = {};
+            for (std::size_t i = 0; i < std::size(Assembler::MNEMONICS); ++i) {
+                const Mnemonic& mnemonic = Assembler::MNEMONICS[i];
+                const Format format = mnemonic.format;
+                if (format == Format::e_word || format == Format::e_space) {
+                    continue;
+                }
+                if (is_rtype(format) != rtype) continue;
+
+                const uint8_t key =
+                    rtype ? mnemonic.code : opcode_of(mnemonic);
+                Candidates& candidates = table[key];
+                candidates.indices[candidates.count++] =
+                    static_cast<uint8_t>(i);
+            }
+            return table;
+        }
+
+        constexpr CandidateTable RTYPE_TABLE = build_table(true);
+        constexpr CandidateTable OPCODE_TABLE = build_table(false);
+
+        // Whether word is an encoding of mnemonic, the opcode or function
+        // is already known to match
+        constexpr bool matches(const Mnemonic& mnemonic, const uint32_t word) {
+            const uint8_t rs = (word >> 21) & 0x1f;
+            const uint8_t rt = (word >> 16) & 0x1f;
+            const uint8_t rd = (word >> 11) & 0x1f;
+            const uint8_t shamt = (word >> 6) & 0x1f;
+            const uint8_t func = word & 0x3f;
+
+            const auto special3 = [func](const Instruction::Special3Func f) {
+                return func == static_cast<uint8_t>(f);
+            };
+
+            switch (mnemonic.format) {
+                case Format::e_none: return word == 0;
+                case Format::e_rd_rs_rt:
+                case Format::e_rd_rt_rs: return shamt == mnemonic.extra;
+                case Format::e_rd_rt_sa: return rs == mnemonic.extra;
+                case Format::e_rd_rs: return shamt == mnemonic.extra && rt == 0;
+                case Format::e_rs: return rt == 0 && shamt == 0;
+                case Format::e_rs_hb:
+                    return rt == 0 &&
+                           shamt == Instruction::HAZARD_BARRIER_HINT;
+                case Format::e_rs_rt: return true;
+
+                case Format::e_rt_rs_imm:
+                case Format::e_rt_rs_uimm:
+                case Format::e_rt_mem:
+                case Format::e_rs_rt_target:
+                case Format::e_target_jump:
+                case Format::e_target26: return true;
+                case Format::e_rt_imm:
+                case Format::e_rt_uimm: return rs == 0;
+                case Format::e_rs_target: return rt == 0;
+                case Format::e_regimm:
+                case Format::e_mem: return rt == mnemonic.extra;
+
+                // Compact branches sharing an opcode
+                case Format::e_rt_target_rs0: return rs == 0 && rt != 0;
+                case Format::e_rt_target_rsrt: return rs == rt && rt != 0;
+                case Format::e_rs_rt_target_compact:
+                    return rs != 0 && rt != 0 && rs != rt;
+                case Format::e_rs_rt_target_ordered: return rs != 0 && rs < rt;
+                case Format::e_rs_rt_target_overflow: return rs >= rt;
+                case Format::e_rs_target21: return rs != 0;
+                case Format::e_pop_rt_imm: return rs == 0;
+
+                case Format::e_pcrel1:
+                    return ((word >> 19) & 0b11) == mnemonic.code;
+                case Format::e_pcrel2:
+                    return ((word >> 16) & 0x1f) == mnemonic.code;
+
+                case Format::e_bshfl:
+                    return special3(Instruction::Special3Func::e_bshfl) &&
+                           rs == 0 && shamt == mnemonic.code;
+                case Format::e_align:
+                    return special3(Instruction::Special3Func::e_bshfl) &&
+                           (shamt & ~0b11) == mnemonic.code;
+                case Format::e_ext:
+                    return special3(Instruction::Special3Func::e_ext) &&
+                           shamt + rd < 32;
+                case Format::e_ins:
+                    return special3(Instruction::Special3Func::e_ins) &&
+                           rd >= shamt;
+                case Format::e_cache:
+                    return special3(Instruction::Special3Func::e_cache) &&
+                           (shamt & 1) == 0;
+
+                case Format::e_word:
+                case Format::e_space: return false;
+            }
+            return false;
+        }
+
+        // Mnemonic for word, or nullptr if it isn't a known instruction
+        constexpr const Mnemonic* find_mnemonic(const uint32_t word) {
+            const uint8_t opcode = word >> 26;
+            const Candidates& candidates = opcode == Instruction::RTYPE_OPCODE
+                                               ? RTYPE_TABLE[word & 0x3f]
+                                               : OPCODE_TABLE[opcode];
+
+            for (uint8_t i = 0; i < candidates.count; ++i) {
+                const Mnemonic& mnemonic =
+                    Assembler::MNEMONICS[candidates.indices[i]];
+                if (matches(mnemonic, word)) return &mnemonic;
+            }
+            return nullptr;
+        }
+
+        // Appends to a fixed size buffer, truncating and keeping it NUL
+        // terminated
+        class TextWriter {
+        public:
+            TextWriter(Span<char> output) : buffer(output) {
+                if (buffer.get_size() != 0) buffer[0] = '\0';
+            }
+
+            void put(const char c) {
+                if (length + 1 < buffer.get_size()) {
+                    buffer[length++] = c;
+                    buffer[length] = '\0';
+                }
+            }
+
+            void put(const std::string_view text) {
+                for (const char c : text) put(c);
+            }
+
+            void put_register(const uint8_t reg) {
+                put('$');
+                put(Assembler::REGISTER_NAMES[reg & 31]);
+            }
+
+            void put_unsigned(uint32_t value) {
+                char digits[10];
+                std::size_t count = 0;
+                do {
+                    digits[count++] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                } while (value != 0);
+                while (count != 0) put(digits[--count]);
+            }
+
+            void put_signed(const int32_t value) {
+                if (value < 0) put('-');
+                put_unsigned(value < 0 ? 0u - static_cast<uint32_t>(value)
+                                       : static_cast<uint32_t>(value));
+            }
+
+            void put_hex(const uint32_t value, const bool pad = false) {
+                constexpr char DIGITS[] = "0123456789abcdef";
+                put("0x");
+                bool leading = !pad;
+                for (int shift = 28; shift >= 0; shift -= 4) {
+                    const uint32_t digit = (value >> shift) & 0xf;
+                    if (leading && digit == 0 && shift != 0) continue;
+                    leading = false;
+                    put(DIGITS[digit]);
+                }
+            }
+
+            void separator() { put(", "); }
+
+            std::size_t get_length() const noexcept { return length; }
+
+        private:
+            Span<char> buffer;
+            std::size_t length = 0;
+        };
+
+        // Writes the text of word, located at address, to buffer. The text
+        // is truncated to fit, MAX_TEXT_SIZE is always enough. Returns its
+        // length.
+        inline std::size_t disassemble(const uint32_t address,
+                                       const uint32_t word,
+                                       Span<char> buffer) {
+            TextWriter out(buffer);
+
+            const Mnemonic* mnemonic = find_mnemonic(word);
+            if (mnemonic == nullptr) {
+                out.put(".word ");
+                out.put_hex(word, true);
+                return out.get_length();
+            }
+
+            const uint8_t rs = (word >> 21) & 0x1f;
+            const uint8_t rt = (word >> 16) & 0x1f;
+            const uint8_t rd = (word >> 11) & 0x1f;
+            const uint8_t shamt = (word >> 6) & 0x1f;
+            const uint16_t imm = word & 0xffff;
+            const int32_t simm = static_cast<int16_t>(imm);
+
+            // Sign extended offset of the given width, in words
+            const auto offset = [word](const uint32_t bits) {
+                const uint32_t sign = 1u << (bits - 1);
+                return ((word & ((1u << bits) - 1)) ^ sign) - sign;
+            };
+            const auto target = [&](const uint32_t bits) {
+                out.put_hex(address + 4 + (offset(bits) << 2), true);
+            };
+            const auto registers = [&](const uint8_t first,
+                                       const uint8_t second) {
+                out.put_register(first);
+                out.separator();
+                out.put_register(second);
+            };
+
+            const auto memory = [&](const int32_t displacement) {
+                out.put_signed(displacement);
+                out.put('(');
+                out.put_register(rs);
+                out.put(')');
+            };
+
+            out.put(mnemonic->name);
+            if (mnemonic->format != Format::e_none) out.put(' ');
+
+            switch (mnemonic->format) {
+                case Format::e_none: break;
+
+                case Format::e_rd_rs_rt:
+                    registers(rd, rs);
+                    out.separator();
+                    out.put_register(rt);
+                    break;
+                case Format::e_rd_rt_rs:
+                    registers(rd, rt);
+                    out.separator();
+                    out.put_register(rs);
+                    break;
+                case Format::e_rd_rt_sa:
+                    registers(rd, rt);
+                    out.separator();
+                    out.put_unsigned(shamt);
+                    break;
+                case Format::e_rd_rs: registers(rd, rs); break;
+                case Format::e_rs:
+                case Format::e_rs_hb: {
+                    // JALR links to $ra unless told otherwise
+                    if (rd != mnemonic->extra) {
+                        out.put_register(rd);
+                        out.separator();
+                    }
+                    out.put_register(rs);
+                    break;
+                }
+                case Format::e_rs_rt: registers(rs, rt); break;
+
+                case Format::e_rt_rs_imm:
+                    registers(rt, rs);
+                    out.separator();
+                    out.put_signed(simm);
+                    break;
+                case Format::e_rt_rs_uimm:
+                    registers(rt, rs);
+                    out.separator();
+                    out.put_hex(imm);
+                    break;
+                case Format::e_rt_imm:
+                    out.put_register(rt);
+                    out.separator();
+                    out.put_signed(simm);
+                    break;
+                case Format::e_rt_uimm:
+                    out.put_register(rt);
+                    out.separator();
+                    out.put_hex(imm);
+                    break;
+                case Format::e_rt_mem:
+                    out.put_register(rt);
+                    out.separator();
+                    memory(simm);
+                    break;
+                case Format::e_mem: memory(simm); break;
+                case Format::e_cache: {
+                    // 9 bit offset above bit 6
+                    const uint32_t field = (word >> 7) & 0x1ff;
+                    out.put_unsigned(rt);
+                    out.separator();
+                    memory(static_cast<int32_t>(field ^ 0x100) - 0x100);
+                    break;
+                }
+
+                case Format::e_rs_rt_target:
+                case Format::e_rs_rt_target_compact:
+                case Format::e_rs_rt_target_ordered:
+                case Format::e_rs_rt_target_overflow:
+                    registers(rs, rt);
+                    out.separator();
+                    target(16);
+                    break;
+                case Format::e_rs_target:
+                case Format::e_regimm:
+                    out.put_register(rs);
+                    out.separator();
+                    target(16);
+                    break;
+                case Format::e_rt_target_rs0:
+                case Format::e_rt_target_rsrt:
+                    out.put_register(rt);
+                    out.separator();
+                    target(16);
+                    break;
+                case Format::e_rs_target21:
+                    out.put_register(rs);
+                    out.separator();
+                    target(21);
+                    break;
+                case Format::e_pop_rt_imm:
+                    out.put_register(rt);
+                    out.separator();
+                    out.put_signed(simm);
+                    break;
+
+                case Format::e_target_jump:
+                    out.put_hex(((address + 4) & 0xf0000000) |
+                                    ((word & 0x3ffffff) << 2),
+                                true);
+                    break;
+                case Format::e_target26: target(26); break;
+
+                case Format::e_pcrel1:
+                    out.put_register(rs);
+                    out.separator();
+                    out.put_signed(static_cast<int32_t>(offset(19)));
+                    break;
+                case Format::e_pcrel2:
+                    out.put_register(rs);
+                    out.separator();
+                    out.put_hex(imm);
+                    break;
+
+                case Format::e_bshfl: registers(rd, rt); break;
+                case Format::e_align:
+                    registers(rd, rs);
+                    out.separator();
+                    out.put_register(rt);
+                    out.separator();
+                    out.put_unsigned(shamt & 0b11);
+                    break;
+                case Format::e_ext:
+                case Format::e_ins: {
+                    registers(rt, rs);
+                    out.separator();
+                    out.put_unsigned(shamt);
+                    out.separator();
+
+                    // EXT stores size - 1, INS the most significant bit
+                    const uint32_t size = mnemonic->format == Format::e_ext
+                                              ? rd + 1u
+                                              : rd + 1u - shamt;
+                    out.put_unsigned(size);
+                    break;
+                }
+
+                case Format::e_word:
+                case Format::e_space: break;
+            }
+
+            return out.get_length();
+        }
+    } // namespace Disassembler
+} // namespace mips_emulator
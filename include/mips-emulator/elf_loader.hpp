@@ -0,0 +1,357 @@
+#pragma once
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/mapped_file.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/result.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace mips_emulator {
+    enum class ElfError : uint8_t {
+        open_failed,
+        invalid_header,
+        unsupported_format,
+        endianness_mismatch,
+        invalid_segment,
+        load_failed,
+    };
+
+    struct ElfSegment {
+        uint32_t address;
+        uint32_t offset;
+        uint32_t file_size;
+        uint32_t memory_size;
+        Permissions perms;
+    };
+
+    // The parts of an ELF32 MIPS executable needed to load it
+    struct ElfImage {
+        Endian endian = Endian::e_little;
+        uint32_t entry = 0;
+        std::vector<ElfSegment> segments;
+    };
+
+    namespace ElfLoader {
+        static constexpr uint8_t ELFCLASS32 = 1;
+        static constexpr uint8_t ELFDATA2LSB = 1;
+        static constexpr uint8_t ELFDATA2MSB = 2;
+        static constexpr uint16_t ET_EXEC = 2;
+        static constexpr uint16_t ET_DYN = 3;
+        static constexpr uint16_t EM_MIPS = 8;
+        static constexpr uint32_t PT_LOAD = 1;
+
+        static constexpr uint32_t PF_X = 1;
+        static constexpr uint32_t PF_W = 2;
+        static constexpr uint32_t PF_R = 4;
+
+        static constexpr std::size_t HEADER_SIZE = 52;
+        static constexpr std::size_t PROGRAM_HEADER_SIZE = 32;
+
+        template <typename T>
+        inline T read_field(const uint8_t* data, const Endian endian) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return endian == Endian::e_little ? to_host<Endian::e_little>(value)
+                                              : to_host<Endian::e_big>(value);
+        }
+
+        [[nodiscard]] inline Result<void, ElfError>
+        parse(Span<const uint8_t> file, ElfImage& image) {
+            const uint8_t* data = file.get_data();
+            const std::size_t size = file.get_size();
+
+            if (size < HEADER_SIZE || data[0] != 0x7f || data[1] != 'E' ||
+                data[2] != 'L' || data[3] != 'F') {
+                return ElfError::invalid_header;
+            }
+
+            if (data[4] != ELFCLASS32) return ElfError::unsupported_format;
+            if (data[5] == ELFDATA2LSB) {
+                image.endian = Endian::e_little;
+            }
+            else if (data[5] == ELFDATA2MSB) {
+                image.endian = Endian::e_big;
+            }
+            else {
+                return ElfError::invalid_header;
+            }
+
+            const Endian endian = image.endian;
+            const uint16_t type = read_field<uint16_t>(data + 16, endian);
+            const uint16_t machine = read_field<uint16_t>(data + 18, endian);
+            if ((type != ET_EXEC && type != ET_DYN) || machine != EM_MIPS) {
+                return ElfError::unsupported_format;
+            }
+
+            image.entry = read_field<uint32_t>(data + 24, endian);
+
+            const uint32_t phoff = read_field<uint32_t>(data + 28, endian);
+            const uint16_t phentsize = read_field<uint16_t>(data + 42, endian);
+            const uint16_t phnum = read_field<uint16_t>(data + 44, endian);
+            if (phentsize < PROGRAM_HEADER_SIZE ||
+                phoff + static_cast<uint64_t>(phentsize) * phnum > size) {
+                return ElfError::invalid_header;
+            }
+
+            image.segments.clear();
+            for (uint16_t i = 0; i < phnum; ++i) {
+                const uint8_t* header = data + phoff + i * phentsize;
+                if (read_field<uint32_t>(header, endian) != PT_LOAD) continue;
+
+                ElfSegment segment;
+                segment.offset = read_field<uint32_t>(header + 4, endian);
+                segment.address = read_field<uint32_t>(header + 8, endian);
+                segment.file_size = read_field<uint32_t>(header + 16, endian);
+                segment.memory_size = read_field<uint32_t>(header + 20, endian);
+
+                const uint32_t flags =
+                    read_field<uint32_t>(header + 24, endian);
+                segment.perms = ((flags & PF_R) ? Permission::e_read : 0) |
+                                ((flags & PF_W) ? Permission::e_write : 0) |
+                                ((flags & PF_X) ? Permission::e_exec : 0);
+
+                if (segment.memory_size == 0) continue;
+                if (segment.file_size > segment.memory_size ||
+                    static_cast<uint64_t>(segment.offset) + segment.file_size >
+                        size ||
+                    static_cast<uint64_t>(segment.address) +
+                            segment.memory_size >
+                        (uint64_t(1) << 32)) {
+                    return ElfError::invalid_segment;
+                }
+
+                image.segments.push_back(segment);
+            }
+
+            // Segments have to be sorted and must not overlap
+            for (std::size_t i = 1; i < image.segments.size(); ++i) {
+                const ElfSegment& prev = image.segments[i - 1];
+                if (image.segments[i].address <
+                    static_cast<uint64_t>(prev.address) + prev.memory_size) {
+                    return ElfError::invalid_segment;
+                }
+            }
+
+            return {};
+        }
+
+        // Copies the segments into any kind of memory and sets the entry point
+        template <typename Memory>
+        [[nodiscard]] Result<uint32_t, ElfError>
+        load(Memory& memory, RegisterFile& reg_file, Span<const uint8_t> file) {
+            ElfImage image;
+            const auto parse_result = parse(file, image);
+            if (parse_result.is_error()) return parse_result.get_error();
+            if (image.endian != Memory::ENDIAN) {
+                return ElfError::endianness_mismatch;
+            }
+
+            for (const ElfSegment& segment : image.segments) {
+                const auto write_result = memory.write_block(
+                    segment.address,
+                    {file.get_data() + segment.offset, segment.file_size});
+                const auto fill_result =
+                    memory.fill(segment.address + segment.file_size,
+                                segment.memory_size - segment.file_size, 0);
+                if (write_result.is_error() || fill_result.is_error()) {
+                    return ElfError::load_failed;
+                }
+            }
+
+            reg_file.set_pc(image.entry);
+            return image.entry;
+        }
+
+        template <typename Memory>
+        [[nodiscard]] Result<uint32_t, ElfError>
+        load(Memory& memory, RegisterFile& reg_file, const char* path) {
+            std::ifstream stream(path, std::ios::binary);
+            if (!stream) return ElfError::open_failed;
+
+            const std::vector<uint8_t> file(
+                (std::istreambuf_iterator<char>(stream)),
+                std::istreambuf_iterator<char>());
+            return load(memory, reg_file, {file.data(), file.size()});
+        }
+
+        // Maps the pages of each segment and copies the segment into them
+        template <typename MMIOHandler, bool aligned_access, Endian endian>
+        [[nodiscard]] Result<uint32_t, ElfError>
+        load(PagedMemory<MMIOHandler, aligned_access, endian>& memory,
+             RegisterFile& reg_file, Span<const uint8_t> file) {
+            using Memory = PagedMemory<MMIOHandler, aligned_access, endian>;
+
+            ElfImage image;
+            const auto parse_result = parse(file, image);
+            if (parse_result.is_error()) return parse_result.get_error();
+            if (image.endian != endian) return ElfError::endianness_mismatch;
+
+            uint64_t mapped_end = 0;
+            for (const ElfSegment& segment : image.segments) {
+                uint64_t page = segment.address & ~Memory::PAGE_MASK;
+
+                // A page shared with the previous segment keeps its contents
+                // and gets the union of both segments' permissions
+                if (page < mapped_end) {
+                    const auto protect_result = memory.protect(
+                        page, Memory::PAGE_SIZE,
+                        memory.get_permissions(page) | segment.perms);
+                    if (protect_result.is_error()) return ElfError::load_failed;
+                    page += Memory::PAGE_SIZE;
+                }
+
+                const uint64_t end = static_cast<uint64_t>(segment.address) +
+                                     segment.memory_size;
+                const uint64_t pages_end =
+                    (end + Memory::PAGE_MASK) & ~uint64_t(Memory::PAGE_MASK);
+                if (page < pages_end) {
+                    const auto map_result =
+                        memory.map(page, pages_end - page, segment.perms);
+                    if (map_result.is_error()) return ElfError::load_failed;
+                }
+                mapped_end = pages_end;
+
+                // Bulk transfers bypass permissions, read only segments are
+                // written just the same
+                const auto write_result = memory.write_block(
+                    segment.address,
+                    {file.get_data() + segment.offset, segment.file_size});
+                const auto fill_result =
+                    memory.fill(segment.address + segment.file_size,
+                                segment.memory_size - segment.file_size, 0);
+                if (write_result.is_error() || fill_result.is_error()) {
+                    return ElfError::load_failed;
+                }
+            }
+
+            reg_file.set_pc(image.entry);
+            return image.entry;
+        }
+
+        // Maps the file into the guest without copying it.
+        //
+        // The file is mapped once copy-on-write and whole PT_LOAD pages are
+        // backed directly by it, so startup doesn't depend on the size of
+        // the binary and stores only ever touch private copies of pages.
+        // .bss is made of zero pages populated on first touch. The loader
+        // itself never writes into the file mapping: pages that need zeroing
+        // or are shared between two segments are copied instead, as are
+        // segments whose offset isn't page congruent with their address.
+        template <typename MMIOHandler, bool aligned_access, Endian endian>
+        [[nodiscard]] Result<uint32_t, ElfError>
+        load(PagedMemory<MMIOHandler, aligned_access, endian>& memory,
+             RegisterFile& reg_file, const char* path) {
+            using Memory = PagedMemory<MMIOHandler, aligned_access, endian>;
+            constexpr uint32_t PAGE_SIZE = Memory::PAGE_SIZE;
+            constexpr uint64_t PAGE_MASK = Memory::PAGE_MASK;
+
+            auto file =
+                MappedFile::open(path, MappedFile::Mode::e_copy_on_write);
+            if (file == nullptr) return ElfError::open_failed;
+
+            ElfImage image;
+            const auto parse_result =
+                parse({file->get_data(), file->get_size()}, image);
+            if (parse_result.is_error()) return parse_result.get_error();
+            if (image.endian != endian) return ElfError::endianness_mismatch;
+
+            const auto copy = [&](const uint64_t begin, const uint64_t end,
+                                  const ElfSegment& segment) {
+                if (begin >= end) return true;
+                const uint8_t* data = file->get_data() + segment.offset +
+                                      (begin - segment.address);
+                return !memory
+                            .write_block(static_cast<uint32_t>(begin),
+                                         {data, end - begin})
+                            .is_error();
+            };
+
+            uint64_t mapped_end = 0;
+            for (const ElfSegment& segment : image.segments) {
+                const uint64_t file_end =
+                    static_cast<uint64_t>(segment.address) + segment.file_size;
+                const uint64_t end = static_cast<uint64_t>(segment.address) +
+                                     segment.memory_size;
+                const uint64_t pages_end = (end + PAGE_MASK) & ~PAGE_MASK;
+
+                uint64_t page = segment.address & ~PAGE_MASK;
+                if (page < mapped_end) {
+                    // Shared with the previous segment, which may have mapped
+                    // it from the file
+                    const uint32_t address = static_cast<uint32_t>(page);
+                    uint8_t contents[PAGE_SIZE];
+                    const Permissions perms =
+                        memory.get_permissions(address) | segment.perms;
+
+                    const uint64_t page_end = page + PAGE_SIZE;
+                    const uint64_t zero_begin =
+                        std::max<uint64_t>(segment.address, file_end);
+                    const uint64_t zero_end = std::min(end, page_end);
+                    if (memory.read_block(address, {contents, PAGE_SIZE})
+                            .is_error()) {
+                        return ElfError::load_failed;
+                    }
+                    if (zero_begin < zero_end) {
+                        std::memset(contents + (zero_begin - page), 0,
+                                    zero_end - zero_begin);
+                    }
+
+                    if (memory.map(address, PAGE_SIZE, perms).is_error() ||
+                        memory.write_block(address, {contents, PAGE_SIZE})
+                            .is_error() ||
+                        !copy(segment.address, std::min(file_end, page_end),
+                              segment)) {
+                        return ElfError::load_failed;
+                    }
+                    page = page_end;
+                }
+                mapped_end = pages_end;
+                if (page >= pages_end) continue;
+
+                // Whole pages of file data are mapped in place, and so is a
+                // partial last page when no .bss has to be zeroed in it
+                uint64_t in_place_end = page;
+                if ((segment.address & PAGE_MASK) ==
+                        (segment.offset & PAGE_MASK) &&
+                    segment.file_size != 0) {
+                    const uint64_t file_pages_end =
+                        end == file_end ? pages_end : file_end & ~PAGE_MASK;
+                    in_place_end = std::max(page, file_pages_end);
+                }
+
+                if (page < in_place_end) {
+                    uint8_t* host = file->get_data() + segment.offset +
+                                    (page - segment.address);
+                    const auto map_result = memory.map_host(
+                        static_cast<uint32_t>(page), host,
+                        static_cast<uint32_t>(in_place_end - page),
+                        segment.perms, file);
+                    if (map_result.is_error()) return ElfError::load_failed;
+                }
+
+                if (in_place_end < pages_end) {
+                    const auto map_result = memory.map(
+                        static_cast<uint32_t>(in_place_end),
+                        static_cast<uint32_t>(pages_end - in_place_end),
+                        segment.perms);
+                    if (map_result.is_error() ||
+                        !copy(std::max<uint64_t>(segment.address, in_place_end),
+                              file_end, segment)) {
+                        return ElfError::load_failed;
+                    }
+                }
+            }
+
+            reg_file.set_pc(image.entry);
+            return image.entry;
+        }
+    } // namespace ElfLoader
+} // namespace mips_emulator
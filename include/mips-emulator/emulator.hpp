@@ -2,7 +2,9 @@
 #include "mips-emulator/instruction.hpp"
 #include "mips-emulator/executor.hpp"
 #include "mips-emulator/register_file.hpp"
+#include "mips-emulator/translation_cache.hpp"
 
+#include <memory>
 #include <utility>
 
 namespace mips_emulator {
@@ -15,14 +17,42 @@ namespace mips_emulator {
         const RegisterFile& get_register_file() const noexcept {
             return reg_file;
         }
+        RegisterFile& get_register_file() noexcept { return reg_file; }
         RegisterFile clone_register_file() const noexcept { return reg_file; }
 
-        [[nodiscard]] bool step() noexcept {
+        Memory& get_memory() noexcept { return memory; }
+
+        // Decodes through a cache shared with other instances running the
+        // same image. Backends with code protection drop translated pages
+        // the guest writes to, unless the guest is trusted to invalidate
+        // them itself with InvalidationMode::e_explicit.
+        void share_translations(std::shared_ptr<TranslationCache> cache,
+                                const InvalidationMode mode =
+                                    InvalidationMode::e_write_protect) {
+            translations =
+                std::make_unique<TranslationMap>(std::move(cache), mode);
+            if constexpr (HasCodeProtection<Memory>::value) {
+                memory.set_code_write_listener(
+                    mode == InvalidationMode::e_write_protect
+                        ? translations.get()
+                        : nullptr);
+            }
+        }
+
+        // Throws std::bad_alloc when a page can't be translated for lack of
+        // memory, once translations are shared
+        [[nodiscard]] bool step() {
+            if (translations) {
+                return Executor::step(reg_file, memory, *translations);
+            }
             return Executor::step(reg_file, memory);
         }
 
     private:
         RegisterFile reg_file;
         Memory memory;
+        // Kept on the heap, memory holds on to it as its listener when the
+        // emulator is moved
+        std::unique_ptr<TranslationMap> translations;
     };
 } // namespace mips_emulator
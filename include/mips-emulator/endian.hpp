@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#    include <cstdlib>
+#endif
+
+#if defined(__SSSE3__)
+#    include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#    include <arm_neon.h>
+#endif
+
+namespace mips_emulator {
+    enum class Endian {
+        e_little,
+        e_big,
+    };
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr Endian HOST_ENDIAN = Endian::e_big;
+#else
+    constexpr Endian HOST_ENDIAN = Endian::e_little;
+#endif
+
+    template <typename T>
+    inline T byte_swap(const T value) {
+        static_assert(std::is_integral_v<T>, "Can only byte swap integers");
+
+        using U = std::make_unsigned_t<T>;
+        const U bits = static_cast<U>(value);
+
+        if constexpr (sizeof(T) == 1) {
+            return value;
+        }
+        else if constexpr (sizeof(T) == 2) {
+#if defined(_MSC_VER)
+            return static_cast<T>(_byteswap_ushort(bits));
+#else
+            return static_cast<T>(__builtin_bswap16(bits));
+#endif
+        }
+        else {
+            static_assert(sizeof(T) == 4, "Unsupported byte swap size");
+#if defined(_MSC_VER)
+            return static_cast<T>(_byteswap_ulong(bits));
+#else
+            return static_cast<T>(__builtin_bswap32(bits));
+#endif
+        }
+    }
+
+    // Converts between guest and host byte order. Compiles to nothing when
+    // the guest has the same byte order as the host.
+    template <Endian endian, typename T>
+    inline T to_host(const T value) {
+        if constexpr (endian == HOST_ENDIAN) {
+            return value;
+        }
+        else {
+            return byte_swap(value);
+        }
+    }
+
+    template <Endian endian, typename T>
+    inline T from_host(const T value) {
+        return to_host<endian>(value);
+    }
+
+    // Copies host order words into guest memory in the guest byte order.
+    // The destination doesn't have to be aligned.
+    template <Endian endian>
+    inline void copy_words_from_host(uint8_t* dst, const uint32_t* src,
+                                     const std::size_t count) {
+        if constexpr (endian == HOST_ENDIAN) {
+            std::memcpy(dst, src, count * sizeof(uint32_t));
+        }
+        else {
+            std::size_t i = 0;
+
+#if defined(__SSSE3__)
+            const __m128i shuffle =
+                _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1,
+                             2, 3);
+            for (; i + 4 <= count; i += 4) {
+                const __m128i words = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(dst + i * sizeof(uint32_t)),
+                    _mm_shuffle_epi8(words, shuffle));
+            }
+#elif defined(__ARM_NEON)
+            for (; i + 4 <= count; i += 4) {
+                const uint8x16_t words =
+                    vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+                vst1q_u8(dst + i * sizeof(uint32_t), vrev32q_u8(words));
+            }
+#endif
+
+            // Remaining words, or all of them when there's no SIMD support
+            for (; i < count; ++i) {
+                const uint32_t word = byte_swap(src[i]);
+                std::memcpy(dst + i * sizeof(uint32_t), &word, sizeof(word));
+            }
+        }
+    }
+} // namespace mips_emulator
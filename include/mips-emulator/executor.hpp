@@ -1,5 +1,7 @@
 #pragma once
+#include "mips-emulator/decoded_image.hpp"
 #include "mips-emulator/instruction.hpp"
+#include "mips-emulator/translation_cache.hpp"
 #include "memory.hpp"
 #include "register_file.hpp"
 
@@ -19,16 +21,16 @@ namespace mips_emulator {
             using Register = RegisterFile::Register;
             using Func = Instruction::Func;
 
-            const Register rs = reg_file.get(instr.rtype.rs);
-            const Register rt = reg_file.get(instr.rtype.rt);
+            const Register rs = reg_file.get(instr.get_rs());
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const Func func = static_cast<Func>(instr.rtype.func);
+            const Func func = static_cast<Func>(instr.get_func());
 
             // SOP helper function
             // GPR[rd] <- shamt2 if shamt = 2 else shamt 3.
             auto sop_set_rd = [&](uint32_t shamt2, uint32_t shamt3) {
-                reg_file.set_signed(instr.rtype.rd,
-                                    instr.rtype.shamt == 2 ? shamt2 : shamt3);
+                reg_file.set_signed(instr.get_rd(),
+                                    instr.get_shamt() == 2 ? shamt2 : shamt3);
             };
 
             // Conditional Trap Helper function
@@ -41,19 +43,19 @@ namespace mips_emulator {
 
             switch (func) {
                 case Func::e_add: {
-                    reg_file.set_signed(instr.rtype.rd, rs.s + rt.s);
+                    reg_file.set_signed(instr.get_rd(), rs.s + rt.s);
                     break;
                 }
                 case Func::e_addu: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u + rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u + rt.u);
                     break;
                 }
                 case Func::e_sub: {
-                    reg_file.set_signed(instr.rtype.rd, rs.s - rt.s);
+                    reg_file.set_signed(instr.get_rd(), rs.s - rt.s);
                     break;
                 }
                 case Func::e_subu: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u - rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u - rt.u);
                     break;
                 }
                 case Func::e_sop30: { // Shamt: 2 = mul, 3 = muh
@@ -81,19 +83,19 @@ namespace mips_emulator {
                     break;
                 }
                 case Func::e_and: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u & rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u & rt.u);
                     break;
                 }
                 case Func::e_nor: {
-                    reg_file.set_unsigned(instr.rtype.rd, ~(rs.u | rt.u));
+                    reg_file.set_unsigned(instr.get_rd(), ~(rs.u | rt.u));
                     break;
                 }
                 case Func::e_or: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u | rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u | rt.u);
                     break;
                 }
                 case Func::e_xor: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u ^ rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u ^ rt.u);
                     break;
                 }
                 case Func::e_jr: {
@@ -101,11 +103,11 @@ namespace mips_emulator {
                     break;
                 }
                 case Func::e_slt: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.s < rt.s);
+                    reg_file.set_unsigned(instr.get_rd(), rs.s < rt.s);
                     break;
                 }
                 case Func::e_sltu: {
-                    reg_file.set_unsigned(instr.rtype.rd, rs.u < rt.u);
+                    reg_file.set_unsigned(instr.get_rd(), rs.u < rt.u);
                     break;
                 }
                 case Func::e_jalr: {
@@ -115,14 +117,14 @@ namespace mips_emulator {
                     break;
                 }
                 case Func::e_sll: {
-                    reg_file.set_unsigned(instr.rtype.rd,
-                                          rt.u << instr.rtype.shamt);
+                    reg_file.set_unsigned(instr.get_rd(),
+                                          rt.u << instr.get_shamt());
                     break;
                 }
                 case Func::e_sllv: {
                     // rt is shifted left by the number specified by the lower 5
                     // bits of rs and then stored in rd
-                    reg_file.set_unsigned(instr.rtype.rd,
+                    reg_file.set_unsigned(instr.get_rd(),
                                           rt.u << (rs.u & 0x1F));
                     break;
                 }
@@ -133,11 +135,11 @@ namespace mips_emulator {
                     const auto reg_bit_size =
                         (sizeof(RegisterFile::Unsigned) * 8);
                     const RegisterFile::Unsigned ext =
-                        (~0) << (reg_bit_size - instr.rtype.shamt);
+                        (~0) << (reg_bit_size - instr.get_shamt());
                     reg_file.set_unsigned(
-                        instr.rtype.rd,
+                        instr.get_rd(),
                         (ext * ((rt.u >> (reg_bit_size - 1)) & 1)) |
-                            rt.u >> instr.rtype.shamt);
+                            rt.u >> instr.get_shamt());
                     break;
                 }
                 case Func::e_srav: {
@@ -150,19 +152,19 @@ namespace mips_emulator {
                     const RegisterFile::Unsigned ext =
                         (~0) << (reg_bit_size - shift_amount);
                     reg_file.set_unsigned(
-                        instr.rtype.rd,
+                        instr.get_rd(),
                         (ext * ((rt.u >> (reg_bit_size - 1)) & 1)) |
                             rt.u >> shift_amount);
                     break;
                 }
                 case Func::e_srl: {
-                    auto res = rt.u >> instr.rtype.shamt;
+                    auto res = rt.u >> instr.get_shamt();
 
                     // ROTR: Rotate word if rs field & 1.
-                    if (instr.rtype.rs & 1)
-                        res |= (rt.u << (32 - instr.rtype.shamt));
+                    if (instr.get_rs() & 1)
+                        res |= (rt.u << (32 - instr.get_shamt()));
 
-                    reg_file.set_unsigned(instr.rtype.rd, res);
+                    reg_file.set_unsigned(instr.get_rd(), res);
                     break;
                 }
                 case Func::e_srlv: {
@@ -172,17 +174,17 @@ namespace mips_emulator {
                     auto res = rt.u >> shift;
 
                     // ROTRV: Rotate word if shamt & 1.
-                    if (instr.rtype.shamt & 1) res |= (rt.u << (32 - shift));
+                    if (instr.get_shamt() & 1) res |= (rt.u << (32 - shift));
 
-                    reg_file.set_unsigned(instr.rtype.rd, res);
+                    reg_file.set_unsigned(instr.get_rd(), res);
                     break;
                 }
                 case Func::e_seleqz: {
-                    reg_file.set_unsigned(instr.rtype.rd, rt.u ? 0 : rs.u);
+                    reg_file.set_unsigned(instr.get_rd(), rt.u ? 0 : rs.u);
                     break;
                 }
                 case Func::e_selnez: {
-                    reg_file.set_unsigned(instr.rtype.rd, rt.u ? rs.u : 0);
+                    reg_file.set_unsigned(instr.get_rd(), rt.u ? rs.u : 0);
                     break;
                 }
                 case Func::e_clz: {
@@ -196,7 +198,7 @@ namespace mips_emulator {
                         count++;
                         x <<= 1;
                     }
-                    reg_file.set_unsigned(instr.rtype.rd, count);
+                    reg_file.set_unsigned(instr.get_rd(), count);
                     break;
                 }
                 case Func::e_clo: {
@@ -210,7 +212,7 @@ namespace mips_emulator {
                         count++;
                         x <<= 1;
                     }
-                    reg_file.set_unsigned(instr.rtype.rd, count);
+                    reg_file.set_unsigned(instr.get_rd(), count);
                     break;
                 }
 
@@ -249,14 +251,14 @@ namespace mips_emulator {
             using Register = RegisterFile::Register;
             using IOp = Instruction::ITypeOpcode;
 
-            const Register rs = reg_file.get(instr.rtype.rs);
-            const Register rt = reg_file.get(instr.rtype.rt);
+            const Register rs = reg_file.get(instr.get_rs());
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const IOp op = static_cast<IOp>(instr.itype.op);
+            const IOp op = static_cast<IOp>(instr.get_opcode());
 
             // set PC after successful branch
             const uint32_t branch_target =
-                reg_file.get_pc() + (sign_ext_imm(instr.itype.imm) * 4);
+                reg_file.get_pc() + (sign_ext_imm(instr.get_imm()) * 4);
 
             switch (op) {
                 case IOp::e_beq: {
@@ -273,69 +275,69 @@ namespace mips_emulator {
                 }
 
                 case IOp::e_addiu: {
-                    reg_file.set_unsigned(instr.itype.rt,
-                                          rs.u + sign_ext_imm(instr.itype.imm));
+                    reg_file.set_unsigned(instr.get_rt(),
+                                          rs.u + sign_ext_imm(instr.get_imm()));
                     break;
                 }
                 case IOp::e_aui: {
                     reg_file.set_unsigned(
-                        instr.itype.rt,
-                        rs.u + sign_ext_imm(instr.itype.imm << 16));
+                        instr.get_rt(),
+                        rs.u + sign_ext_imm(instr.get_imm() << 16));
                     break;
                 }
                 case IOp::e_slti: {
                     reg_file.set_unsigned(
-                        instr.itype.rt,
+                        instr.get_rt(),
                         rs.s < (RegisterFile::Signed)sign_ext_imm(
-                                   instr.itype.imm));
+                                   instr.get_imm()));
                     break;
                 }
                 case IOp::e_sltiu: {
-                    reg_file.set_unsigned(instr.itype.rt,
-                                          rs.u < sign_ext_imm(instr.itype.imm));
+                    reg_file.set_unsigned(instr.get_rt(),
+                                          rs.u < sign_ext_imm(instr.get_imm()));
                     break;
                 }
                 case IOp::e_andi: {
-                    reg_file.set_unsigned(instr.itype.rt,
-                                          rs.u & instr.itype.imm);
+                    reg_file.set_unsigned(instr.get_rt(),
+                                          rs.u & instr.get_imm());
                     break;
                 }
                 case IOp::e_ori: {
-                    reg_file.set_unsigned(instr.itype.rt,
-                                          rs.u | instr.itype.imm);
+                    reg_file.set_unsigned(instr.get_rt(),
+                                          rs.u | instr.get_imm());
                     break;
                 }
                 case IOp::e_xori: {
-                    reg_file.set_unsigned(instr.itype.rt,
-                                          rs.u ^ instr.itype.imm);
+                    reg_file.set_unsigned(instr.get_rt(),
+                                          rs.u ^ instr.get_imm());
                     break;
                 }
 
                 //  HERE LIES MADNESS... i hate POP
                 case IOp::e_pop06: {
-                    if (instr.itype.rt == 0) {
+                    if (instr.get_rt() == 0) {
                         // BLEZ
                         if (rs.s <= 0) {
                             reg_file.delayed_branch(branch_target);
                         }
                     }
-                    else if (instr.itype.rs == 0 && instr.itype.rt != 0) {
+                    else if (instr.get_rs() == 0 && instr.get_rt() != 0) {
                         // BLEZALC
                         if (rt.s <= 0) {
                             reg_file.set_unsigned(31, reg_file.get_pc());
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs == instr.itype.rt &&
-                             instr.itype.rt != 0) {
+                    else if (instr.get_rs() == instr.get_rt() &&
+                             instr.get_rt() != 0) {
                         // BGEZALC
                         if (rt.s >= 0) {
                             reg_file.set_unsigned(31, reg_file.get_pc());
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != instr.itype.rt &&
-                             instr.itype.rs != 0 && instr.itype.rt != 0) {
+                    else if (instr.get_rs() != instr.get_rt() &&
+                             instr.get_rs() != 0 && instr.get_rt() != 0) {
                         // BGEUC
                         if (rs.u >= rt.u) {
                             reg_file.set_pc(branch_target);
@@ -344,29 +346,29 @@ namespace mips_emulator {
                     break;
                 }
                 case IOp::e_pop07: {
-                    if (instr.itype.rt == 0) {
+                    if (instr.get_rt() == 0) {
                         // BGTZ
                         if (rs.s > 0) {
                             reg_file.delayed_branch(branch_target);
                         }
                     }
-                    else if (instr.itype.rs == 0 && instr.itype.rt != 0) {
+                    else if (instr.get_rs() == 0 && instr.get_rt() != 0) {
                         // BGTZALC
                         if (rt.s > 0) {
                             reg_file.set_unsigned(31, reg_file.get_pc());
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs == instr.itype.rt &&
-                             instr.itype.rt != 0) {
+                    else if (instr.get_rs() == instr.get_rt() &&
+                             instr.get_rt() != 0) {
                         // BLTZALC
                         if (rt.s < 0) {
                             reg_file.set_unsigned(31, reg_file.get_pc());
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != instr.itype.rt &&
-                             instr.itype.rs != 0 && instr.itype.rt != 0) {
+                    else if (instr.get_rs() != instr.get_rt() &&
+                             instr.get_rs() != 0 && instr.get_rt() != 0) {
                         // BLTUC
                         if (rs.u < rt.u) {
                             reg_file.set_pc(branch_target);
@@ -376,21 +378,21 @@ namespace mips_emulator {
                 }
 
                 case IOp::e_pop10: {
-                    if (instr.itype.rs == 0 && instr.itype.rt != 0 &&
-                        instr.itype.rs < instr.itype.rt) { // rs < rt???????
+                    if (instr.get_rs() == 0 && instr.get_rt() != 0 &&
+                        instr.get_rs() < instr.get_rt()) { // rs < rt???????
                         // BEQZALC
                         if (!rt.u) {
                             reg_file.set_unsigned(31, reg_file.get_pc());
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rs <
-                                 instr.itype.rt) { // rs < rt???????
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rs() <
+                                 instr.get_rt()) { // rs < rt???????
                         // BEQC
                         if (rt.u == rs.u) reg_file.set_pc(branch_target);
                     }
-                    else if (instr.itype.rs >= instr.itype.rt) {
+                    else if (instr.get_rs() >= instr.get_rt()) {
                         // BOVC
 
                         const bool carry = rs.u + rt.u < rs.u;
@@ -401,8 +403,8 @@ namespace mips_emulator {
                     break;
                 }
                 case IOp::e_pop30: {
-                    if (instr.itype.rs == 0 && instr.itype.rt != 0 &&
-                        instr.itype.rs < instr.itype.rt) {
+                    if (instr.get_rs() == 0 && instr.get_rt() != 0 &&
+                        instr.get_rs() < instr.get_rt()) {
 
                         // BNEZALC
                         if (rt.u) {
@@ -410,12 +412,12 @@ namespace mips_emulator {
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rs < instr.itype.rt) {
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rs() < instr.get_rt()) {
                         // BNEC
                         if (rt.u != rs.u) reg_file.set_pc(branch_target);
                     }
-                    else if (instr.itype.rs >= instr.itype.rt) {
+                    else if (instr.get_rs() >= instr.get_rt()) {
                         // BNVC
                         const bool carry = rs.u + rt.u < rs.u;
                         const bool is_signed = ((rs.u + rt.u) & 0x80000000) > 0;
@@ -426,21 +428,21 @@ namespace mips_emulator {
                 }
 
                 case IOp::e_pop26: {
-                    if (instr.itype.rs == 0 && instr.itype.rt != 0) {
+                    if (instr.get_rs() == 0 && instr.get_rt() != 0) {
                         // BLEZC
                         if (rt.s <= 0) {
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rt == instr.itype.rs) {
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rt() == instr.get_rs()) {
                         // BGEZC
                         if (rt.s >= 0) {
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rt != instr.itype.rs) {
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rt() != instr.get_rs()) {
                         // BGEC
                         if (rs.s >= rt.s) {
                             reg_file.set_pc(branch_target);
@@ -449,21 +451,21 @@ namespace mips_emulator {
                     break;
                 }
                 case IOp::e_pop27: {
-                    if (instr.itype.rs == 0 && instr.itype.rt != 0) {
+                    if (instr.get_rs() == 0 && instr.get_rt() != 0) {
                         // BGTZC
                         if (rt.s > 0) {
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rt == instr.itype.rs) {
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rt() == instr.get_rs()) {
                         // BLTZC
                         if (rt.s < 0) {
                             reg_file.set_pc(branch_target);
                         }
                     }
-                    else if (instr.itype.rs != 0 && instr.itype.rt != 0 &&
-                             instr.itype.rt != instr.itype.rs) {
+                    else if (instr.get_rs() != 0 && instr.get_rt() != 0 &&
+                             instr.get_rt() != instr.get_rs()) {
                         // BLTC
                         if (rs.s < rt.s) {
                             reg_file.set_pc(branch_target);
@@ -474,18 +476,18 @@ namespace mips_emulator {
 
                 case IOp::e_pop66: {
 
-                    if (instr.itype.rs == 0) {
+                    if (instr.get_rs() == 0) {
                         // JIC
-                        reg_file.set_pc(reg_file.get(instr.itype.rt).u +
-                                        sign_ext_imm(instr.itype.imm));
+                        reg_file.set_pc(reg_file.get(instr.get_rt()).u +
+                                        sign_ext_imm(instr.get_imm()));
                     }
-                    else if (instr.longimm_itype.rs != 0) {
+                    else if (instr.get_rs() != 0) {
                         // BEQZC
-                        if (reg_file.get(instr.longimm_itype.rs).u == 0) {
+                        if (reg_file.get(instr.get_rs()).u == 0) {
 
                             reg_file.set_pc(
                                 reg_file.get_pc() +
-                                sign_ext_long_imm(instr.longimm_itype.imm) * 4);
+                                sign_ext_long_imm(instr.get_long_imm()) * 4);
                         }
                     }
 
@@ -493,19 +495,19 @@ namespace mips_emulator {
                 }
                 case IOp::e_pop76: {
 
-                    if (instr.itype.rs == 0) {
+                    if (instr.get_rs() == 0) {
                         // JIALC
                         reg_file.set_unsigned(31, reg_file.get_pc());
-                        reg_file.set_pc(reg_file.get(instr.itype.rt).u +
-                                        sign_ext_imm(instr.itype.imm));
+                        reg_file.set_pc(reg_file.get(instr.get_rt()).u +
+                                        sign_ext_imm(instr.get_imm()));
                     }
-                    else if (instr.longimm_itype.rs != 0) {
+                    else if (instr.get_rs() != 0) {
                         // BNEZC
-                        if (reg_file.get(instr.longimm_itype.rs).u != 0) {
+                        if (reg_file.get(instr.get_rs()).u != 0) {
 
                             reg_file.set_pc(
                                 reg_file.get_pc() +
-                                sign_ext_long_imm(instr.longimm_itype.imm) * 4);
+                                sign_ext_long_imm(instr.get_long_imm()) * 4);
                         }
                     }
 
@@ -524,41 +526,57 @@ namespace mips_emulator {
                            Memory& memory) {
             using Register = RegisterFile::Register;
             using IOp = Instruction::ITypeOpcode;
-            const Register rs = reg_file.get(instr.rtype.rs);
-            const Register rt = reg_file.get(instr.rtype.rt);
+            const Register rs = reg_file.get(instr.get_rs());
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const IOp op = static_cast<IOp>(instr.itype.op);
+            const IOp op = static_cast<IOp>(instr.get_opcode());
+
+            using Cause = RegisterFile::Exception;
 
             const auto store_val = [&](auto val) {
-                const uint32_t address = rs.u + sign_ext_imm(instr.itype.imm);
+                const uint32_t address = rs.u + sign_ext_imm(instr.get_imm());
                 auto store_result =
                     memory.template store<decltype(val)>(address, val);
 
-                return !store_result.is_error();
+                if (store_result.is_error()) {
+                    reg_file.signal_exception(Cause::e_ad_es, instr.raw,
+                                              address);
+                    return false;
+                }
+
+                return true;
             };
 
             // Use Unused Variable a for its type.
             const auto load_val = [&](auto a) {
-                const uint32_t address = rs.u + sign_ext_imm(instr.itype.imm);
+                const uint32_t address = rs.u + sign_ext_imm(instr.get_imm());
                 auto read_result = memory.template read<decltype(a)>(address);
 
-                if (read_result.is_error()) return false;
+                if (read_result.is_error()) {
+                    reg_file.signal_exception(Cause::e_ad_el, instr.raw,
+                                              address);
+                    return false;
+                }
 
                 reg_file.set_signed(
-                    instr.itype.rt,
+                    instr.get_rt(),
                     static_cast<int32_t>(read_result.get_value()));
 
                 return true;
             };
 
             const auto load_val_unsigned = [&](auto a) {
-                const uint32_t address = rs.u + sign_ext_imm(instr.itype.imm);
+                const uint32_t address = rs.u + sign_ext_imm(instr.get_imm());
                 auto read_result = memory.template read<decltype(a)>(address);
 
-                if (read_result.is_error()) return false;
+                if (read_result.is_error()) {
+                    reg_file.signal_exception(Cause::e_ad_el, instr.raw,
+                                              address);
+                    return false;
+                }
 
                 reg_file.set_unsigned(
-                    instr.itype.rt,
+                    instr.get_rt(),
                     static_cast<uint32_t>(read_result.get_value()));
 
                 return true;
@@ -589,11 +607,11 @@ namespace mips_emulator {
             using JOp = Instruction::JTypeOpcode;
             using Address = uint32_t;
 
-            const Address address = static_cast<Address>(instr.jtype.address);
+            const Address address = static_cast<Address>(instr.get_address());
             const Address jta = (Address)(address << 2) |
                                 (Address)(reg_file.get_pc() & (0xf << 28));
 
-            const JOp op = static_cast<JOp>(instr.jtype.op);
+            const JOp op = static_cast<JOp>(instr.get_opcode());
             switch (op) {
                 case JOp::e_j: {
                     reg_file.delayed_branch(jta);
@@ -631,9 +649,9 @@ namespace mips_emulator {
             using Register = typename RegisterFile::Register;
             using Func = Instruction::Special3BSHFLFunc;
 
-            const Register rt = reg_file.get(instr.special3_type_bshfl.rt);
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const auto func = static_cast<Func>(instr.special3_type_bshfl.func);
+            const auto func = static_cast<Func>(instr.get_bshfl_func());
 
             switch (func) {
                 case Func::e_bitswap: {
@@ -651,13 +669,13 @@ namespace mips_emulator {
                     for (int i = 0; i < sizeof(uint32_t); i++)
                         result |= reverse_byte_bits((rt.u >> i * 8)) << (i * 8);
 
-                    reg_file.set_unsigned(instr.special3_type_bshfl.rd, result);
+                    reg_file.set_unsigned(instr.get_rd(), result);
 
                     break;
                 }
                 case Func::e_wsbh: {
                     // Word Swap Bytes Within Halfwords
-                    reg_file.set_unsigned(instr.special3_type_bshfl.rd,
+                    reg_file.set_unsigned(instr.get_rd(),
                                           ((rt.u & 0xFF) << 8) |
                                               ((rt.u & 0xFF00) >> 8) |
                                               ((rt.u & 0xFF0000) << 8) |
@@ -674,30 +692,30 @@ namespace mips_emulator {
                     // Align is a special case were the func field is in reality
                     // 3 bits and the byte position is stored in the remaining 2
                     // lower bits
-                    const uint8_t bp = (instr.special3_type_bshfl.func & 0x3);
+                    const uint8_t bp = (instr.get_bshfl_func() & 0x3);
 
                     const Register rs =
-                        reg_file.get(instr.special3_type_bshfl.rs);
+                        reg_file.get(instr.get_rs());
 
                     // With bp = 0 align should act like a rd = rt register
                     // move, however right shifting by 32 doesn't return 0 so
                     // doing this
                     const auto lo = (bp == 0) ? 0 : (rs.u >> (8 * (4 - bp)));
 
-                    reg_file.set_unsigned(instr.special3_type_bshfl.rd,
+                    reg_file.set_unsigned(instr.get_rd(),
                                           (rt.u << (8 * bp)) | lo);
                     break;
                 }
                 case Func::e_seb: {
                     // Sign-extend Byte
-                    reg_file.set_unsigned(instr.special3_type_bshfl.rd,
+                    reg_file.set_unsigned(instr.get_rd(),
                                           (((~0U) << 8) * ((rt.u >> 7) & 1)) |
                                               (rt.u & 0xFF));
                     break;
                 }
                 case Func::e_seh: {
                     // Sign-extend Halfword
-                    reg_file.set_unsigned(instr.special3_type_bshfl.rd,
+                    reg_file.set_unsigned(instr.get_rd(),
                                           (((~0U) << 16) * ((rt.u >> 15) & 1)) |
                                               (rt.u & 0xFFFF));
                     break;
@@ -714,10 +732,10 @@ namespace mips_emulator {
                                        RegisterFile& reg_file) {
             using Register = typename RegisterFile::Register;
 
-            const Register rt = reg_file.get(instr.special3_type.rt);
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const uint32_t size = instr.special3_type_ext.msbd + 1;
-            const uint32_t lsb = instr.special3_type_ext.lsb;
+            const uint32_t size = instr.get_msb() + 1;
+            const uint32_t lsb = instr.get_lsb();
 
             // Error cases
             if (lsb >= 32 || size == 0 || size > 32 || lsb + size > 32)
@@ -725,8 +743,8 @@ namespace mips_emulator {
 
             const uint32_t mask = (size == 32) ? ~0 : ((1 << size) - 1) << lsb;
             const uint32_t bitfield =
-                (reg_file.get(instr.special3_type.rs).u & mask);
-            reg_file.set_unsigned(instr.special3_type.rt, bitfield >> lsb);
+                (reg_file.get(instr.get_rs()).u & mask);
+            reg_file.set_unsigned(instr.get_rt(), bitfield >> lsb);
 
             return true;
         }
@@ -737,10 +755,10 @@ namespace mips_emulator {
                                        RegisterFile& reg_file) {
             using Register = typename RegisterFile::Register;
 
-            const Register rt = reg_file.get(instr.special3_type.rt);
+            const Register rt = reg_file.get(instr.get_rt());
 
-            const uint32_t msb = instr.special3_type_ins.msb;
-            const uint32_t lsb = instr.special3_type_ins.lsb;
+            const uint32_t msb = instr.get_msb();
+            const uint32_t lsb = instr.get_lsb();
             const uint32_t size = msb - lsb + 1;
 
             // Error cases
@@ -749,12 +767,12 @@ namespace mips_emulator {
 
             // Mask out the lowest 'size' bits from rs register
             uint32_t mask = (size == 32) ? ~0 : (1 << size) - 1;
-            uint32_t bitfield = reg_file.get(instr.special3_type.rs).u & mask;
+            uint32_t bitfield = reg_file.get(instr.get_rs()).u & mask;
 
             // Shift mask to output position and insert bitfield
             mask = ~(mask << lsb);
             const uint32_t val = (rt.u & mask) | (bitfield << lsb);
-            reg_file.set_unsigned(instr.special3_type.rt, val);
+            reg_file.set_unsigned(instr.get_rt(), val);
 
             return true;
         }
@@ -766,15 +784,15 @@ namespace mips_emulator {
             using Register = RegisterFile::Register;
             using IOp = Instruction::RegimmITypeOp;
 
-            const Register rs = reg_file.get(instr.regimm_itype.rs);
+            const Register rs = reg_file.get(instr.get_rs());
 
-            const IOp op = static_cast<IOp>(instr.regimm_itype.op);
+            const IOp op = static_cast<IOp>(instr.get_regimm_op());
             switch (op) {
                 case IOp::e_bgez: {
                     if (rs.s >= 0) {
                         reg_file.delayed_branch(
                             reg_file.get_pc() +
-                            (sign_ext_imm(instr.itype.imm) * 4));
+                            (sign_ext_imm(instr.get_imm()) * 4));
                     }
                     break;
                 }
@@ -782,10 +800,15 @@ namespace mips_emulator {
                     if (rs.s < 0) {
                         reg_file.delayed_branch(
                             reg_file.get_pc() +
-                            (sign_ext_imm(instr.itype.imm) * 4));
+                            (sign_ext_imm(instr.get_imm()) * 4));
                     }
                     break;
                 }
+                case IOp::e_synci: {
+                    // Caches aren't modelled, decoded text is dropped by
+                    // the TranslationMap
+                    break;
+                }
 
                 default: return false;
             }
@@ -802,13 +825,13 @@ namespace mips_emulator {
             using Func = Instruction::PCRelFunc1;
 
             // Both instructions require the same address calculation
-            auto address = (static_cast<uint32_t>(instr.pcrel_type1.imm) << 2);
+            auto address = (static_cast<uint32_t>(instr.get_pcrel_imm()) << 2);
             // Sign extend
             address |= 1023 * ((address >> 21) & 1);
             // Add PC-value
             address += reg_file.get_pc();
 
-            const Func func = static_cast<Func>(instr.pcrel_type1.func);
+            const Func func = static_cast<Func>(instr.get_pcrel_func1());
             switch (func) {
                     /*
                       This instruction performs a PC-relative address
@@ -817,7 +840,7 @@ namespace mips_emulator {
                       ADDIUPC instruction. The result is placed in GPR rs.
                      */
                 case Func::e_addiupc: {
-                    reg_file.set_unsigned(instr.pcrel_type1.rs, address);
+                    reg_file.set_unsigned(instr.get_rs(), address);
                     break;
                 }
 
@@ -832,9 +855,14 @@ namespace mips_emulator {
                 case Func::e_lwpc: {
                     const auto read_result =
                         memory.template read<uint32_t>(address);
-                    if (read_result.is_error()) return false;
+                    if (read_result.is_error()) {
+                        reg_file.signal_exception(
+                            RegisterFile::Exception::e_ad_el, instr.raw,
+                            address);
+                        return false;
+                    }
 
-                    reg_file.set_unsigned(instr.pcrel_type1.rs,
+                    reg_file.set_unsigned(instr.get_rs(),
                                           read_result.get_value());
                     break;
                 }
@@ -853,10 +881,10 @@ namespace mips_emulator {
 
             // Both instructions require the same start of address calculation
             const auto address =
-                (static_cast<uint32_t>(instr.pcrel_type2.imm) << 16) +
+                (static_cast<uint32_t>(instr.get_imm()) << 16) +
                 reg_file.get_pc();
 
-            const Func func = static_cast<Func>(instr.pcrel_type2.func);
+            const Func func = static_cast<Func>(instr.get_pcrel_func2());
             switch (func) {
                     /*
                       This instruction performs a PC-relative address
@@ -868,7 +896,7 @@ namespace mips_emulator {
                      */
                 case Func::e_aluipc: {
                     // Store address but aligned to 64K boundary
-                    reg_file.set_unsigned(instr.pcrel_type2.rs,
+                    reg_file.set_unsigned(instr.get_rs(),
                                           address & 0xffff0000);
                     break;
                 }
@@ -880,7 +908,7 @@ namespace mips_emulator {
                       AUIPC instruction. The result is placed in GPR rs.
                      */
                 case Func::e_auipc: {
-                    reg_file.set_unsigned(instr.pcrel_type2.rs, address);
+                    reg_file.set_unsigned(instr.get_rs(), address);
                     break;
                 }
                 default: return false;
@@ -890,23 +918,12 @@ namespace mips_emulator {
         }
 
         template <typename Memory>
-        [[nodiscard]] inline static bool step(RegisterFile& reg_file,
-                                              Memory& memory) {
+        [[nodiscard]] inline static bool
+        execute(const Instruction instr, const Instruction::Type type,
+                RegisterFile& reg_file, Memory& memory) {
             using Type = Instruction::Type;
 
-            auto read_result =
-                memory.template read<uint32_t>(reg_file.get_pc());
-
-            if (read_result.is_error()) return false;
-            const auto instr = Instruction(read_result.get_value());
-
-            reg_file.update_pc();
-
-            const auto instr_type = instr.get_type();
-
-            if (instr_type.is_error()) return false;
-
-            switch (instr_type.get_value()) {
+            switch (type) {
                 case Type::e_rtype: return handle_rtype_instr(instr, reg_file);
                 case Type::e_itype:
                 case Type::e_longimm_itype:
@@ -932,6 +949,10 @@ namespace mips_emulator {
                     return handle_special3_type_ext_instr(instr, reg_file);
                 case Type::e_special3_type_ins:
                     return handle_special3_type_ins_instr(instr, reg_file);
+                case Type::e_special3_type_cache: {
+                    // Same as SYNCI, nothing to do but dropping decoded text
+                    return true;
+                }
 
                     // Regimm
                 case Type::e_regimm_itype:
@@ -946,5 +967,247 @@ namespace mips_emulator {
                 default: return false;
             }
         }
+
+        template <typename Memory>
+        [[nodiscard]] inline static bool step(RegisterFile& reg_file,
+                                              Memory& memory) {
+            auto read_result = memory.fetch(reg_file.get_pc());
+
+            if (read_result.is_error()) {
+                reg_file.signal_exception(RegisterFile::Exception::e_ad_el, 0,
+                                          reg_file.get_pc());
+                return false;
+            }
+            const auto instr = Instruction(read_result.get_value());
+
+            reg_file.update_pc();
+
+            const auto instr_type = instr.get_type();
+
+            if (instr_type.is_error()) return false;
+
+            return execute(instr, instr_type.get_value(), reg_file, memory);
+        }
+
+        // Steps using the pre-decoded image for instructions inside of it,
+        // falls back to fetching and decoding outside of it
+        template <typename Memory>
+        [[nodiscard]] inline static bool step(RegisterFile& reg_file,
+                                              Memory& memory,
+                                              const DecodedImage& image) {
+            const DecodedInstruction* decoded =
+                image.lookup(reg_file.get_pc());
+            if (decoded == nullptr) return step(reg_file, memory);
+
+            reg_file.update_pc();
+
+            if (!decoded->is_valid()) return false;
+
+            return execute(decoded->raw, decoded->get_type(), reg_file,
+                           memory);
+        }
+
+        // Drops the translations a SYNCI, CACHE or hazard barrier asks for.
+        // SYNCI and CACHE name a line of the page to drop, a hazard barrier
+        // drops every page since the lines written may not have been named.
+        inline static void synchronize(const DecodedInstruction& decoded,
+                                       const RegisterFile& reg_file,
+                                       TranslationMap& map) {
+            const Instruction instr(decoded.raw);
+            const uint32_t base = reg_file.get(instr.get_rs()).u;
+
+            switch (decoded.get_type()) {
+                case Instruction::Type::e_regimm_itype:
+                    map.invalidate(base + sign_ext_imm(instr.get_imm()));
+                    break;
+                case Instruction::Type::e_special3_type_cache: {
+                    // 9 bit offset above the function and a zero bit
+                    const uint32_t offset = (instr.raw >> 7) & 0x1ff;
+                    map.invalidate(base + ((offset ^ 0x100) - 0x100));
+                    break;
+                }
+                default: map.invalidate_all(); break;
+            }
+        }
+
+        // Performs the load or store op into or from rt through host, which
+        // points at its address inside of a window. Recompiled code passes a
+        // constant op, which leaves a single load or store.
+        template <Endian endian>
+        inline static void access_host(const Instruction::ITypeOpcode op,
+                                       const uint8_t rt,
+                                       RegisterFile& reg_file,
+                                       uint8_t* host) {
+            using IOp = Instruction::ITypeOpcode;
+
+            const auto load = [host](auto type) {
+                using T = decltype(type);
+                return to_host<endian>(*reinterpret_cast<const T*>(host));
+            };
+            const auto store = [host](auto value) {
+                using T = decltype(value);
+                *reinterpret_cast<T*>(host) = from_host<endian>(value);
+            };
+
+            const uint32_t value = reg_file.get(rt).u;
+            switch (op) {
+                case IOp::e_lb: reg_file.set_signed(rt, load(int8_t{})); break;
+                case IOp::e_lh: reg_file.set_signed(rt, load(int16_t{})); break;
+                case IOp::e_lw: reg_file.set_signed(rt, load(int32_t{})); break;
+                case IOp::e_lbu:
+                    reg_file.set_unsigned(rt, load(uint8_t{}));
+                    break;
+                case IOp::e_lhu:
+                    reg_file.set_unsigned(rt, load(uint16_t{}));
+                    break;
+                case IOp::e_sb: store(static_cast<uint8_t>(value)); break;
+                case IOp::e_sh: store(static_cast<uint16_t>(value)); break;
+                default: store(value); break;
+            }
+        }
+
+        // Performs the load or store op at address through the MMIO handler
+        // device, which serves all of the page. Declined accesses fault just
+        // as they do through read and store.
+        template <typename Device>
+        [[nodiscard]] inline static bool
+        access_device(const Instruction instr, const uint32_t address,
+                      RegisterFile& reg_file, Device& device) {
+            using IOp = Instruction::ITypeOpcode;
+            using Cause = RegisterFile::Exception;
+
+            const uint8_t rt = instr.get_rt();
+            const auto load = [&](auto type) -> bool {
+                using T = decltype(type);
+                const auto value = device.template read<T>(address);
+                if (!value.has_value()) {
+                    reg_file.signal_exception(Cause::e_ad_el, instr.raw,
+                                              address);
+                    return false;
+                }
+                if constexpr (std::is_signed_v<T>) {
+                    reg_file.set_signed(rt, value.value());
+                }
+                else {
+                    reg_file.set_unsigned(rt, value.value());
+                }
+                return true;
+            };
+            const auto store = [&](auto value) -> bool {
+                using T = decltype(value);
+                if (!device.template store<T>(address, value)) {
+                    reg_file.signal_exception(Cause::e_ad_es, instr.raw,
+                                              address);
+                    return false;
+                }
+                return true;
+            };
+
+            const uint32_t value = reg_file.get(rt).u;
+            switch (static_cast<IOp>(instr.get_opcode())) {
+                case IOp::e_lb: return load(int8_t{});
+                case IOp::e_lh: return load(int16_t{});
+                case IOp::e_lw: return load(int32_t{});
+                case IOp::e_lbu: return load(uint8_t{});
+                case IOp::e_lhu: return load(uint16_t{});
+                case IOp::e_sb: return store(static_cast<uint8_t>(value));
+                case IOp::e_sh: return store(static_cast<uint16_t>(value));
+                default: return store(value);
+            }
+        }
+
+        // Executes the load or store decoded through the window or device
+        // site holds for the page it hits, refilling the site when the page
+        // or the memory's generation changed. Either way read and store
+        // aren't asked again, only pages with neither go through execute.
+        template <typename Memory>
+        [[nodiscard]] inline static bool
+        access(const DecodedInstruction& decoded, RegisterFile& reg_file,
+               Memory& memory, AccessSite& site) {
+            using IOp = Instruction::ITypeOpcode;
+            constexpr Endian endian = Memory::ENDIAN;
+
+            const Instruction instr(decoded.raw);
+            const IOp op = static_cast<IOp>(instr.get_opcode());
+            const uint32_t address =
+                reg_file.get(instr.get_rs()).u + sign_ext_imm(instr.get_imm());
+
+            const uint64_t tag =
+                AccessSite::get_tag(address, memory.get_generation());
+            if (site.tag != tag) {
+                const uint32_t page = address & ~AccessSite::PAGE_MASK;
+                site.tag = tag;
+                site.host = memory.get_window(page, AccessSite::PAGE_SIZE,
+                                              op >= IOp::e_sb);
+                site.device = nullptr;
+                if constexpr (HasDeviceAccess<Memory>::value) {
+                    if (site.host == nullptr) {
+                        site.device =
+                            memory.get_device(page, AccessSite::PAGE_SIZE);
+                    }
+                }
+            }
+
+            uint32_t size = 4;
+            if (op == IOp::e_lb || op == IOp::e_lbu || op == IOp::e_sb) {
+                size = 1;
+            }
+            else if (op == IOp::e_lh || op == IOp::e_lhu || op == IOp::e_sh) {
+                size = 2;
+            }
+
+            // Faults and accesses straddling the page take the usual path
+            const uint32_t offset = address & AccessSite::PAGE_MASK;
+            bool fits = offset <= AccessSite::PAGE_SIZE - size;
+            if constexpr (Memory::ALIGNED_ACCESS) {
+                fits = fits && (address & (size - 1)) == 0;
+            }
+
+            if (fits && site.host != nullptr) {
+                access_host<endian>(op, instr.get_rt(), reg_file,
+                                    site.host + offset);
+                return true;
+            }
+            if constexpr (HasDeviceAccess<Memory>::value) {
+                using Device = std::remove_pointer_t<decltype(
+                    memory.get_device(uint32_t{}, uint32_t{}))>;
+                if (fits && site.device != nullptr) {
+                    return access_device(instr, address, reg_file,
+                                         *static_cast<Device*>(site.device));
+                }
+            }
+            return execute(instr, decoded.get_type(), reg_file, memory);
+        }
+
+        // Steps using the pages map shares with other instances, falls back
+        // to fetching and decoding on pages that can't be translated. Loads
+        // and stores go through their AccessSite on backends with windows.
+        template <typename Memory>
+        [[nodiscard]] inline static bool
+        step(RegisterFile& reg_file, Memory& memory, TranslationMap& map) {
+            const uint32_t address = reg_file.get_pc();
+            const DecodedInstruction* decoded = map.lookup(memory, address);
+            if (decoded == nullptr) return step(reg_file, memory);
+
+            reg_file.update_pc();
+
+            if (!decoded->is_valid()) return false;
+
+            if constexpr (HasAccessWindow<Memory>::value) {
+                if (decoded->flags & DecodeFlag::e_access) {
+                    return access(*decoded, reg_file, memory,
+                                  map.get_site(address));
+                }
+            }
+
+            // Pages outlive the map, decoded stays valid once dropped
+            if ((decoded->flags & DecodeFlag::e_sync) &&
+                map.get_mode() == InvalidationMode::e_explicit) {
+                synchronize(*decoded, reg_file, map);
+            }
+
+            return execute(decoded->raw, decoded->get_type(), reg_file,
+                           memory);
+        }
     }; // namespace Executor
 } // namespace mips_emulator
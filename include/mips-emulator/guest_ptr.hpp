@@ -0,0 +1,162 @@
+#pragma once
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/result.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mips_emulator {
+    // Typed view of a guest object for host code.
+    //
+    // The object's range is validated once when the view is created, after
+    // that members are accessed directly in host memory and converted from the
+    // guest byte order. Scalar members are loaded with get/set, struct members
+    // are reached through field which returns a view of the member.
+    //
+    // NOTE: Views hold a host pointer, so the whole range has to be backed by
+    // contiguous host memory. Objects straddling pages that PagedMemory
+    // allocated separately fail with MemoryError::discontiguous_range and
+    // have to be copied with read_block and write_block. Views are
+    // invalidated by anything that remaps the guest range. They don't go
+    // through the MMIO handler. Creating a view counts as a write to any
+    // code in its range, the CodeWriteListener is told then and not on
+    // later writes through it.
+    template <typename T, Endian endian = Endian::e_little>
+    class GuestPtr {
+    public:
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "GuestPtr can only view trivially copyable types");
+
+        using Address = uint32_t;
+
+        GuestPtr() = default;
+        GuestPtr(uint8_t* host, const Address address)
+            : host(host), address(address) {}
+
+        Address get_address() const noexcept { return address; }
+        uint8_t* get_host() const noexcept { return host; }
+
+        // NOTE: The member's class is deduced (and has to be T) so that these
+        // aren't formed for views of scalars
+        template <typename M, typename C>
+        M get(M C::*member) const {
+            return load_scalar<M>(member_ptr(member));
+        }
+
+        template <typename M, typename C>
+        void set(M C::*member, const M value) const {
+            store_scalar<M>(member_ptr(member), value);
+        }
+
+        template <typename M, typename C>
+        GuestPtr<M, endian> field(M C::*member) const {
+            uint8_t* ptr = member_ptr(member);
+            return {ptr, address + static_cast<Address>(ptr - host)};
+        }
+
+        // Whole object access is only available when no byte swapping is
+        // needed, or when the object is a scalar
+        T load() const {
+            static_assert(is_scalar || endian == HOST_ENDIAN,
+                          "Use get() for members of byte swapped structs");
+            return load_scalar<T>(host);
+        }
+
+        void store(const T& value) const {
+            static_assert(is_scalar || endian == HOST_ENDIAN,
+                          "Use set() for members of byte swapped structs");
+            store_scalar<T>(host, value);
+        }
+
+    private:
+        static constexpr bool is_scalar =
+            std::is_integral_v<T> || std::is_enum_v<T>;
+
+        template <typename M, typename C>
+        uint8_t* member_ptr(M C::*member) const {
+            static_assert(std::is_same_v<C, T>, "Member of a different type");
+            return reinterpret_cast<uint8_t*>(
+                &(reinterpret_cast<T*>(host)->*member));
+        }
+
+        template <typename M>
+        static M load_scalar(const uint8_t* ptr) {
+            M value;
+            std::memcpy(&value, ptr, sizeof(M));
+            return convert(value);
+        }
+
+        template <typename M>
+        static void store_scalar(uint8_t* ptr, const M value) {
+            const M converted = convert(value);
+            std::memcpy(ptr, &converted, sizeof(M));
+        }
+
+        template <typename M>
+        static M convert(const M value) {
+            if constexpr (endian == HOST_ENDIAN) {
+                return value;
+            }
+            else if constexpr (std::is_enum_v<M>) {
+                using U = std::underlying_type_t<M>;
+                return static_cast<M>(to_host<endian>(static_cast<U>(value)));
+            }
+            else {
+                static_assert(std::is_integral_v<M>,
+                              "Only scalar members can be byte swapped");
+                return to_host<endian>(value);
+            }
+        }
+
+        uint8_t* host;
+        Address address;
+    };
+
+    // Typed view of a guest array validated as a whole
+    template <typename T, Endian endian = Endian::e_little>
+    class GuestSpan {
+    public:
+        using Address = uint32_t;
+
+        GuestSpan() = default;
+        GuestSpan(uint8_t* host, const Address address, const uint32_t count)
+            : host(host), address(address), count(count) {}
+
+        Address get_address() const noexcept { return address; }
+        uint32_t get_size() const noexcept { return count; }
+
+        GuestPtr<T, endian> operator[](const uint32_t i) const {
+            return {host + i * sizeof(T),
+                    address + static_cast<Address>(i * sizeof(T))};
+        }
+
+    private:
+        uint8_t* host;
+        Address address;
+        uint32_t count;
+    };
+
+    template <typename T, typename Memory>
+    Result<GuestPtr<T, Memory::ENDIAN>, MemoryError>
+    guest_ptr(Memory& memory, const uint32_t address) {
+        const auto host = memory.ptr_from_range(address, sizeof(T));
+        if (host.is_error()) return host.get_error();
+
+        return GuestPtr<T, Memory::ENDIAN>(
+            static_cast<uint8_t*>(host.get_value()), address);
+    }
+
+    template <typename T, typename Memory>
+    Result<GuestSpan<T, Memory::ENDIAN>, MemoryError>
+    guest_span(Memory& memory, const uint32_t address, const uint32_t count) {
+        const auto host = memory.ptr_from_range(
+            address, static_cast<std::size_t>(count) * sizeof(T));
+        if (host.is_error()) return host.get_error();
+
+        return GuestSpan<T, Memory::ENDIAN>(
+            static_cast<uint8_t*>(host.get_value()), address, count);
+    }
+} // namespace mips_emulator
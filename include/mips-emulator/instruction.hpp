@@ -34,6 +34,7 @@ namespace mips_emulator {
             e_special3_type_bshfl,
             e_special3_type_ext,
             e_special3_type_ins,
+            e_special3_type_cache,
             e_regimm_itype,
             e_pcrel_type1,
             e_pcrel_type2,
@@ -184,6 +185,7 @@ namespace mips_emulator {
             e_ext = 0,
             e_ins = 0b000100,
             e_bshfl = 0b100000,
+            e_cache = 0b100101,
         };
 
         // Opcode enum for special3 bshfl instructions
@@ -205,6 +207,7 @@ namespace mips_emulator {
         enum class RegimmITypeOp : uint8_t {
             e_bgez = 1,
             e_bltz = 0,
+            e_synci = 0b11111,
         };
 
         // PC-relative functions
@@ -385,6 +388,9 @@ namespace mips_emulator {
         static constexpr uint8_t SPECIAL3_OPCODE = 31;
         static constexpr uint8_t PCREL_OPCODE = 59;
 
+        // Hint of JR.HB and JALR.HB, in the shamt field
+        static constexpr uint8_t HAZARD_BARRIER_HINT = 0b10000;
+
         // R-Type
         Instruction(const Func func, const RegisterName rd,
                     const RegisterName rs, const RegisterName rt,
@@ -457,7 +463,7 @@ namespace mips_emulator {
         }
 
         // raw
-        Instruction(const uint32_t value) { raw = value; }
+        constexpr Instruction(const uint32_t value) : raw(value) {}
 
         // Special3
         Instruction(const Special3Func func, const Special3BSHFLFunc op,
@@ -518,8 +524,43 @@ namespace mips_emulator {
             pcrel_type2.imm = immediate;
         }
 
-        inline Result<Type, void> get_type() const {
-            switch (general.op) {
+        // Field accessors. Fields are extracted with explicit shifts and
+        // masks, which doesn't depend on the implementation defined bit field
+        // layout and compiles to a shift and an and at most.
+        constexpr uint8_t get_opcode() const { return raw >> 26; }
+        constexpr uint8_t get_rs() const { return (raw >> 21) & 0x1f; }
+        constexpr uint8_t get_rt() const { return (raw >> 16) & 0x1f; }
+        constexpr uint8_t get_rd() const { return (raw >> 11) & 0x1f; }
+        constexpr uint8_t get_shamt() const { return (raw >> 6) & 0x1f; }
+        constexpr uint8_t get_func() const { return raw & 0x3f; }
+
+        // Immediates of the I-Type, long immediate I-Type and J-Type forms
+        constexpr uint16_t get_imm() const { return raw & 0xffff; }
+        constexpr uint32_t get_long_imm() const { return raw & 0x1fffff; }
+        constexpr uint32_t get_address() const { return raw & 0x3ffffff; }
+
+        // Regimm operation, in the rt field
+        constexpr uint8_t get_regimm_op() const { return get_rt(); }
+
+        // Special3 fields, BSHFL operation or EXT/INS lsb in the shamt field
+        // and EXT msbd or INS msb in the rd field
+        constexpr uint8_t get_bshfl_func() const { return get_shamt(); }
+        constexpr uint8_t get_lsb() const { return get_shamt(); }
+        constexpr uint8_t get_msb() const { return get_rd(); }
+
+        // PC relative forms
+        constexpr uint32_t get_pcrel_imm() const { return raw & 0x7ffff; }
+        constexpr uint8_t get_pcrel_func1() const { return (raw >> 19) & 0b11; }
+        constexpr uint8_t get_pcrel_func2() const { return get_rt(); }
+
+        inline Result<Type, void> get_type() const { return decode_type(raw); }
+
+        // Type of a raw instruction word, usable in constant expressions
+        static constexpr Result<Type, void> decode_type(const uint32_t word) {
+            const uint8_t op = word >> 26;
+            const uint8_t rs = (word >> 21) & 0x1f;
+
+            switch (op) {
                     // R-Type
                 case RTYPE_OPCODE:
                     return Type::e_rtype;
@@ -563,20 +604,22 @@ namespace mips_emulator {
 
                     // Special3
                 case SPECIAL3_OPCODE: {
-                    switch (static_cast<Special3Func>(special3_type.func)) {
+                    switch (static_cast<Special3Func>(word & 0x3f)) {
                         case Special3Func::e_bshfl:
                             return Type::e_special3_type_bshfl;
                         case Special3Func::e_ext:
                             return Type::e_special3_type_ext;
                         case Special3Func::e_ins:
                             return Type::e_special3_type_ins;
+                        case Special3Func::e_cache:
+                            return Type::e_special3_type_cache;
                     }
                     break;
                 }
 
                     // PC relative
                 case PCREL_OPCODE: {
-                    if ((pcrel_type1.func & 0b10) == 0) {
+                    if (((word >> 19) & 0b10) == 0) {
                         return Type::e_pcrel_type1;
                     }
                     else {
@@ -586,15 +629,15 @@ namespace mips_emulator {
 
                     // Coprocessor 1
                 case 17: {
-                    if (fpu_rtype.fmt & 0b10000) return Type::e_fpu_rtype;
+                    if (rs & 0b10000) return Type::e_fpu_rtype;
 
-                    if (fpu_rtype.fmt & 0b01000) return Type::e_fpu_btype;
+                    if (rs & 0b01000) return Type::e_fpu_btype;
 
                     return Type::e_fpu_ttype;
                 }
                 case 62:
                 case 54:
-                    if (itype.rs != 0) {
+                    if (rs != 0) {
                         return Type::e_longimm_itype;
                     }
                     else {
@@ -0,0 +1,541 @@
+#pragma once
+#include "mips-emulator/instruction.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace mips_emulator {
+    // Every operation the executor implements. Encodings that share an
+    // opcode or function, such as the POP branches or MUL/MUH, get an
+    // operation each.
+    enum class Op : uint8_t {
+        e_invalid,
+
+        // R-Type
+        e_add,
+        e_addu,
+        e_sub,
+        e_subu,
+        e_mul,
+        e_muh,
+        e_mulu,
+        e_muhu,
+        e_div,
+        e_mod,
+        e_divu,
+        e_modu,
+        e_and,
+        e_or,
+        e_xor,
+        e_nor,
+        e_slt,
+        e_sltu,
+        e_seleqz,
+        e_selnez,
+        e_sll,
+        e_srl,
+        e_rotr,
+        e_sra,
+        e_sllv,
+        e_srlv,
+        e_rotrv,
+        e_srav,
+        e_clz,
+        e_clo,
+        e_jr,
+        e_jalr,
+        e_teq,
+        e_tge,
+        e_tgeu,
+        e_tlt,
+        e_tltu,
+        e_tne,
+
+        // I-Type
+        e_addiu,
+        e_slti,
+        e_sltiu,
+        e_andi,
+        e_ori,
+        e_xori,
+        e_aui,
+        e_lb,
+        e_lbu,
+        e_lh,
+        e_lhu,
+        e_lw,
+        e_sb,
+        e_sh,
+        e_sw,
+
+        // Branches with delay slots
+        e_beq,
+        e_bne,
+        e_blez,
+        e_bgtz,
+        e_bgez,
+        e_bltz,
+        e_j,
+        e_jal,
+
+        // Compact branches
+        e_blezalc,
+        e_bgezalc,
+        e_bgeuc,
+        e_bgtzalc,
+        e_bltzalc,
+        e_bltuc,
+        e_beqzalc,
+        e_beqc,
+        e_bovc,
+        e_bnezalc,
+        e_bnec,
+        e_bnvc,
+        e_blezc,
+        e_bgezc,
+        e_bgec,
+        e_bgtzc,
+        e_bltzc,
+        e_bltc,
+        e_beqzc,
+        e_bnezc,
+        e_jic,
+        e_jialc,
+        e_bc,
+        e_balc,
+
+        // PC relative
+        e_addiupc,
+        e_lwpc,
+        e_auipc,
+        e_aluipc,
+
+        // Special3
+        e_bitswap,
+        e_wsbh,
+        e_seb,
+        e_seh,
+        e_align,
+        e_ext,
+        e_ins,
+
+        // Cache maintenance
+        e_synci,
+        e_cache,
+
+        e_count,
+    };
+
+    constexpr std::size_t OP_COUNT = static_cast<std::size_t>(Op::e_count);
+
+    // Register fields an operation reads or writes
+    namespace Operand {
+        constexpr uint8_t e_rs = 1 << 0;
+        constexpr uint8_t e_rt = 1 << 1;
+        constexpr uint8_t e_rd = 1 << 2;
+        // Implicit $ra of the linking branches
+        constexpr uint8_t e_ra = 1 << 3;
+    } // namespace Operand
+
+    namespace OpFlag {
+        // Any control transfer
+        constexpr uint16_t e_branch = 1 << 0;
+        constexpr uint16_t e_delay_slot = 1 << 1;
+        // Branch without a delay slot
+        constexpr uint16_t e_compact = 1 << 2;
+        constexpr uint16_t e_conditional = 1 << 3;
+        // Target comes from a register
+        constexpr uint16_t e_indirect = 1 << 4;
+        // Writes the return address to $ra
+        constexpr uint16_t e_link = 1 << 5;
+        constexpr uint16_t e_load = 1 << 6;
+        constexpr uint16_t e_store = 1 << 7;
+        // May raise an exception or otherwise fail to execute
+        constexpr uint16_t e_trap = 1 << 8;
+        // Reads the address of the instruction
+        constexpr uint16_t e_pc_relative = 1 << 9;
+    } // namespace OpFlag
+
+    struct OpInfo {
+        std::string_view name;
+        // Operand bits
+        uint8_t reads;
+        uint8_t writes;
+        // OpFlag bits
+        uint16_t flags;
+        // Bytes loaded or stored, 0 for operations without memory accesses
+        uint8_t access_size;
+
+        constexpr bool is_branch() const noexcept {
+            return flags & OpFlag::e_branch;
+        }
+        constexpr bool has_delay_slot() const noexcept {
+            return flags & OpFlag::e_delay_slot;
+        }
+        constexpr bool is_compact() const noexcept {
+            return flags & OpFlag::e_compact;
+        }
+        constexpr bool accesses_memory() const noexcept {
+            return flags & (OpFlag::e_load | OpFlag::e_store);
+        }
+        constexpr bool can_trap() const noexcept {
+            return flags & OpFlag::e_trap;
+        }
+    };
+
+    namespace OpInfoTable {
+        constexpr std::array<OpInfo, OP_COUNT> build() {
+            using namespace Operand;
+            using namespace OpFlag;
+
+            constexpr uint16_t DELAYED = e_branch | e_delay_slot;
+            constexpr uint16_t COMPACT = e_branch | e_compact;
+            constexpr uint16_t COND_DELAYED = DELAYED | e_conditional;
+            constexpr uint16_t COND_COMPACT = COMPACT | e_conditional;
+            constexpr uint16_t COND_LINK = COND_COMPACT | e_link;
+
+            std::array<OpInfo, OP_COUNT> table = {};
+            const auto set = [&table](const Op op, const std::string_view name,
+                                      const uint8_t reads,
+                                      const uint8_t writes,
+                                      const uint16_t flags = 0,
+                                      const uint8_t access_size = 0) {
+                table[static_cast<std::size_t>(op)] = {name, reads, writes,
+                                                       flags, access_size};
+            };
+
+            set(Op::e_invalid, "invalid", 0, 0, e_trap);
+
+            // ADD and SUB trap on overflow
+            set(Op::e_add, "add", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_addu, "addu", e_rs | e_rt, e_rd);
+            set(Op::e_sub, "sub", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_subu, "subu", e_rs | e_rt, e_rd);
+            set(Op::e_mul, "mul", e_rs | e_rt, e_rd);
+            set(Op::e_muh, "muh", e_rs | e_rt, e_rd);
+            set(Op::e_mulu, "mulu", e_rs | e_rt, e_rd);
+            set(Op::e_muhu, "muhu", e_rs | e_rt, e_rd);
+            // Division by zero stops the executor
+            set(Op::e_div, "div", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_mod, "mod", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_divu, "divu", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_modu, "modu", e_rs | e_rt, e_rd, e_trap);
+            set(Op::e_and, "and", e_rs | e_rt, e_rd);
+            set(Op::e_or, "or", e_rs | e_rt, e_rd);
+            set(Op::e_xor, "xor", e_rs | e_rt, e_rd);
+            set(Op::e_nor, "nor", e_rs | e_rt, e_rd);
+            set(Op::e_slt, "slt", e_rs | e_rt, e_rd);
+            set(Op::e_sltu, "sltu", e_rs | e_rt, e_rd);
+            set(Op::e_seleqz, "seleqz", e_rs | e_rt, e_rd);
+            set(Op::e_selnez, "selnez", e_rs | e_rt, e_rd);
+            set(Op::e_sll, "sll", e_rt, e_rd);
+            set(Op::e_srl, "srl", e_rt, e_rd);
+            set(Op::e_rotr, "rotr", e_rt, e_rd);
+            set(Op::e_sra, "sra", e_rt, e_rd);
+            set(Op::e_sllv, "sllv", e_rs | e_rt, e_rd);
+            set(Op::e_srlv, "srlv", e_rs | e_rt, e_rd);
+            set(Op::e_rotrv, "rotrv", e_rs | e_rt, e_rd);
+            set(Op::e_srav, "srav", e_rs | e_rt, e_rd);
+            set(Op::e_clz, "clz", e_rs, e_rd);
+            set(Op::e_clo, "clo", e_rs, e_rd);
+            set(Op::e_jr, "jr", e_rs, 0, DELAYED | e_indirect);
+            // The executor always links to $ra
+            set(Op::e_jalr, "jalr", e_rs, e_ra, DELAYED | e_indirect | e_link);
+            set(Op::e_teq, "teq", e_rs | e_rt, 0, e_trap);
+            set(Op::e_tge, "tge", e_rs | e_rt, 0, e_trap);
+            set(Op::e_tgeu, "tgeu", e_rs | e_rt, 0, e_trap);
+            set(Op::e_tlt, "tlt", e_rs | e_rt, 0, e_trap);
+            set(Op::e_tltu, "tltu", e_rs | e_rt, 0, e_trap);
+            set(Op::e_tne, "tne", e_rs | e_rt, 0, e_trap);
+
+            set(Op::e_addiu, "addiu", e_rs, e_rt);
+            set(Op::e_slti, "slti", e_rs, e_rt);
+            set(Op::e_sltiu, "sltiu", e_rs, e_rt);
+            set(Op::e_andi, "andi", e_rs, e_rt);
+            set(Op::e_ori, "ori", e_rs, e_rt);
+            set(Op::e_xori, "xori", e_rs, e_rt);
+            set(Op::e_aui, "aui", e_rs, e_rt);
+            set(Op::e_lb, "lb", e_rs, e_rt, e_load | e_trap, 1);
+            set(Op::e_lbu, "lbu", e_rs, e_rt, e_load | e_trap, 1);
+            set(Op::e_lh, "lh", e_rs, e_rt, e_load | e_trap, 2);
+            set(Op::e_lhu, "lhu", e_rs, e_rt, e_load | e_trap, 2);
+            set(Op::e_lw, "lw", e_rs, e_rt, e_load | e_trap, 4);
+            set(Op::e_sb, "sb", e_rs | e_rt, 0, e_store | e_trap, 1);
+            set(Op::e_sh, "sh", e_rs | e_rt, 0, e_store | e_trap, 2);
+            set(Op::e_sw, "sw", e_rs | e_rt, 0, e_store | e_trap, 4);
+
+            set(Op::e_beq, "beq", e_rs | e_rt, 0, COND_DELAYED);
+            set(Op::e_bne, "bne", e_rs | e_rt, 0, COND_DELAYED);
+            set(Op::e_blez, "blez", e_rs, 0, COND_DELAYED);
+            set(Op::e_bgtz, "bgtz", e_rs, 0, COND_DELAYED);
+            set(Op::e_bgez, "bgez", e_rs, 0, COND_DELAYED);
+            set(Op::e_bltz, "bltz", e_rs, 0, COND_DELAYED);
+            set(Op::e_j, "j", 0, 0, DELAYED);
+            set(Op::e_jal, "jal", 0, e_ra, DELAYED | e_link);
+
+            set(Op::e_blezalc, "blezalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_bgezalc, "bgezalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_bgeuc, "bgeuc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_bgtzalc, "bgtzalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_bltzalc, "bltzalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_bltuc, "bltuc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_beqzalc, "beqzalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_beqc, "beqc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_bovc, "bovc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_bnezalc, "bnezalc", e_rt, e_ra, COND_LINK);
+            set(Op::e_bnec, "bnec", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_bnvc, "bnvc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_blezc, "blezc", e_rt, 0, COND_COMPACT);
+            set(Op::e_bgezc, "bgezc", e_rt, 0, COND_COMPACT);
+            set(Op::e_bgec, "bgec", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_bgtzc, "bgtzc", e_rt, 0, COND_COMPACT);
+            set(Op::e_bltzc, "bltzc", e_rt, 0, COND_COMPACT);
+            set(Op::e_bltc, "bltc", e_rs | e_rt, 0, COND_COMPACT);
+            set(Op::e_beqzc, "beqzc", e_rs, 0, COND_COMPACT);
+            set(Op::e_bnezc, "bnezc", e_rs, 0, COND_COMPACT);
+            set(Op::e_jic, "jic", e_rt, 0, COMPACT | e_indirect);
+            set(Op::e_jialc, "jialc", e_rt, e_ra,
+                COMPACT | e_indirect | e_link);
+            set(Op::e_bc, "bc", 0, 0, COMPACT);
+            set(Op::e_balc, "balc", 0, e_ra, COMPACT | e_link);
+
+            set(Op::e_addiupc, "addiupc", 0, e_rs, e_pc_relative);
+            set(Op::e_lwpc, "lwpc", 0, e_rs,
+                e_pc_relative | e_load | e_trap, 4);
+            set(Op::e_auipc, "auipc", 0, e_rs, e_pc_relative);
+            set(Op::e_aluipc, "aluipc", 0, e_rs, e_pc_relative);
+
+            set(Op::e_bitswap, "bitswap", e_rt, e_rd);
+            set(Op::e_wsbh, "wsbh", e_rt, e_rd);
+            set(Op::e_seb, "seb", e_rt, e_rd);
+            set(Op::e_seh, "seh", e_rt, e_rd);
+            set(Op::e_align, "align", e_rs | e_rt, e_rd);
+            // Invalid bit ranges stop the executor
+            set(Op::e_ext, "ext", e_rs, e_rt, e_trap);
+            set(Op::e_ins, "ins", e_rs | e_rt, e_rt, e_trap);
+
+            // Only read their base, caches aren't modelled
+            set(Op::e_synci, "synci", e_rs, 0);
+            set(Op::e_cache, "cache", e_rs, 0);
+
+            return table;
+        }
+    } // namespace OpInfoTable
+
+    constexpr std::array<OpInfo, OP_COUNT> OP_INFO = OpInfoTable::build();
+
+    constexpr const OpInfo& get_op_info(const Op op) {
+        return OP_INFO[static_cast<std::size_t>(op)];
+    }
+
+    // Operation of a raw instruction word. Encodings are told apart the same
+    // way the executor does, Op::e_invalid for anything it doesn't execute.
+    constexpr Op decode_op(const uint32_t word) {
+        using Func = Instruction::Func;
+        using IOp = Instruction::ITypeOpcode;
+        using JOp = Instruction::JTypeOpcode;
+
+        const uint8_t opcode = word >> 26;
+        const uint8_t rs = (word >> 21) & 0x1f;
+        const uint8_t rt = (word >> 16) & 0x1f;
+        const uint8_t shamt = (word >> 6) & 0x1f;
+        const uint8_t func = word & 0x3f;
+
+        // SOP encodings select with shamt 2 or 3
+        const auto sop = [shamt](const Op low, const Op high) {
+            return shamt == 2 ? low : high;
+        };
+
+        switch (opcode) {
+            case Instruction::RTYPE_OPCODE: {
+                switch (static_cast<Func>(func)) {
+                    case Func::e_add: return Op::e_add;
+                    case Func::e_addu: return Op::e_addu;
+                    case Func::e_sub: return Op::e_sub;
+                    case Func::e_subu: return Op::e_subu;
+                    case Func::e_sop30: return sop(Op::e_mul, Op::e_muh);
+                    case Func::e_sop31: return sop(Op::e_mulu, Op::e_muhu);
+                    case Func::e_sop32: return sop(Op::e_div, Op::e_mod);
+                    case Func::e_sop33: return sop(Op::e_divu, Op::e_modu);
+                    case Func::e_and: return Op::e_and;
+                    case Func::e_or: return Op::e_or;
+                    case Func::e_xor: return Op::e_xor;
+                    case Func::e_nor: return Op::e_nor;
+                    case Func::e_slt: return Op::e_slt;
+                    case Func::e_sltu: return Op::e_sltu;
+                    case Func::e_seleqz: return Op::e_seleqz;
+                    case Func::e_selnez: return Op::e_selnez;
+                    case Func::e_sll: return Op::e_sll;
+                    case Func::e_srl: return rs & 1 ? Op::e_rotr : Op::e_srl;
+                    case Func::e_sra: return Op::e_sra;
+                    case Func::e_sllv: return Op::e_sllv;
+                    case Func::e_srlv:
+                        return shamt & 1 ? Op::e_rotrv : Op::e_srlv;
+                    case Func::e_srav: return Op::e_srav;
+                    case Func::e_clz: return Op::e_clz;
+                    case Func::e_clo: return Op::e_clo;
+                    case Func::e_jr: return Op::e_jr;
+                    case Func::e_jalr: return Op::e_jalr;
+                    case Func::e_teq: return Op::e_teq;
+                    case Func::e_tge: return Op::e_tge;
+                    case Func::e_tgeu: return Op::e_tgeu;
+                    case Func::e_tlt: return Op::e_tlt;
+                    case Func::e_tltu: return Op::e_tltu;
+                    case Func::e_tne: return Op::e_tne;
+                }
+                return Op::e_invalid;
+            }
+
+            case Instruction::REGIMM_OPCODE: {
+                using RegimmOp = Instruction::RegimmITypeOp;
+                switch (static_cast<RegimmOp>(rt)) {
+                    case RegimmOp::e_bgez: return Op::e_bgez;
+                    case RegimmOp::e_bltz: return Op::e_bltz;
+                    case RegimmOp::e_synci: return Op::e_synci;
+                }
+                return Op::e_invalid;
+            }
+
+            case Instruction::SPECIAL3_OPCODE: {
+                using Special3Func = Instruction::Special3Func;
+                using BSHFLFunc = Instruction::Special3BSHFLFunc;
+                switch (static_cast<Special3Func>(func)) {
+                    case Special3Func::e_ext: return Op::e_ext;
+                    case Special3Func::e_ins: return Op::e_ins;
+                    case Special3Func::e_cache: return Op::e_cache;
+                    case Special3Func::e_bshfl: {
+                        switch (static_cast<BSHFLFunc>(shamt)) {
+                            case BSHFLFunc::e_bitswap: return Op::e_bitswap;
+                            case BSHFLFunc::e_wsbh: return Op::e_wsbh;
+                            case BSHFLFunc::e_seb: return Op::e_seb;
+                            case BSHFLFunc::e_seh: return Op::e_seh;
+                            case BSHFLFunc::e_align_0:
+                            case BSHFLFunc::e_align_1:
+                            case BSHFLFunc::e_align_2:
+                            case BSHFLFunc::e_align_3: return Op::e_align;
+                        }
+                        return Op::e_invalid;
+                    }
+                }
+                return Op::e_invalid;
+            }
+
+            case Instruction::PCREL_OPCODE: {
+                using PCRelFunc1 = Instruction::PCRelFunc1;
+                using PCRelFunc2 = Instruction::PCRelFunc2;
+                switch (static_cast<PCRelFunc1>((word >> 19) & 0b11)) {
+                    case PCRelFunc1::e_addiupc: return Op::e_addiupc;
+                    case PCRelFunc1::e_lwpc: return Op::e_lwpc;
+                }
+                switch (static_cast<PCRelFunc2>(rt)) {
+                    case PCRelFunc2::e_auipc: return Op::e_auipc;
+                    case PCRelFunc2::e_aluipc: return Op::e_aluipc;
+                }
+                return Op::e_invalid;
+            }
+
+            default: break;
+        }
+
+        switch (static_cast<JOp>(opcode)) {
+            case JOp::e_j: return Op::e_j;
+            case JOp::e_jal: return Op::e_jal;
+            case JOp::e_bc: return Op::e_bc;
+            case JOp::e_balc: return Op::e_balc;
+        }
+
+        switch (static_cast<IOp>(opcode)) {
+            case IOp::e_addiu: return Op::e_addiu;
+            case IOp::e_slti: return Op::e_slti;
+            case IOp::e_sltiu: return Op::e_sltiu;
+            case IOp::e_andi: return Op::e_andi;
+            case IOp::e_ori: return Op::e_ori;
+            case IOp::e_xori: return Op::e_xori;
+            case IOp::e_aui: return Op::e_aui;
+            case IOp::e_lb: return Op::e_lb;
+            case IOp::e_lbu: return Op::e_lbu;
+            case IOp::e_lh: return Op::e_lh;
+            case IOp::e_lhu: return Op::e_lhu;
+            case IOp::e_lw: return Op::e_lw;
+            case IOp::e_sb: return Op::e_sb;
+            case IOp::e_sh: return Op::e_sh;
+            case IOp::e_sw: return Op::e_sw;
+            case IOp::e_beq: return Op::e_beq;
+            case IOp::e_bne: return Op::e_bne;
+
+            // The POP encodings are told apart by their registers
+            case IOp::e_pop06: {
+                if (rt == 0) return Op::e_blez;
+                if (rs == 0) return Op::e_blezalc;
+                if (rs == rt) return Op::e_bgezalc;
+                return Op::e_bgeuc;
+            }
+            case IOp::e_pop07: {
+                if (rt == 0) return Op::e_bgtz;
+                if (rs == 0) return Op::e_bgtzalc;
+                if (rs == rt) return Op::e_bltzalc;
+                return Op::e_bltuc;
+            }
+            case IOp::e_pop10: {
+                if (rs >= rt) return Op::e_bovc;
+                if (rs == 0) return Op::e_beqzalc;
+                return Op::e_beqc;
+            }
+            case IOp::e_pop30: {
+                if (rs >= rt) return Op::e_bnvc;
+                if (rs == 0) return Op::e_bnezalc;
+                return Op::e_bnec;
+            }
+            case IOp::e_pop26: {
+                if (rt == 0) return Op::e_invalid;
+                if (rs == 0) return Op::e_blezc;
+                if (rs == rt) return Op::e_bgezc;
+                return Op::e_bgec;
+            }
+            case IOp::e_pop27: {
+                if (rt == 0) return Op::e_invalid;
+                if (rs == 0) return Op::e_bgtzc;
+                if (rs == rt) return Op::e_bltzc;
+                return Op::e_bltc;
+            }
+            case IOp::e_pop66: return rs == 0 ? Op::e_jic : Op::e_beqzc;
+            case IOp::e_pop76: return rs == 0 ? Op::e_jialc : Op::e_bnezc;
+        }
+
+        return Op::e_invalid;
+    }
+
+    constexpr const OpInfo& get_op_info(const uint32_t word) {
+        return get_op_info(decode_op(word));
+    }
+
+    // Registers read and written by an instruction as bit masks, bit n for
+    // register $n. Writes to $zero are dropped.
+    struct RegisterUse {
+        uint32_t reads;
+        uint32_t writes;
+    };
+
+    constexpr RegisterUse get_register_use(const uint32_t word) {
+        const OpInfo& info = get_op_info(word);
+
+        const auto mask = [word](const uint8_t operands) {
+            uint32_t registers = 0;
+            if (operands & Operand::e_rs) {
+                registers |= 1u << ((word >> 21) & 0x1f);
+            }
+            if (operands & Operand::e_rt) {
+                registers |= 1u << ((word >> 16) & 0x1f);
+            }
+            if (operands & Operand::e_rd) {
+                registers |= 1u << ((word >> 11) & 0x1f);
+            }
+            if (operands & Operand::e_ra) registers |= 1u << 31;
+            return registers;
+        };
+
+        return {mask(info.reads), mask(info.writes) & ~1u};
+    }
+} // namespace mips_emulator
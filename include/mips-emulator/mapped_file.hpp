@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define MIPS_EMULATOR_HAS_MMAP 1
+#endif
+
+namespace mips_emulator {
+    // A file mapped into host memory, used to back guest pages without
+    // copying the file's contents.
+    //
+    // The mapping is rounded up to whole pages, bytes past the end of the
+    // file read as zero. Only available on POSIX hosts, open returns nullptr
+    // elsewhere.
+    class MappedFile {
+    public:
+        enum class Mode {
+            // Read only, guest pages must not be writable
+            e_read_only,
+            // Stores are written back to the file
+            e_read_write,
+            // Stores are private to this mapping and never reach the file
+            e_copy_on_write,
+        };
+
+        static std::shared_ptr<MappedFile> open(const char* path,
+                                                const Mode mode) {
+#ifdef MIPS_EMULATOR_HAS_MMAP
+            const int fd =
+                ::open(path, mode == Mode::e_read_write ? O_RDWR : O_RDONLY);
+            if (fd < 0) return nullptr;
+
+            struct stat info;
+            if (::fstat(fd, &info) != 0 || info.st_size == 0 ||
+                static_cast<uint64_t>(info.st_size) > UINT32_MAX) {
+                ::close(fd);
+                return nullptr;
+            }
+
+            const std::size_t size = static_cast<std::size_t>(info.st_size);
+            const int prot = mode == Mode::e_read_only
+                                 ? PROT_READ
+                                 : PROT_READ | PROT_WRITE;
+            const int flags =
+                mode == Mode::e_read_write ? MAP_SHARED : MAP_PRIVATE;
+
+            void* data = ::mmap(nullptr, size, prot, flags, fd, 0);
+
+            // The mapping keeps the file alive on its own
+            ::close(fd);
+            if (data == MAP_FAILED) return nullptr;
+
+            return std::shared_ptr<MappedFile>(
+                new MappedFile(static_cast<uint8_t*>(data), size, mode));
+#else
+            (void)path;
+            (void)mode;
+            return nullptr;
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef MIPS_EMULATOR_HAS_MMAP
+            ::munmap(data, size);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        uint8_t* get_data() noexcept { return data; }
+        const uint8_t* get_data() const noexcept { return data; }
+
+        std::size_t get_size() const noexcept { return size; }
+        Mode get_mode() const noexcept { return mode; }
+        bool is_writable() const noexcept { return mode != Mode::e_read_only; }
+
+    private:
+        MappedFile(uint8_t* data, const std::size_t size, const Mode mode)
+            : data(data), size(size), mode(mode) {}
+
+        uint8_t* data;
+        std::size_t size;
+        Mode mode;
+    };
+} // namespace mips_emulator
+
+#undef MIPS_EMULATOR_HAS_MMAP
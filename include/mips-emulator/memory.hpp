@@ -1,24 +1,157 @@
 #pragma once
+#include "mips-emulator/endian.hpp"
 #include "mips-emulator/result.hpp"
 #include "mips-emulator/span.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace mips_emulator {
     enum class MemoryError : uint8_t {
         unaligned_access,
         out_of_bounds_access,
+        permission_denied,
+        // The range is mapped, but not backed by contiguous host memory
+        discontiguous_range,
     };
 
     struct NullMMIO {};
 
+    // MMIO handlers may implement
+    //     bool overlaps(uint32_t address, uint32_t size)
+    // which lets bulk transfers know if a range touches any device. Without
+    // it every bulk transfer has to assume that it might.
+    template <typename MMIOHandler, typename = void>
+    struct HasMMIOOverlaps : std::false_type {};
+
+    template <typename MMIOHandler>
+    struct HasMMIOOverlaps<
+        MMIOHandler, std::void_t<decltype(std::declval<MMIOHandler&>().overlaps(
+                         uint32_t{}, uint32_t{}))>> : std::true_type {};
+
+    template <typename MMIOHandler>
+    inline bool mmio_may_overlap(MMIOHandler* mmio, const uint32_t address,
+                                 const std::size_t size) {
+        if constexpr (std::is_same_v<MMIOHandler, NullMMIO>) {
+            return false;
+        }
+        else if constexpr (HasMMIOOverlaps<MMIOHandler>::value) {
+            // Ranges reaching past the address space are rejected later on
+            if (size == 0 || size > UINT32_MAX) return false;
+            return mmio->overlaps(address, static_cast<uint32_t>(size));
+        }
+        else {
+            return true;
+        }
+    }
+
+    // MMIO handlers may implement
+    //     bool is_pollable(uint32_t address)
+    // telling whether reads of the device register at address have no side
+    // effects and its value only changes from the host side, between runs.
+    // Guest loops that do nothing but poll such registers are fast forwarded.
+    template <typename MMIOHandler, typename = void>
+    struct HasMMIOPolling : std::false_type {};
+
+    template <typename MMIOHandler>
+    struct HasMMIOPolling<
+        MMIOHandler,
+        std::void_t<decltype(std::declval<MMIOHandler&>().is_pollable(
+            uint32_t{}))>> : std::true_type {};
+
+    template <typename MMIOHandler>
+    inline bool mmio_is_pollable(MMIOHandler* mmio, const uint32_t address) {
+        if constexpr (HasMMIOPolling<MMIOHandler>::value) {
+            return mmio != nullptr && mmio->is_pollable(address);
+        }
+        else {
+            (void)mmio, (void)address;
+            return false;
+        }
+    }
+
+    // Notified when a page marked as code by protect_code is written to, or
+    // remapped, so that translations of it can be dropped
+    class CodeWriteListener {
+    public:
+        virtual ~CodeWriteListener() = default;
+
+        virtual void code_written(uint32_t page_address) = 0;
+    };
+
+    // Memory backends that can write protect translated code implement
+    //     Result<void, MemoryError> protect_code(uint32_t address)
+    //     void set_code_write_listener(CodeWriteListener* listener)
+    template <typename Memory, typename = void>
+    struct HasCodeProtection : std::false_type {};
+
+    template <typename Memory>
+    struct HasCodeProtection<
+        Memory, std::void_t<decltype(std::declval<Memory&>().protect_code(
+                    uint32_t{}))>> : std::true_type {};
+
+    // Memory backends that let translated code check a run of accesses once
+    // implement
+    //     uint8_t* get_window(uint32_t address, uint32_t size, bool write)
+    // returning a host pointer through which every access inside of the
+    // range behaves exactly as through read and store, or nullptr, and
+    //     uint32_t get_generation() const
+    // which changes whenever a window handed out earlier may have gone
+    // stale, or a range without one may have gained one.
+    template <typename Memory, typename = void>
+    struct HasAccessWindow : std::false_type {};
+
+    template <typename Memory>
+    struct HasAccessWindow<
+        Memory, std::void_t<decltype(std::declval<Memory&>().get_window(
+                    uint32_t{}, uint32_t{}, bool{}))>> : std::true_type {};
+
+    // Memory backends with windows may also implement
+    //     MMIOHandler* get_device(uint32_t address, uint32_t size)
+    // returning the MMIO handler when every access inside of the range goes
+    // to it alone and faults when it's declined, or nullptr. The generation
+    // covers devices like it covers windows.
+    template <typename Memory, typename = void>
+    struct HasDeviceAccess : std::false_type {};
+
+    template <typename Memory>
+    struct HasDeviceAccess<
+        Memory, std::void_t<decltype(std::declval<Memory&>().get_device(
+                    uint32_t{}, uint32_t{}))>>
+        : std::bool_constant<!std::is_same_v<
+              decltype(std::declval<Memory&>().get_device(uint32_t{},
+                                                          uint32_t{})),
+              NullMMIO*>> {};
+
+    // Memory backends that can tell idle loops apart implement
+    //     bool is_pollable(uint32_t address, uint32_t size)
+    // whether reads of the range have no side effects and its contents only
+    // change from the host side, which holds for RAM and HasMMIOPolling
+    // devices.
+    template <typename Memory, typename = void>
+    struct HasPolling : std::false_type {};
+
+    template <typename Memory>
+    struct HasPolling<
+        Memory, std::void_t<decltype(std::declval<Memory&>().is_pollable(
+                    uint32_t{}, uint32_t{}))>> : std::true_type {};
+
+    // NOTE:
+    // Memory holds guest data in the guest byte order, values are converted
+    // to and from host order on each access. MMIO values are passed to and
+    // from the handler in host order.
     template <typename MemoryImplemantion, typename MMIOHandler = NullMMIO,
-              bool aligned_access = false>
+              bool aligned_access = false, Endian endian = Endian::e_little>
     class Memory {
     public:
         using Address = uint32_t;
 
+        static constexpr Endian ENDIAN = endian;
+        static constexpr bool ALIGNED_ACCESS = aligned_access;
+
         Memory(uint32_t offset, std::shared_ptr<MMIOHandler> mmio)
             : offset(offset), mmio(std::move(mmio)) {}
 
@@ -48,9 +181,9 @@ namespace mips_emulator {
                 return MemoryError::out_of_bounds_access;
             }
 
-            return *reinterpret_cast<T*>(
+            return to_host<endian>(*reinterpret_cast<T*>(
                 static_cast<MemoryImplemantion*>(this)->get_memory() + address -
-                offset);
+                offset));
         }
 
         template <typename T>
@@ -70,9 +203,14 @@ namespace mips_emulator {
                 return MemoryError::out_of_bounds_access;
             }
 
-            return *reinterpret_cast<T*>(
+            return to_host<endian>(*reinterpret_cast<T*>(
                 static_cast<MemoryImplemantion*>(this)->get_memory() + address -
-                offset);
+                offset));
+        }
+
+        // Reads an instruction word
+        Result<uint32_t, MemoryError> fetch(const Address address) {
+            return read<uint32_t>(address);
         }
 
         template <typename T>
@@ -99,7 +237,7 @@ namespace mips_emulator {
 
             *reinterpret_cast<T*>(
                 static_cast<MemoryImplemantion*>(this)->get_memory() + address -
-                offset) = value;
+                offset) = from_host<endian>(value);
 
             return {};
         }
@@ -124,11 +262,92 @@ namespace mips_emulator {
 
             *reinterpret_cast<T*>(
                 static_cast<MemoryImplemantion*>(this)->get_memory() + address -
-                offset) = value;
+                offset) = from_host<endian>(value);
+
+            return {};
+        }
+
+        // Writes host order words, such as a program image, in the guest
+        // byte order. The whole range is validated once and the MMIO handler
+        // is bypassed.
+        Result<void, MemoryError> write_words(const Address address,
+                                              Span<const uint32_t> words) {
+            const std::size_t size = words.get_size() * sizeof(uint32_t);
+            if (!is_range_in_bounds(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            copy_words_from_host<endian>(host_ptr(address), words.get_data(),
+                                         words.get_size());
 
             return {};
         }
 
+        // Bulk transfers validate the whole range once and copy with
+        // memcpy/memset. Ranges that overlap MMIO fall back to byte accesses
+        // and may be partially performed on error.
+        Result<void, MemoryError> write_block(const Address address,
+                                              Span<const uint8_t> data) {
+            if (mmio_may_overlap(mmio.get(), address, data.get_size())) {
+                for (std::size_t i = 0; i < data.get_size(); ++i) {
+                    const auto result = store<uint8_t>(address + i, data[i]);
+                    if (result.is_error()) return result;
+                }
+                return {};
+            }
+
+            if (!is_range_in_bounds(address, data.get_size())) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            if (data.get_size() != 0) {
+                std::memcpy(host_ptr(address), data.get_data(),
+                            data.get_size());
+            }
+            return {};
+        }
+
+        Result<void, MemoryError> read_block(const Address address,
+                                             Span<uint8_t> data) {
+            if (mmio_may_overlap(mmio.get(), address, data.get_size())) {
+                for (std::size_t i = 0; i < data.get_size(); ++i) {
+                    const auto result = read<uint8_t>(address + i);
+                    if (result.is_error()) return result.get_error();
+                    data[i] = result.get_value();
+                }
+                return {};
+            }
+
+            if (!is_range_in_bounds(address, data.get_size())) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            if (data.get_size() != 0) {
+                std::memcpy(data.get_data(), host_ptr(address),
+                            data.get_size());
+            }
+            return {};
+        }
+
+        Result<void, MemoryError> fill(const Address address,
+                                       const uint32_t size,
+                                       const uint8_t byte) {
+            if (mmio_may_overlap(mmio.get(), address, size)) {
+                for (uint32_t i = 0; i < size; ++i) {
+                    const auto result = store<uint8_t>(address + i, byte);
+                    if (result.is_error()) return result;
+                }
+                return {};
+            }
+
+            if (!is_range_in_bounds(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            if (size != 0) std::memset(host_ptr(address), byte, size);
+            return {};
+        }
+
         Result<void*, MemoryError> ptr_from_address(const Address address) {
             if (!is_in_bounds<uint8_t>(address)) {
                 return MemoryError::out_of_bounds_access;
@@ -138,6 +357,63 @@ namespace mips_emulator {
                    address - offset;
         }
 
+        // Returns a host pointer to the first byte of a range that is fully
+        // inside of memory. Like ptr_from_address the MMIO handler isn't
+        // considered.
+        Result<void*, MemoryError> ptr_from_range(const Address address,
+                                                  const std::size_t size) {
+            if (!is_range_in_bounds(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            return host_ptr(address);
+        }
+
+        // Host pointer to a range no access has to check again, see
+        // HasAccessWindow. Ranges that may overlap MMIO are left to read and
+        // store.
+        uint8_t* get_window(const Address address, const uint32_t size,
+                            const bool write) {
+            (void)write;
+            if (mmio_may_overlap(mmio.get(), address, size)) return nullptr;
+
+            // One byte more, is_in_bounds rejects the last byte of memory
+            if (!is_range_in_bounds(address, std::size_t{size} + 1)) {
+                return nullptr;
+            }
+            return host_ptr(address);
+        }
+
+        // See HasDeviceAccess. The handler is asked before memory, so only
+        // ranges outside of memory are left to it alone. Handlers without
+        // overlaps may cover any address, so memory never gets windows then.
+        MMIOHandler* get_device(const Address address, const uint32_t size) {
+            if constexpr (std::is_same_v<MMIOHandler, NullMMIO>) {
+                (void)address, (void)size;
+                return nullptr;
+            }
+            else {
+                const uint64_t end = uint64_t{address} + size;
+                const uint64_t memory_end =
+                    uint64_t{offset} +
+                    static_cast<MemoryImplemantion*>(this)->get_size();
+                if (size == 0 || (end > offset && address < memory_end)) {
+                    return nullptr;
+                }
+                return mmio.get();
+            }
+        }
+
+        // Memory is never remapped, windows and devices stay valid
+        uint32_t get_generation() const noexcept { return 0; }
+
+        // See HasPolling. Without overlaps the handler may cover any address
+        // and decides for all of them.
+        bool is_pollable(const Address address, const uint32_t size) {
+            if (!mmio_may_overlap(mmio.get(), address, size)) return true;
+            return mmio_is_pollable(mmio.get(), address);
+        }
+
         Span<uint8_t> get_memory() {
             return {
                 static_cast<MemoryImplemantion*>(this)->get_memory(),
@@ -158,6 +434,19 @@ namespace mips_emulator {
                    address >= offset;
         }
 
+        inline uint8_t* host_ptr(const Address address) {
+            return static_cast<MemoryImplemantion*>(this)->get_memory() +
+                   address - offset;
+        }
+
+        inline bool is_range_in_bounds(const Address address,
+                                       const std::size_t size) {
+            const std::size_t memory_size =
+                static_cast<MemoryImplemantion*>(this)->get_size();
+            return address >= offset && address - offset <= memory_size &&
+                   size <= memory_size - (address - offset);
+        }
+
     protected:
         uint32_t offset;
         std::shared_ptr<MMIOHandler> mmio;
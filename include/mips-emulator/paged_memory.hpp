@@ -0,0 +1,795 @@
+#pragma once
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/mapped_file.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/result.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace mips_emulator {
+    using Permissions = uint8_t;
+
+    namespace Permission {
+        constexpr Permissions e_none = 0;
+        constexpr Permissions e_read = 1 << 0;
+        constexpr Permissions e_write = 1 << 1;
+        constexpr Permissions e_exec = 1 << 2;
+
+        constexpr Permissions e_rw = e_read | e_write;
+        constexpr Permissions e_rx = e_read | e_exec;
+        constexpr Permissions e_rwx = e_read | e_write | e_exec;
+    } // namespace Permission
+
+    // Supplies the contents of lazily mapped pages, for example from a file
+    // section, a compressed snapshot or a generator.
+    class PageProvider {
+    public:
+        virtual ~PageProvider() = default;
+
+        // Called the first time the guest or host touches a page, with the
+        // page's guest address and its zero initialized host memory. Returning
+        // false fails the access and leaves the page unpopulated.
+        virtual bool populate(uint32_t page_address, Span<uint8_t> page) = 0;
+    };
+
+    // Sparse guest memory built from 4 KiB pages with per-page R/W/X
+    // permissions.
+    //
+    // Every page has a translation entry holding one host pointer per access
+    // kind. A pointer is only set when the page is mapped with the matching
+    // permission, so reads, stores and fetches take a single lookup and null
+    // check on the hit path. Unmapped pages, denied accesses, accesses that
+    // straddle two pages and MMIO all fall through to a slow path.
+    //
+    // Pages are populated on demand: the first touch of a page goes through
+    // the slow path which allocates it and asks its PageProvider, if any, for
+    // the contents. Resident memory is proportional to the pages in use.
+    //
+    // Pages holding translated code can be write protected with
+    // protect_code. Their write pointer is withheld, so the first store to
+    // one falls through to the slow path which notifies the
+    // CodeWriteListener and lifts the protection. Stores to data pages never
+    // check anything more than before.
+    //
+    // NOTE: Unlike Memory, mapped pages take priority over the MMIO handler,
+    // which is only consulted for addresses that aren't backed by a page.
+    template <typename MMIOHandler = NullMMIO, bool aligned_access = false,
+              Endian endian = Endian::e_little>
+    class PagedMemory {
+    public:
+        using Address = uint32_t;
+
+        static constexpr Endian ENDIAN = endian;
+        static constexpr bool ALIGNED_ACCESS = aligned_access;
+
+        static constexpr uint32_t PAGE_BITS = 12;
+        static constexpr uint32_t PAGE_SIZE = 1 << PAGE_BITS;
+        static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+        PagedMemory(std::shared_ptr<MMIOHandler> mmio = nullptr)
+            : mmio(std::move(mmio)) {
+            for (auto& table : directory) table = &empty_table();
+        }
+
+        PagedMemory(const PagedMemory&) = delete;
+        PagedMemory& operator=(const PagedMemory&) = delete;
+
+        // Maps zero initialized pages covering [address, address + size).
+        // Pages that are already mapped are replaced.
+        Result<void, MemoryError> map(const Address address,
+                                      const uint32_t size,
+                                      const Permissions perms) {
+            return map_lazy(address, size, perms, nullptr);
+        }
+
+        // Maps pages covering [address, address + size) whose contents are
+        // supplied by provider the first time each page is touched.
+        Result<void, MemoryError>
+        map_lazy(const Address address, const uint32_t size,
+                 const Permissions perms,
+                 std::shared_ptr<PageProvider> provider) {
+            release_code(address, size);
+            ++generation;
+            return for_each_page(address, size, [&](PageEntry& entry) {
+                reset_entry(entry);
+                entry.lazy = true;
+                entry.provider = provider.get();
+                entry.owner = provider;
+                set_permissions(entry, perms);
+            });
+        }
+
+        // Maps an existing host buffer at a page aligned guest address
+        // without copying it, guest loads and stores access the buffer in
+        // place. The buffer has to cover whole pages and stay alive while
+        // mapped, optionally by handing its owner over to the mapping.
+        Result<void, MemoryError>
+        map_host(const Address address, uint8_t* host, const uint32_t size,
+                 const Permissions perms,
+                 std::shared_ptr<void> owner = nullptr) {
+            if ((address & PAGE_MASK) != 0 || (size & PAGE_MASK) != 0 ||
+                host == nullptr) {
+                return MemoryError::unaligned_access;
+            }
+
+            release_code(address, size);
+            ++generation;
+            return for_each_page(address, size, [&](PageEntry& entry) {
+                reset_entry(entry);
+                entry.owner = owner;
+                entry.host = host;
+                set_permissions(entry, perms);
+                host += PAGE_SIZE;
+            });
+        }
+
+        // Maps a file at a page aligned guest address. Writable permissions
+        // require a writable mapping.
+        Result<void, MemoryError> map_file(const Address address,
+                                           std::shared_ptr<MappedFile> file,
+                                           const Permissions perms) {
+            if (file == nullptr) return MemoryError::out_of_bounds_access;
+            if ((perms & Permission::e_write) && !file->is_writable()) {
+                return MemoryError::permission_denied;
+            }
+
+            // The host mapping itself is rounded up to whole pages
+            const uint32_t size = static_cast<uint32_t>(
+                (file->get_size() + PAGE_MASK) & ~std::size_t(PAGE_MASK));
+            uint8_t* host = file->get_data();
+            return map_host(address, host, size, perms, std::move(file));
+        }
+
+        // Unmaps the pages covering [address, address + size). Host buffers
+        // are released once none of their pages are mapped anymore.
+        Result<void, MemoryError> unmap(const Address address,
+                                        const uint32_t size) {
+            release_code(address, size);
+            ++generation;
+            return for_each_page(address, size, [&](PageEntry& entry) {
+                reset_entry(entry);
+            });
+        }
+
+        // Changes the permissions of already mapped pages covering
+        // [address, address + size).
+        Result<void, MemoryError> protect(const Address address,
+                                          const uint32_t size,
+                                          const Permissions perms) {
+            if (!is_mapped(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            ++generation;
+            return for_each_page(address, size, [&](PageEntry& entry) {
+                set_permissions(entry, perms);
+            });
+        }
+
+        bool is_mapped(const Address address, const uint32_t size) const {
+            if (size == 0 || address + (size - 1) < address) return false;
+
+            const uint32_t first = address >> PAGE_BITS;
+            const uint32_t last = (address + (size - 1)) >> PAGE_BITS;
+            for (uint32_t page = first; page <= last; ++page) {
+                if (!is_backed(lookup(page << PAGE_BITS))) return false;
+            }
+            return true;
+        }
+
+        Permissions get_permissions(const Address address) const {
+            return lookup(address).perms;
+        }
+
+        // Write protects the page containing address until the next store
+        // to it
+        Result<void, MemoryError> protect_code(const Address address) {
+            if (!is_mapped(address, 1)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            PageEntry& entry = lookup_or_create(address);
+            entry.code = true;
+            set_permissions(entry, entry.perms);
+            ++generation;
+            return {};
+        }
+
+        bool is_code(const Address address) const {
+            return lookup(address).code;
+        }
+
+        void set_code_write_listener(CodeWriteListener* listener) {
+            code_listener = listener;
+        }
+
+        template <typename T>
+        Result<T, MemoryError> read(const Address address) {
+            if constexpr (sizeof(T) > 1 && aligned_access) {
+                if (!is_aligned<T>(address)) {
+                    return MemoryError::unaligned_access;
+                }
+            }
+
+            const uint8_t* host = lookup(address).read;
+            if (host != nullptr && fits_in_page<T>(address)) {
+                return to_host<endian>(*reinterpret_cast<const T*>(
+                    host + (address & PAGE_MASK)));
+            }
+
+            // Try to read from MMIO handler
+            if constexpr (!std::is_same_v<MMIOHandler, NullMMIO>) {
+                if (!is_backed(lookup(address))) {
+                    const auto mmio_value = mmio->template read<T>(address);
+                    if (mmio_value.has_value()) return mmio_value.value();
+                }
+            }
+
+            return read_slow<T>(address, Permission::e_read);
+        }
+
+        template <typename T>
+        Result<T, MemoryError> read_no_mmio(const Address address) {
+            if constexpr (sizeof(T) > 1 && aligned_access) {
+                if (!is_aligned<T>(address)) {
+                    return MemoryError::unaligned_access;
+                }
+            }
+
+            const uint8_t* host = lookup(address).read;
+            if (host != nullptr && fits_in_page<T>(address)) {
+                return to_host<endian>(*reinterpret_cast<const T*>(
+                    host + (address & PAGE_MASK)));
+            }
+
+            return read_slow<T>(address, Permission::e_read);
+        }
+
+        // Reads an instruction word, requires the page to be executable
+        Result<uint32_t, MemoryError> fetch(const Address address) {
+            if (!is_aligned<uint32_t>(address)) {
+                return MemoryError::unaligned_access;
+            }
+
+            const uint8_t* host = lookup(address).exec;
+            if (host != nullptr) {
+                return to_host<endian>(*reinterpret_cast<const uint32_t*>(
+                    host + (address & PAGE_MASK)));
+            }
+
+            return read_slow<uint32_t>(address, Permission::e_exec);
+        }
+
+        template <typename T>
+        Result<void, MemoryError> store(const Address address, const T value) {
+            if constexpr (sizeof(T) > 1 && aligned_access) {
+                if (!is_aligned<T>(address)) {
+                    return MemoryError::unaligned_access;
+                }
+            }
+
+            uint8_t* host = lookup(address).write;
+            if (host != nullptr && fits_in_page<T>(address)) {
+                *reinterpret_cast<T*>(host + (address & PAGE_MASK)) =
+                    from_host<endian>(value);
+                return {};
+            }
+
+            // Try to write to MMIO handler
+            if constexpr (!std::is_same_v<MMIOHandler, NullMMIO>) {
+                if (!is_backed(lookup(address)) &&
+                    mmio->template store<T>(address, value)) {
+                    return {};
+                }
+            }
+
+            return store_slow<T>(address, value);
+        }
+
+        template <typename T>
+        Result<void, MemoryError> store_no_mmio(const Address address,
+                                                const T value) {
+            if constexpr (sizeof(T) > 1 && aligned_access) {
+                if (!is_aligned<T>(address)) {
+                    return MemoryError::unaligned_access;
+                }
+            }
+
+            uint8_t* host = lookup(address).write;
+            if (host != nullptr && fits_in_page<T>(address)) {
+                *reinterpret_cast<T*>(host + (address & PAGE_MASK)) =
+                    from_host<endian>(value);
+                return {};
+            }
+
+            return store_slow<T>(address, value);
+        }
+
+        // Writes host order words, such as a program image, in the guest
+        // byte order. Permissions and the MMIO handler are bypassed but every
+        // page in the range has to be mapped.
+        Result<void, MemoryError> write_words(const Address address,
+                                              Span<const uint32_t> words) {
+            const std::size_t size = words.get_size() * sizeof(uint32_t);
+            if (size == 0) return {};
+            if (!is_aligned<uint32_t>(address) ||
+                !resolve_range(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+            release_code(address, size);
+
+            // Word aligned chunks never split a word across pages
+            for_each_chunk(address, size,
+                           [&](uint8_t* host, std::size_t done,
+                               std::size_t count) {
+                               copy_words_from_host<endian>(
+                                   host, words.get_data() + done / 4,
+                                   count / 4);
+                           });
+
+            return {};
+        }
+
+        // Bulk transfers are host side accesses, they bypass page permissions
+        // and copy page by page with memcpy/memset once the range has been
+        // validated. Unmapped pages are only allowed when the MMIO handler
+        // may cover them, in which case those bytes go through the handler
+        // and the transfer may be partially performed on error.
+        Result<void, MemoryError> write_block(const Address address,
+                                              Span<const uint8_t> data) {
+            const std::size_t size = data.get_size();
+            if (size == 0) return {};
+            release_code(address, size);
+
+            if (!resolve_range(address, size)) {
+                if (!mmio_may_overlap(mmio.get(), address, size)) {
+                    return MemoryError::out_of_bounds_access;
+                }
+
+                for (std::size_t i = 0; i < size; ++i) {
+                    const auto result = store_byte_host_or_mmio(
+                        static_cast<Address>(address + i), data[i]);
+                    if (result.is_error()) return result;
+                }
+                return {};
+            }
+
+            for_each_chunk(address, size,
+                           [&](uint8_t* host, std::size_t done,
+                               std::size_t count) {
+                               std::memcpy(host, data.get_data() + done,
+                                           count);
+                           });
+            return {};
+        }
+
+        Result<void, MemoryError> read_block(const Address address,
+                                             Span<uint8_t> data) {
+            const std::size_t size = data.get_size();
+            if (size == 0) return {};
+
+            if (!resolve_range(address, size)) {
+                if (!mmio_may_overlap(mmio.get(), address, size)) {
+                    return MemoryError::out_of_bounds_access;
+                }
+
+                for (std::size_t i = 0; i < size; ++i) {
+                    const auto result = read_byte_host_or_mmio(
+                        static_cast<Address>(address + i));
+                    if (result.is_error()) return result.get_error();
+                    data[i] = result.get_value();
+                }
+                return {};
+            }
+
+            for_each_chunk(address, size,
+                           [&](uint8_t* host, std::size_t done,
+                               std::size_t count) {
+                               std::memcpy(data.get_data() + done, host,
+                                           count);
+                           });
+            return {};
+        }
+
+        Result<void, MemoryError> fill(const Address address,
+                                       const uint32_t size,
+                                       const uint8_t byte) {
+            if (size == 0) return {};
+            release_code(address, size);
+
+            if (!resolve_range(address, size)) {
+                if (!mmio_may_overlap(mmio.get(), address, size)) {
+                    return MemoryError::out_of_bounds_access;
+                }
+
+                for (uint32_t i = 0; i < size; ++i) {
+                    const auto result =
+                        store_byte_host_or_mmio(address + i, byte);
+                    if (result.is_error()) return result;
+                }
+                return {};
+            }
+
+            for_each_chunk(address, size,
+                           [&](uint8_t* host, std::size_t, std::size_t count) {
+                               std::memset(host, byte, count);
+                           });
+            return {};
+        }
+
+        // Host pointer to a range inside of one page that the fast path can
+        // access, see HasAccessWindow. Write windows have to be readable too,
+        // code pages never grant one.
+        uint8_t* get_window(const Address address, const uint32_t size,
+                            const bool write) {
+            if (size == 0 || size > PAGE_SIZE ||
+                (address & PAGE_MASK) > PAGE_SIZE - size) {
+                return nullptr;
+            }
+
+            const PageEntry& entry = lookup(address);
+            if (entry.read == nullptr || (write && entry.write == nullptr)) {
+                return nullptr;
+            }
+            return entry.read + (address & PAGE_MASK);
+        }
+
+        // See HasDeviceAccess, unmapped pages belong to the MMIO handler
+        MMIOHandler* get_device(const Address address, const uint32_t size) {
+            if constexpr (std::is_same_v<MMIOHandler, NullMMIO>) {
+                (void)address, (void)size;
+                return nullptr;
+            }
+            else {
+                if (size == 0 || size > PAGE_SIZE ||
+                    (address & PAGE_MASK) > PAGE_SIZE - size ||
+                    is_backed(lookup(address))) {
+                    return nullptr;
+                }
+                return mmio.get();
+            }
+        }
+
+        // Changes with every mapping, permission or code protection change
+        // and every populated page, see HasAccessWindow
+        uint32_t get_generation() const noexcept { return generation; }
+
+        // See HasPolling, mapped pages are RAM and shadow the MMIO handler
+        bool is_pollable(const Address address, const uint32_t size) {
+            const Address last = address + (size == 0 ? 0 : size - 1);
+            if (is_backed(lookup(address)) && is_backed(lookup(last))) {
+                return true;
+            }
+            return mmio_is_pollable(mmio.get(), address);
+        }
+
+        // Returns a host pointer to the byte at address, ignoring permissions.
+        // The pointer is only valid up to the end of the page, which is
+        // released if it holds code since it may be written through.
+        Result<void*, MemoryError> ptr_from_address(const Address address) {
+            uint8_t* host = resolve(address);
+            if (host == nullptr) return MemoryError::out_of_bounds_access;
+
+            release_code(address, 1);
+            return host + (address & PAGE_MASK);
+        }
+
+        // Returns a host pointer to the first byte of a mapped range, as long
+        // as the pages backing it are contiguous in host memory, which pages
+        // mapped separately rarely are. Such ranges fail with
+        // discontiguous_range, read_block and write_block copy them instead.
+        // Permissions and the MMIO handler aren't considered, code pages in
+        // the range are released like for stores.
+        Result<void*, MemoryError> ptr_from_range(const Address address,
+                                                  const std::size_t size) {
+            if (size == 0) return ptr_from_address(address);
+            if (!resolve_range(address, size)) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            uint8_t* const host = lookup(address).host + (address & PAGE_MASK);
+            bool contiguous = true;
+            for_each_chunk(address, size,
+                           [&](uint8_t* chunk, std::size_t done, std::size_t) {
+                               contiguous &= chunk == host + done;
+                           });
+            if (!contiguous) return MemoryError::discontiguous_range;
+
+            release_code(address, size);
+            return host;
+        }
+
+    protected:
+        static constexpr uint32_t TABLE_BITS = 10;
+        static constexpr uint32_t TABLE_SIZE = 1 << TABLE_BITS;
+        static constexpr uint32_t DIRECTORY_SIZE =
+            1 << (32 - PAGE_BITS - TABLE_BITS);
+
+        struct PageEntry {
+            // Fast path pointers, null unless the page grants the access
+            uint8_t* read = nullptr;
+            uint8_t* write = nullptr;
+            uint8_t* exec = nullptr;
+
+            // Slow path state
+            uint8_t* host = nullptr;
+            Permissions perms = Permission::e_none;
+
+            // Lazy pages are mapped but have no host memory until populated
+            bool lazy = false;
+            // Holds translated code, stores go through the slow path
+            bool code = false;
+            PageProvider* provider = nullptr;
+
+            // Owns the page, or keeps a mapped host buffer or the provider
+            // alive
+            std::unique_ptr<uint8_t[]> storage;
+            std::shared_ptr<void> owner;
+        };
+
+        struct PageTable {
+            PageEntry entries[TABLE_SIZE];
+        };
+
+        // All directory slots start out pointing to a shared empty table so
+        // the lookup never has to check for a missing table. It is never
+        // written to since tables are allocated before pages are mapped.
+        static PageTable& empty_table() {
+            static PageTable table;
+            return table;
+        }
+
+        const PageEntry& lookup(const Address address) const {
+            return directory[address >> (PAGE_BITS + TABLE_BITS)]
+                ->entries[(address >> PAGE_BITS) & (TABLE_SIZE - 1)];
+        }
+
+        PageEntry& lookup_or_create(const Address address) {
+            const uint32_t index = address >> (PAGE_BITS + TABLE_BITS);
+            if (tables[index] == nullptr) {
+                tables[index] = std::make_unique<PageTable>();
+                directory[index] = tables[index].get();
+            }
+
+            return tables[index]
+                ->entries[(address >> PAGE_BITS) & (TABLE_SIZE - 1)];
+        }
+
+        static bool is_backed(const PageEntry& entry) {
+            return entry.host != nullptr || entry.lazy;
+        }
+
+        static void reset_entry(PageEntry& entry) {
+            entry.host = nullptr;
+            entry.lazy = false;
+            entry.code = false;
+            entry.provider = nullptr;
+            entry.storage.reset();
+            entry.owner.reset();
+            set_permissions(entry, Permission::e_none);
+        }
+
+        // Returns the host memory of the page containing address, populating
+        // it if it's lazy. Null if the page isn't mapped or couldn't be
+        // populated.
+        uint8_t* resolve(const Address address) {
+            const PageEntry& entry = lookup(address);
+            if (!entry.lazy) return entry.host;
+
+            return populate(lookup_or_create(address), address & ~PAGE_MASK);
+        }
+
+        uint8_t* populate(PageEntry& entry, const Address page_address) {
+            auto storage = std::make_unique<uint8_t[]>(PAGE_SIZE);
+            if (entry.provider != nullptr &&
+                !entry.provider->populate(page_address,
+                                          {storage.get(), PAGE_SIZE})) {
+                return nullptr;
+            }
+
+            entry.lazy = false;
+            entry.provider = nullptr;
+            entry.owner.reset();
+            entry.storage = std::move(storage);
+            entry.host = entry.storage.get();
+            set_permissions(entry, entry.perms);
+            ++generation;
+
+            return entry.host;
+        }
+
+        // Resolves every page of a range, making all of it host backed
+        bool resolve_range(const Address address, const std::size_t size) {
+            if (size > UINT32_MAX ||
+                !is_mapped(address, static_cast<uint32_t>(size))) {
+                return false;
+            }
+
+            const uint32_t first = address >> PAGE_BITS;
+            const uint32_t last = (address + (size - 1)) >> PAGE_BITS;
+            for (uint32_t page = first; page <= last; ++page) {
+                if (resolve(page << PAGE_BITS) == nullptr) return false;
+            }
+            return true;
+        }
+
+        static void set_permissions(PageEntry& entry, const Permissions perms) {
+            entry.perms = perms;
+            entry.read = (perms & Permission::e_read) ? entry.host : nullptr;
+            entry.write = (perms & Permission::e_write) && !entry.code
+                              ? entry.host
+                              : nullptr;
+            entry.exec = (perms & Permission::e_exec) ? entry.host : nullptr;
+        }
+
+        template <typename Func>
+        Result<void, MemoryError> for_each_page(const Address address,
+                                                const uint32_t size,
+                                                Func&& func) {
+            // Reject empty and wrapping ranges
+            if (size == 0 || address + (size - 1) < address) {
+                return MemoryError::out_of_bounds_access;
+            }
+
+            const uint32_t first = address >> PAGE_BITS;
+            const uint32_t last = (address + (size - 1)) >> PAGE_BITS;
+            for (uint32_t page = first; page <= last; ++page) {
+                func(lookup_or_create(page << PAGE_BITS));
+            }
+
+            return {};
+        }
+
+        // Calls func(host, done, count) for each page sized chunk of a mapped
+        // range
+        template <typename Func>
+        void for_each_chunk(const Address address, const std::size_t size,
+                            Func&& func) {
+            std::size_t done = 0;
+            while (done < size) {
+                const Address current = static_cast<Address>(address + done);
+                const std::size_t count = std::min<std::size_t>(
+                    size - done, PAGE_SIZE - (current & PAGE_MASK));
+
+                func(lookup(current).host + (current & PAGE_MASK), done, count);
+                done += count;
+            }
+        }
+
+        // Host side byte accesses used by the bulk transfer fallbacks
+        Result<uint8_t, MemoryError> read_byte_host_or_mmio(
+            const Address address) {
+            const uint8_t* host = resolve(address);
+            if (host != nullptr) return host[address & PAGE_MASK];
+
+            if constexpr (!std::is_same_v<MMIOHandler, NullMMIO>) {
+                const auto mmio_value = mmio->template read<uint8_t>(address);
+                if (mmio_value.has_value()) return mmio_value.value();
+            }
+
+            return MemoryError::out_of_bounds_access;
+        }
+
+        Result<void, MemoryError> store_byte_host_or_mmio(const Address address,
+                                                          const uint8_t value) {
+            uint8_t* host = resolve(address);
+            if (host != nullptr) {
+                host[address & PAGE_MASK] = value;
+                return {};
+            }
+
+            if constexpr (!std::is_same_v<MMIOHandler, NullMMIO>) {
+                if (mmio->template store<uint8_t>(address, value)) return {};
+            }
+
+            return MemoryError::out_of_bounds_access;
+        }
+
+        template <typename T>
+        inline static bool is_aligned(const Address address) {
+            return (address & (sizeof(T) - 1)) == 0;
+        }
+
+        template <typename T>
+        inline static bool fits_in_page(const Address address) {
+            // Aligned accesses never straddle a page boundary
+            if constexpr (sizeof(T) == 1 || aligned_access) return true;
+
+            return (address & PAGE_MASK) <= PAGE_SIZE - sizeof(T);
+        }
+
+        Result<uint8_t*, MemoryError> checked_host(const Address address,
+                                                   const Permissions access) {
+            const PageEntry& entry = lookup(address);
+            if (!is_backed(entry)) {
+                return MemoryError::out_of_bounds_access;
+            }
+            if ((entry.perms & access) == 0) {
+                return MemoryError::permission_denied;
+            }
+
+            uint8_t* host = resolve(address);
+            if (host == nullptr) return MemoryError::out_of_bounds_access;
+
+            return host + (address & PAGE_MASK);
+        }
+
+        template <typename T>
+        Result<T, MemoryError> read_slow(const Address address,
+                                         const Permissions access) {
+            // Check both pages before touching either, the access is either
+            // fully performed or not at all
+            const Address last = address + sizeof(T) - 1;
+            const auto first_page = checked_host(address, access);
+            if (first_page.is_error()) return first_page.get_error();
+            const auto last_page = checked_host(last, access);
+            if (last_page.is_error()) return last_page.get_error();
+
+            uint8_t bytes[sizeof(T)];
+            for (uint32_t i = 0; i < sizeof(T); ++i) {
+                bytes[i] = *checked_host(address + i, access).get_value();
+            }
+
+            T value;
+            std::memcpy(&value, bytes, sizeof(T));
+            return to_host<endian>(value);
+        }
+
+        template <typename T>
+        Result<void, MemoryError> store_slow(const Address address,
+                                             const T value) {
+            const Address last = address + sizeof(T) - 1;
+            const auto first_page = checked_host(address, Permission::e_write);
+            if (first_page.is_error()) return first_page.get_error();
+            const auto last_page = checked_host(last, Permission::e_write);
+            if (last_page.is_error()) return last_page.get_error();
+            release_code(address, sizeof(T));
+
+            uint8_t bytes[sizeof(T)];
+            const T guest_value = from_host<endian>(value);
+            std::memcpy(bytes, &guest_value, sizeof(T));
+            for (uint32_t i = 0; i < sizeof(T); ++i) {
+                *checked_host(address + i, Permission::e_write).get_value() =
+                    bytes[i];
+            }
+
+            return {};
+        }
+
+        // Lifts the write protection of the code pages in a range that is
+        // about to be written or remapped and notifies the listener
+        void release_code(const Address address, const std::size_t size) {
+            if (size == 0 ||
+                address + static_cast<uint64_t>(size - 1) > UINT32_MAX) {
+                return;
+            }
+
+            const uint32_t first = address >> PAGE_BITS;
+            const uint32_t last = static_cast<uint32_t>(
+                (address + (size - 1)) >> PAGE_BITS);
+            for (uint32_t page = first; page <= last; ++page) {
+                if (!lookup(page << PAGE_BITS).code) continue;
+
+                PageEntry& entry = lookup_or_create(page << PAGE_BITS);
+                entry.code = false;
+                set_permissions(entry, entry.perms);
+                ++generation;
+                if (code_listener != nullptr) {
+                    code_listener->code_written(page << PAGE_BITS);
+                }
+            }
+        }
+
+    protected:
+        PageTable* directory[DIRECTORY_SIZE];
+        std::unique_ptr<PageTable> tables[DIRECTORY_SIZE];
+        std::shared_ptr<MMIOHandler> mmio;
+        CodeWriteListener* code_listener = nullptr;
+        uint32_t generation = 0;
+    };
+} // namespace mips_emulator
@@ -0,0 +1,416 @@
+#pragma once
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/instruction_info.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/result.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <dlfcn.h>
+#    define MIPS_EMULATOR_HAS_DLOPEN 1
+#endif
+
+namespace mips_emulator {
+    enum class RecompiledError : uint8_t {
+        open_failed,
+        missing_module,
+        version_mismatch,
+        memory_mismatch,
+        key_mismatch,
+        compile_failed,
+    };
+
+    // Native code of a guest basic block. Returns the number of instructions
+    // it retired, the index of the failing one when an instruction fails.
+    template <typename Memory>
+    using RecompiledBlock = uint32_t (*)(RegisterFile&, Memory&);
+
+    // Whether an idle loop that just looped back would spin until the host
+    // changes memory, see Recompiled::poll
+    template <typename Memory>
+    using RecompiledIdle = bool (*)(const RegisterFile&, Memory&);
+
+    // Runs whole iterations of a counted loop, at most limit and never the
+    // one leaving it, and returns how many. See Recompiled::iterations.
+    template <typename Memory>
+    using RecompiledLoop = uint64_t (*)(RegisterFile&, Memory&, uint64_t);
+
+    template <typename Memory>
+    struct RecompiledEntry {
+        uint32_t address;
+        uint32_t instruction_count;
+        // Index of the first instruction that keeps the PC up to date, the
+        // ones before it leave the PC to the block. See Recompiled::recover.
+        uint32_t precise_from;
+        RecompiledBlock<Memory> block;
+        // Set for blocks that loop to themselves and only poll memory
+        RecompiledIdle<Memory> idle;
+        // Set for blocks that loop to themselves a known number of times
+        RecompiledLoop<Memory> loop;
+    };
+
+    // Table a recompiled library exports through
+    // mips_emulator_recompiled_module()
+    template <typename Memory>
+    struct RecompiledModule {
+        uint32_t version;
+        // typeid name of the memory backend the blocks were compiled for
+        const char* memory_type;
+        // Hash of the text of every block in address order
+        uint64_t key;
+        uint32_t count;
+        const RecompiledEntry<Memory>* entries;
+    };
+
+    namespace Recompiled {
+        static constexpr uint32_t VERSION = 4;
+        static constexpr const char* MODULE_SYMBOL =
+            "mips_emulator_recompiled_module";
+
+        // Executes the instruction raw the same way Executor::step does.
+        // The word is a constant so the compiler folds the decoding away
+        // and only keeps the handler of this instruction.
+        template <uint32_t raw, typename Memory>
+        inline bool step(RegisterFile& reg_file, Memory& memory) {
+            constexpr auto type = Instruction::decode_type(raw);
+
+            reg_file.update_pc();
+            if constexpr (type.is_error()) {
+                return false;
+            }
+            else {
+                return Executor::execute(Instruction(raw), type.get_value(),
+                                         reg_file, memory);
+            }
+        }
+
+        // Executes the instruction raw without advancing the PC. Blocks only
+        // set the PC ahead of instructions that read it and at their end.
+        template <uint32_t raw, typename Memory>
+        inline bool execute(RegisterFile& reg_file, Memory& memory) {
+            constexpr auto type = Instruction::decode_type(raw);
+
+            if constexpr (type.is_error()) {
+                return false;
+            }
+            else {
+                return Executor::execute(Instruction(raw), type.get_value(),
+                                         reg_file, memory);
+            }
+        }
+
+        // Host pointer to the size bytes at base + offset, through which a
+        // group of loads and stores off base skips every check, nullptr when
+        // they have to be checked one by one. The offsets of the group are
+        // multiples of their access size and alignment is the largest one.
+        template <typename Memory>
+        inline uint8_t* window(Memory& memory, const uint32_t base,
+                               const int32_t offset, const uint32_t size,
+                               const bool write, const uint32_t alignment) {
+            if constexpr (HasAccessWindow<Memory>::value) {
+                if constexpr (Memory::ALIGNED_ACCESS) {
+                    if (base & (alignment - 1)) return nullptr;
+                }
+                return memory.get_window(base + offset, size, write);
+            }
+            else {
+                (void)memory, (void)base, (void)offset, (void)size;
+                (void)write, (void)alignment;
+                return nullptr;
+            }
+        }
+
+        // Performs the load or store raw through host, which points at its
+        // address inside of a window
+        template <uint32_t raw, typename Memory>
+        inline void access(RegisterFile& reg_file, uint8_t* host) {
+            using IOp = Instruction::ITypeOpcode;
+            static_assert(get_op_info(raw).accesses_memory() &&
+                              !(get_op_info(raw).flags & OpFlag::e_pc_relative),
+                          "Not a load or store");
+
+            constexpr Instruction instruction(raw);
+            Executor::access_host<Memory::ENDIAN>(
+                static_cast<IOp>(instruction.get_opcode()),
+                instruction.get_rt(), reg_file, host);
+        }
+
+        // Whether the load raw of an idle loop reads memory that only the
+        // host changes. Iterations of an idle loop compute the same values
+        // from the same loads, so once it looped back it spins until then.
+        template <uint32_t raw, typename Memory>
+        inline bool poll(const RegisterFile& reg_file, Memory& memory) {
+            constexpr Instruction instruction(raw);
+            constexpr uint32_t size = get_op_info(raw).access_size;
+            const uint32_t address =
+                reg_file.get(instruction.get_rs()).u +
+                static_cast<int16_t>(instruction.get_imm());
+
+            if constexpr (HasPolling<Memory>::value) {
+                return memory.is_pollable(address, size);
+            }
+            else {
+                (void)address, (void)memory;
+                return false;
+            }
+        }
+
+        // Iterations of a counted loop to run natively, at most limit. The
+        // loop adds step to counter until it equals bound, before comparing
+        // them when counts_first. The last iteration is left to the block.
+        // The distance is taken modulo 2^32 like the guest's own registers
+        // wrap, a counter stepping away from its bound runs until it wraps
+        // around to it. None are run when it never reaches the bound.
+        inline uint64_t iterations(const uint32_t counter, const uint32_t bound,
+                                   const int32_t step, const bool counts_first,
+                                   const uint64_t limit) {
+            const uint32_t distance = step > 0 ? bound - counter
+                                               : counter - bound;
+            const uint32_t magnitude = step > 0 ? static_cast<uint32_t>(step)
+                                                : 0u - step;
+            if (distance % magnitude != 0) return 0;
+
+            const uint64_t trips =
+                distance / magnitude + (counts_first ? 0 : 1);
+            if (trips <= 1) return 0;
+            return trips - 1 < limit ? trips - 1 : limit;
+        }
+
+        // Accesses of counted loops are checked a page at a time
+        static constexpr uint32_t LOOP_WINDOW = 4096;
+
+        // Host pointer of the first of count accesses of size bytes at base
+        // + offset, each stride bytes after the one before, nullptr when
+        // they have to be checked one by one. count is clamped to the ones
+        // inside of the page of the first access.
+        template <typename Memory>
+        inline uint8_t* stride_window(Memory& memory, const uint32_t base,
+                                      const int32_t offset,
+                                      const int32_t stride,
+                                      const uint32_t size, const bool write,
+                                      uint64_t& count) {
+            if constexpr (HasAccessWindow<Memory>::value) {
+                const uint32_t address = base + offset;
+                if constexpr (Memory::ALIGNED_ACCESS) {
+                    if (address & (size - 1)) return nullptr;
+                }
+
+                const uint32_t start = address & ~(LOOP_WINDOW - 1);
+                const uint32_t in_page = address - start;
+                if (in_page > LOOP_WINDOW - size) return nullptr;
+
+                uint64_t fits = count;
+                if (stride > 0) {
+                    fits = (LOOP_WINDOW - size - in_page) / stride + 1;
+                }
+                else if (stride < 0) {
+                    fits = in_page / (0u - stride) + 1;
+                }
+                if (fits > count) fits = count;
+
+                const uint32_t last =
+                    address + static_cast<uint32_t>(stride * (fits - 1));
+                const uint32_t low = stride < 0 ? last : address;
+                const uint32_t high = (stride < 0 ? address : last) + size;
+                uint8_t* host = memory.get_window(low, high - low, write);
+                if (host == nullptr) return nullptr;
+
+                count = fits;
+                return host + (address - low);
+            }
+            else {
+                (void)memory, (void)base, (void)offset, (void)stride;
+                (void)size, (void)write, (void)count;
+                return nullptr;
+            }
+        }
+
+        // Gives reg_file the state Executor::step leaves behind once the
+        // instruction at index retired of the block failed. Handlers don't
+        // write registers before they can no longer fail, so the PC is the
+        // only state a block defers.
+        template <typename Memory>
+        inline void recover(const RecompiledEntry<Memory>& entry,
+                            const uint32_t retired, RegisterFile& reg_file) {
+            if (retired < entry.precise_from) {
+                reg_file.set_pc(entry.address + (retired + 1) * 4);
+            }
+        }
+    } // namespace Recompiled
+
+    // Guest code recompiled ahead of time to C++ and built into a native
+    // library, see tools/recompile.cpp.
+    //
+    // Addresses without a block, such as the targets of indirect jumps the
+    // recompiler couldn't resolve, are executed by the interpreter.
+    template <typename Memory>
+    class RecompiledLibrary {
+    public:
+        using Module = RecompiledModule<Memory>;
+        using Entry = RecompiledEntry<Memory>;
+
+        RecompiledLibrary() = default;
+        RecompiledLibrary(const RecompiledLibrary&) = delete;
+        RecompiledLibrary& operator=(const RecompiledLibrary&) = delete;
+        ~RecompiledLibrary() { close(); }
+
+        [[nodiscard]] Result<void, RecompiledError> open(const char* path) {
+            close();
+#ifdef MIPS_EMULATOR_HAS_DLOPEN
+            handle = ::dlopen(path, RTLD_NOW | RTLD_LOCAL);
+            if (handle == nullptr) return RecompiledError::open_failed;
+
+            using GetModule = const Module* (*)();
+            const auto get_module = reinterpret_cast<GetModule>(
+                ::dlsym(handle, Recompiled::MODULE_SYMBOL));
+            if (get_module == nullptr) {
+                close();
+                return RecompiledError::missing_module;
+            }
+
+            const auto result = attach(*get_module());
+            if (result.is_error()) close();
+            return result;
+#else
+            (void)path;
+            return RecompiledError::open_failed;
+#endif
+        }
+
+        // Uses a module linked into the emulator itself
+        [[nodiscard]] Result<void, RecompiledError>
+        attach(const Module& new_module) {
+            blocks.clear();
+            module = nullptr;
+
+            if (new_module.version != Recompiled::VERSION) {
+                return RecompiledError::version_mismatch;
+            }
+            if (std::strcmp(new_module.memory_type, typeid(Memory).name())) {
+                return RecompiledError::memory_mismatch;
+            }
+
+            module = &new_module;
+            blocks.reserve(module->count);
+            for (uint32_t i = 0; i < module->count; ++i) {
+                blocks.emplace(module->entries[i].address,
+                               &module->entries[i]);
+            }
+            return {};
+        }
+
+        void close() {
+            blocks.clear();
+            module = nullptr;
+#ifdef MIPS_EMULATOR_HAS_DLOPEN
+            if (handle != nullptr) ::dlclose(handle);
+            handle = nullptr;
+#endif
+        }
+
+        // Checks that memory holds the text the module was recompiled from
+        [[nodiscard]] Result<void, RecompiledError>
+        verify(Memory& memory) const {
+            if (module == nullptr) return RecompiledError::missing_module;
+
+            std::vector<uint32_t> text;
+            for (uint32_t i = 0; i < module->count; ++i) {
+                const Entry& entry = module->entries[i];
+                for (uint32_t j = 0; j < entry.instruction_count; ++j) {
+                    const auto result = memory.fetch(entry.address + j * 4);
+                    if (result.is_error()) {
+                        return RecompiledError::key_mismatch;
+                    }
+                    text.push_back(result.get_value());
+                }
+            }
+
+            const uint64_t key = DecodedImage::hash({text.data(), text.size()});
+            if (key != module->key) return RecompiledError::key_mismatch;
+            return {};
+        }
+
+        const Entry* lookup(const uint32_t address) const {
+            const auto it = blocks.find(address);
+            return it == blocks.end() ? nullptr : it->second;
+        }
+
+        // Whether the guest spins in an idle loop at the PC until the host
+        // changes memory, e.g. a device raises an event. Only holds once the
+        // loop went around at least once.
+        bool is_idle(const RegisterFile& reg_file, Memory& memory) const {
+            const Entry* entry = reg_file.has_delayed_branch()
+                                     ? nullptr
+                                     : lookup(reg_file.get_pc());
+            return entry != nullptr && entry->idle != nullptr &&
+                   entry->idle(reg_file, memory);
+        }
+
+        // Runs until budget instructions have executed, a block is always run
+        // to its end so the budget can be overrun by one block. Returns false
+        // when an instruction fails.
+        //
+        // Idle loops end the run as soon as they loop back, the rest of the
+        // budget passes without executing them since nothing they poll can
+        // change before the run returns. See is_idle.
+        [[nodiscard]] bool run(RegisterFile& reg_file, Memory& memory,
+                               uint64_t budget) const {
+            uint64_t executed = 0;
+            while (executed < budget) {
+                // A pending delay slot has to go through the interpreter,
+                // the block would branch away after its first instruction
+                const Entry* entry = reg_file.has_delayed_branch()
+                                         ? nullptr
+                                         : lookup(reg_file.get_pc());
+                if (entry == nullptr) {
+                    if (!Executor::step(reg_file, memory)) return false;
+                    ++executed;
+                    continue;
+                }
+
+                // Iterations of counted loops that can't fault
+                if (entry->loop != nullptr) {
+                    const uint64_t iterations = entry->loop(
+                        reg_file, memory,
+                        (budget - executed) / entry->instruction_count);
+                    if (iterations != 0) {
+                        executed += iterations * entry->instruction_count;
+                        continue;
+                    }
+                }
+
+                const uint32_t retired = entry->block(reg_file, memory);
+                if (retired != entry->instruction_count) {
+                    Recompiled::recover(*entry, retired, reg_file);
+                    return false;
+                }
+                executed += retired;
+
+                if (entry->idle != nullptr &&
+                    reg_file.get_pc() == entry->address &&
+                    entry->idle(reg_file, memory)) {
+                    return true;
+                }
+            }
+            return true;
+        }
+
+        const Module* get_module() const noexcept { return module; }
+
+    private:
+        const Module* module = nullptr;
+        std::unordered_map<uint32_t, const Entry*> blocks;
+#ifdef MIPS_EMULATOR_HAS_DLOPEN
+        void* handle = nullptr;
+#endif
+    };
+} // namespace mips_emulator
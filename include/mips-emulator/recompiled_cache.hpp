@@ -0,0 +1,187 @@
+#pragma once
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/recompiled.hpp"
+#include "mips-emulator/recompiler.hpp"
+#include "mips-emulator/result.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef MIPS_EMULATOR_HAS_DLOPEN
+#    include <unistd.h>
+#endif
+
+#ifndef MIPS_EMULATOR_CACHE_COMPILER
+#    define MIPS_EMULATOR_CACHE_COMPILER "c++"
+#endif
+
+namespace mips_emulator {
+    // Directory of recompiled libraries shared by every run of the emulator.
+    //
+    // A library is keyed by a hash of the guest text it was translated from,
+    // Recompiled::VERSION, the memory backend and the compile command, so
+    // the first run recompiles and builds it with the host compiler and
+    // every later run dlopens it straight away. Libraries are written under
+    // a temporary name unique to the process and the call and renamed into
+    // place, concurrent runs or threads at worst compile the same library
+    // twice.
+    template <typename Memory>
+    class RecompiledCache {
+    public:
+        // memory_type and memory_header are passed on to Recompiler::emit.
+        // The compile command gets -o <library> <source> appended.
+        RecompiledCache(std::string cache_directory,
+                        std::string memory_type_name,
+                        std::string memory_header_path,
+                        std::string compile_command = default_command())
+            : directory(std::move(cache_directory)),
+              memory_type(std::move(memory_type_name)),
+              memory_header(std::move(memory_header_path)),
+              command(std::move(compile_command)) {}
+
+        static std::string default_command() {
+            std::string command = MIPS_EMULATOR_CACHE_COMPILER
+                " -std=c++17 -O2 -shared -fPIC";
+#ifdef MIPS_EMULATOR_INCLUDE_DIR
+            command += " -I" + quote(MIPS_EMULATOR_INCLUDE_DIR);
+#endif
+            return command;
+        }
+
+        // Quotes argument for the shell, nothing inside of single quotes is
+        // special but the closing quote itself
+        static std::string quote(const std::string_view argument) {
+            std::string quoted = "'";
+            for (const char c : argument) {
+                if (c == '\'') {
+                    quoted += "'\\''";
+                }
+                else {
+                    quoted += c;
+                }
+            }
+            return quoted + "'";
+        }
+
+        // Key of the text reachable from entries in the cache
+        uint64_t get_key(Memory& memory, Span<const uint32_t> entries) {
+            ControlFlowGraph cfg;
+            cfg.recover(memory, entries);
+            return get_key(memory, cfg);
+        }
+
+        // Opens the library of the code reachable from entries, recompiling
+        // it first on a miss. Returns whether it was found in the cache.
+        [[nodiscard]] Result<bool, RecompiledError>
+        load(RecompiledLibrary<Memory>& library, Memory& memory,
+             Span<const uint32_t> entries) {
+            ControlFlowGraph cfg;
+            cfg.recover(memory, entries);
+
+            const std::string path = get_path(get_key(memory, cfg));
+            if (!library.open(path.c_str()).is_error() &&
+                !library.verify(memory).is_error()) {
+                return true;
+            }
+
+            const auto result = compile(cfg, memory, path);
+            if (result.is_error()) return result.get_error();
+
+            const auto open_result = library.open(path.c_str());
+            if (open_result.is_error()) return open_result.get_error();
+            const auto verify_result = library.verify(memory);
+            if (verify_result.is_error()) return verify_result.get_error();
+            return false;
+        }
+
+        std::string get_path(const uint64_t key) const {
+            char name[24];
+            std::snprintf(name, sizeof(name), "%016llx.so",
+                          static_cast<unsigned long long>(key));
+            return directory + "/" + name;
+        }
+
+    private:
+        static uint64_t hash_bytes(uint64_t hash,
+                                   const std::string_view bytes) {
+            // FNV-1a, continuing from hash
+            for (const char byte : bytes) {
+                hash = (hash ^ static_cast<uint8_t>(byte)) * 0x100000001b3;
+            }
+            return hash;
+        }
+
+        uint64_t get_key(Memory& memory, const ControlFlowGraph& cfg) const {
+            std::vector<uint32_t> text;
+            for (const auto& [start, block] : cfg.get_blocks()) {
+                text.push_back(start);
+                for (uint32_t address = start; address < block.end;
+                     address += 4) {
+                    const auto result = memory.fetch(address);
+                    text.push_back(result.is_error() ? 0
+                                                     : result.get_value());
+                }
+            }
+
+            uint64_t key = DecodedImage::hash({text.data(), text.size()});
+            const uint32_t version = Recompiled::VERSION;
+            key = hash_bytes(key, {reinterpret_cast<const char*>(&version),
+                                   sizeof(version)});
+            key = hash_bytes(key, memory_type);
+            key = hash_bytes(key, memory_header);
+            return hash_bytes(key, command);
+        }
+
+        Result<void, RecompiledError> compile(const ControlFlowGraph& cfg,
+                                              Memory& memory,
+                                              const std::string& path) {
+#ifdef MIPS_EMULATOR_HAS_DLOPEN
+            // Threads of one process missing the same key need their own
+            static std::atomic<uint64_t> next_temporary{0};
+            const std::string temporary =
+                path + "." + std::to_string(::getpid()) + "." +
+                std::to_string(next_temporary.fetch_add(1));
+            const std::string source = temporary + ".cpp";
+
+            {
+                std::ofstream stream(source);
+                const auto result = Recompiler::emit(
+                    stream, cfg, memory, memory_type, memory_header);
+                if (result.is_error() || !stream.flush()) {
+                    std::remove(source.c_str());
+                    return RecompiledError::compile_failed;
+                }
+            }
+
+            const std::string compile =
+                command + " -o " + quote(temporary) + " " + quote(source);
+            const bool compiled = std::system(compile.c_str()) == 0;
+            std::remove(source.c_str());
+
+            if (!compiled || std::rename(temporary.c_str(), path.c_str())) {
+                std::remove(temporary.c_str());
+                return RecompiledError::compile_failed;
+            }
+            return {};
+#else
+            (void)cfg;
+            (void)memory;
+            (void)path;
+            return RecompiledError::compile_failed;
+#endif
+        }
+
+        std::string directory;
+        std::string memory_type;
+        std::string memory_header;
+        std::string command;
+    };
+} // namespace mips_emulator
@@ -0,0 +1,573 @@
+#pragma once
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/disassembler.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/instruction_info.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/recompiled.hpp"
+#include "mips-emulator/result.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace mips_emulator {
+    // Translates a recovered control flow graph to C++ with one function per
+    // basic block. Every instruction becomes a Recompiled::step call with
+    // the instruction word as a constant, so the generated code runs the
+    // executor's own handlers against the Memory API and the RegisterFile.
+    //
+    // Instructions ahead of the branch ending a block use Recompiled::execute
+    // instead and the PC is only set before the ones that read it and at the
+    // end of the block. A failing instruction returns its index, which
+    // Recompiled::recover turns back into the PC the interpreter leaves.
+    //
+    // Runs of loads and stores off the same base register, such as $sp or
+    // $gp, are checked once: the block asks the backend for a window over
+    // all of their offsets and accesses it directly, or falls back to the
+    // checked accesses when there's none, e.g. across a page or a device.
+    //
+    // Blocks that loop to themselves and only poll memory, such as a status
+    // register wait, also get an idle function RecompiledLibrary::run uses to
+    // skip the rest of its budget instead of spinning. Counted loops get a
+    // loop function running their iterations back to back, with the trip
+    // count computed on entry.
+    namespace Recompiler {
+        // Loads and stores sharing a base register that isn't written
+        // between them. Instructions [start, end) of the block are covered,
+        // others than the accesses run as usual.
+        struct AccessGroup {
+            uint32_t start = 0;
+            uint32_t end = 0;
+            uint8_t base = 0;
+            uint32_t accesses = 0;
+            // Window relative to the base
+            int32_t low = 0;
+            int32_t high = 0;
+            bool write = false;
+            uint32_t alignment = 1;
+        };
+
+        // Load or store whose offset is a multiple of its size
+        inline bool is_aligned_access(const uint32_t raw) {
+            const OpInfo& info = get_op_info(raw);
+            if (!info.accesses_memory() ||
+                (info.flags & OpFlag::e_pc_relative)) {
+                return false;
+            }
+            const int32_t offset =
+                static_cast<int16_t>(Instruction(raw).get_imm());
+            return offset % info.access_size == 0;
+        }
+
+        // Group of the accesses starting at text[start], none unless there
+        // are at least two. end is where PC relative instructions and the
+        // branch ending the block start.
+        inline AccessGroup find_group(const uint32_t* text,
+                                      const uint32_t start,
+                                      const uint32_t end) {
+            AccessGroup group = {start, start};
+            if (!is_aligned_access(text[start])) return group;
+            group.base = Instruction(text[start]).get_rs();
+
+            for (uint32_t i = start; i < end; ++i) {
+                const uint32_t raw = text[i];
+                const OpInfo& info = get_op_info(raw);
+                if (info.flags & OpFlag::e_pc_relative) break;
+
+                const bool writes_base =
+                    get_register_use(raw).writes & (1u << group.base);
+                const bool member = is_aligned_access(raw) &&
+                                    Instruction(raw).get_rs() == group.base;
+                if (!member) {
+                    if (writes_base) break;
+                    continue;
+                }
+
+                const int32_t offset =
+                    static_cast<int16_t>(Instruction(raw).get_imm());
+                const int32_t high = offset + info.access_size;
+                if (group.accesses == 0 || offset < group.low) {
+                    group.low = offset;
+                }
+                if (group.accesses == 0 || high > group.high) {
+                    group.high = high;
+                }
+                group.write |= (info.flags & OpFlag::e_store) != 0;
+                if (info.access_size > group.alignment) {
+                    group.alignment = info.access_size;
+                }
+                ++group.accesses;
+                group.end = i + 1;
+
+                // Loads into the base end the group after the access
+                if (writes_base) break;
+            }
+
+            if (group.accesses < 2) group.end = start;
+            return group;
+        }
+
+        // Whether the block at address, text[0, count), is an idle loop: it
+        // branches back to itself, stores nothing and every iteration
+        // computes the same values from the same loads. Registers it reads
+        // are never written by the loop or written earlier in the iteration,
+        // and load bases keep their value to the end of it.
+        inline bool is_idle_loop(const uint32_t* text, const uint32_t count,
+                                 const uint32_t address) {
+            uint32_t loop_writes = 0;
+            uint32_t branch = count;
+            for (uint32_t i = 0; i < count; ++i) {
+                loop_writes |= get_register_use(text[i]).writes;
+                if (!get_op_info(text[i]).is_branch()) continue;
+                if (branch != count) return false;
+                branch = i;
+            }
+            if (branch == count) return false;
+
+            const uint32_t branch_address = address + branch * 4;
+            const DecodedInstruction decoded =
+                decode_instruction(branch_address, text[branch]);
+            if ((decoded.flags & DecodeFlag::e_indirect) ||
+                (get_op_info(text[branch]).flags & OpFlag::e_link) ||
+                decoded.target != address ||
+                decoded.get_fall_through(branch_address) !=
+                    address + count * 4) {
+                return false;
+            }
+
+            uint32_t written = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const OpInfo& info = get_op_info(text[i]);
+                const RegisterUse use = get_register_use(text[i]);
+                if ((info.flags & (OpFlag::e_store | OpFlag::e_pc_relative)) ||
+                    (decode_instruction(address + i * 4, text[i]).flags &
+                     DecodeFlag::e_sync) ||
+                    (use.reads & loop_writes & ~written)) {
+                    return false;
+                }
+                written |= use.writes;
+            }
+
+            uint32_t written_after = 0;
+            for (uint32_t i = count; i-- > 0;) {
+                written_after |= get_register_use(text[i]).writes;
+                const uint8_t base = Instruction(text[i]).get_rs();
+                if ((get_op_info(text[i]).flags & OpFlag::e_load) &&
+                    (written_after & (1u << base))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Whether reg is an induction register of the loop text[0, count),
+        // only written by text[index], an addiu adding step to it
+        inline bool find_induction(const uint32_t* text, const uint32_t count,
+                                   const uint8_t reg, int32_t& step,
+                                   uint32_t& index) {
+            uint32_t writes = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (get_register_use(text[i]).writes & (1u << reg)) {
+                    ++writes;
+                    index = i;
+                }
+            }
+            const Instruction instruction(text[index]);
+            if (writes != 1 || decode_op(text[index]) != Op::e_addiu ||
+                instruction.get_rs() != reg) {
+                return false;
+            }
+            step = static_cast<int16_t>(instruction.get_imm());
+            return true;
+        }
+
+        // Block looping to itself while an induction register differs from
+        // a register the loop doesn't write
+        struct CountedLoop {
+            uint32_t branch;
+            uint8_t counter;
+            uint8_t bound;
+            int32_t step;
+            // The counter is stepped before the branch compares it
+            bool counts_first;
+        };
+
+        // Counted loop of the block at address, text[0, count), if it only
+        // does register arithmetic that can't trap and accesses memory
+        // through loop invariant or induction registers
+        inline std::optional<CountedLoop>
+        find_counted_loop(const uint32_t* text, const uint32_t count,
+                          const uint32_t address) {
+            uint32_t loop_writes = 0;
+            uint32_t branch = count;
+            for (uint32_t i = 0; i < count; ++i) {
+                loop_writes |= get_register_use(text[i]).writes;
+                if (!get_op_info(text[i]).is_branch()) continue;
+                if (branch != count) return std::nullopt;
+                branch = i;
+            }
+            if (branch == count) return std::nullopt;
+
+            const uint32_t raw = text[branch];
+            const Op op = decode_op(raw);
+            const uint32_t branch_address = address + branch * 4;
+            const DecodedInstruction decoded =
+                decode_instruction(branch_address, raw);
+            if ((op != Op::e_bne && op != Op::e_bnec && op != Op::e_bnezc) ||
+                decoded.target != address ||
+                decoded.get_fall_through(branch_address) !=
+                    address + count * 4) {
+                return std::nullopt;
+            }
+
+            const Instruction instruction(raw);
+            // BNEZC compares against $zero
+            const uint8_t rs = instruction.get_rs();
+            const uint8_t rt = op == Op::e_bnezc ? 0 : instruction.get_rt();
+            CountedLoop loop = {branch, rs, rt, 0, false};
+            uint32_t index = 0;
+            if (!find_induction(text, count, rs, loop.step, index)) {
+                loop = {branch, rt, rs, 0, false};
+                if (!find_induction(text, count, rt, loop.step, index)) {
+                    return std::nullopt;
+                }
+            }
+            if (loop.step == 0 || (loop_writes & (1u << loop.bound))) {
+                return std::nullopt;
+            }
+            loop.counts_first = index < branch;
+
+            for (uint32_t i = 0; i < count; ++i) {
+                if (i == branch) continue;
+
+                const OpInfo& info = get_op_info(text[i]);
+                if ((info.flags & OpFlag::e_pc_relative) ||
+                    (decode_instruction(address + i * 4, text[i]).flags &
+                     DecodeFlag::e_sync)) {
+                    return std::nullopt;
+                }
+                if (!info.accesses_memory()) {
+                    if (info.can_trap()) return std::nullopt;
+                    continue;
+                }
+
+                const uint8_t base = Instruction(text[i]).get_rs();
+                int32_t stride = 0;
+                if ((loop_writes & (1u << base)) &&
+                    !find_induction(text, count, base, stride, index)) {
+                    return std::nullopt;
+                }
+                if (stride % info.access_size != 0) return std::nullopt;
+            }
+            return loop;
+        }
+
+        inline void write_hex(std::ostream& out, const uint32_t value) {
+            char buffer[11];
+            std::snprintf(buffer, sizeof(buffer), "0x%08x", value);
+            out << buffer;
+        }
+
+        // Writes the name of the block, idle or loop function of the block
+        // at start
+        inline void write_name(std::ostream& out, const char* kind,
+                               const uint32_t start) {
+            char buffer[16];
+            std::snprintf(buffer, sizeof(buffer), "%s_%08x", kind, start);
+            out << buffer;
+        }
+
+        // Writes the idle function of the block at start, see is_idle_loop
+        inline void emit_idle(std::ostream& out, const uint32_t* text,
+                              const uint32_t count, const uint32_t start) {
+            out << "\n    // Idle loop, see Recompiled::poll\n"
+                << "    bool ";
+            write_name(out, "idle", start);
+            bool polls = false;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!(get_op_info(text[i]).flags & OpFlag::e_load)) continue;
+
+                out << (polls ? " &&\n               "
+                              : "(const RegisterFile& reg_file, "
+                                "Memory& memory) {\n        return ")
+                    << "poll<";
+                write_hex(out, text[i]);
+                out << ">(reg_file, memory)";
+                polls = true;
+            }
+            if (!polls) {
+                out << "(const RegisterFile&, Memory&) {\n"
+                    << "        return true";
+            }
+            out << ";\n"
+                << "    }\n";
+        }
+
+        // Writes the loop function of the block at start, which runs its
+        // iterations with the branch left out and the accesses through a
+        // window each
+        inline void emit_loop(std::ostream& out, const uint32_t* text,
+                              const uint32_t count, const uint32_t start,
+                              const CountedLoop& loop) {
+            out << "\n    // Counted loop, see Recompiled::iterations\n"
+                << "    uint64_t ";
+            write_name(out, "loop", start);
+            out << "(RegisterFile& reg_file, Memory& memory, "
+                   "uint64_t limit) {\n"
+                << "        uint64_t count = iterations(reg_file.get("
+                << unsigned(loop.counter) << ").u, reg_file.get("
+                << unsigned(loop.bound) << ").u, " << loop.step << ", "
+                << (loop.counts_first ? "true" : "false") << ", limit);\n"
+                << "        if (count == 0) return 0;\n";
+
+            std::vector<int32_t> strides(count, 0);
+            for (uint32_t i = 0; i < count; ++i) {
+                const OpInfo& info = get_op_info(text[i]);
+                if (i == loop.branch || !info.accesses_memory()) continue;
+
+                // Offset of the first access from the base on entry
+                const Instruction instruction(text[i]);
+                const uint8_t base = instruction.get_rs();
+                int32_t offset = static_cast<int16_t>(instruction.get_imm());
+                uint32_t index = 0;
+                if (find_induction(text, count, base, strides[i], index) &&
+                    index < i) {
+                    offset += strides[i];
+                }
+
+                out << "        uint8_t* host" << i
+                    << " = stride_window(memory, reg_file.get("
+                    << unsigned(base) << ").u, " << offset << ", "
+                    << strides[i] << ", " << unsigned(info.access_size)
+                    << ", "
+                    << ((info.flags & OpFlag::e_store) ? "true" : "false")
+                    << ", count);\n"
+                    << "        if (host" << i << " == nullptr) return 0;\n";
+            }
+
+            out << "        for (uint64_t i = 0; i < count; ++i) {\n";
+            for (uint32_t i = 0; i < count; ++i) {
+                if (i == loop.branch) continue;
+
+                char listing[Disassembler::MAX_TEXT_SIZE];
+                Disassembler::disassemble(start + i * 4, text[i],
+                                          {listing, sizeof(listing)});
+                out << "            // " << listing << "\n";
+                if (!get_op_info(text[i]).accesses_memory()) {
+                    out << "            execute<";
+                    write_hex(out, text[i]);
+                    out << ">(reg_file, memory);\n";
+                    continue;
+                }
+
+                out << "            access<";
+                write_hex(out, text[i]);
+                out << ", Memory>(reg_file, host" << i << ");\n";
+                if (strides[i] != 0) {
+                    out << "            host" << i << " += " << strides[i]
+                        << ";\n";
+                }
+            }
+            out << "        }\n"
+                << "        return count;\n"
+                << "    }\n";
+        }
+
+        // Writes the translation unit of a recompiled library. memory_type
+        // is the C++ type of the memory backend the emulator runs the
+        // library with and memory_header the header declaring it. Both can
+        // be overridden by defining MIPS_RECOMPILED_MEMORY when building.
+        template <typename Memory>
+        [[nodiscard]] Result<void, MemoryError>
+        emit(std::ostream& out, const ControlFlowGraph& cfg, Memory& memory,
+             const std::string_view memory_type,
+             const std::string_view memory_header) {
+            out << "// Generated by mips_emulator_recompile, do not edit\n"
+                << "#include \"mips-emulator/recompiled.hpp\"\n\n"
+                << "#ifndef MIPS_RECOMPILED_MEMORY\n"
+                << "#    include \"" << memory_header << "\"\n"
+                << "#    define MIPS_RECOMPILED_MEMORY " << memory_type << "\n"
+                << "#endif\n\n"
+                << "namespace {\n"
+                << "    using namespace mips_emulator;\n"
+                << "    using Memory = MIPS_RECOMPILED_MEMORY;\n"
+                << "    using Recompiled::access;\n"
+                << "    using Recompiled::execute;\n"
+                << "    using Recompiled::iterations;\n"
+                << "    using Recompiled::poll;\n"
+                << "    using Recompiled::step;\n"
+                << "    using Recompiled::stride_window;\n";
+
+            std::vector<uint32_t> text;
+            std::vector<const BasicBlock*> blocks;
+            std::vector<uint32_t> precise_from;
+            std::vector<bool> idle;
+            std::vector<bool> loops;
+            for (const auto& [start, block] : cfg.get_blocks()) {
+                if (block.end == block.start) continue;
+                blocks.push_back(&block);
+
+                const std::size_t first = text.size();
+                for (uint32_t address = block.start; address < block.end;
+                     address += 4) {
+                    const auto result = memory.fetch(address);
+                    if (result.is_error()) return result.get_error();
+                    text.push_back(result.get_value());
+                }
+
+                const uint32_t count = block.get_instruction_count();
+                uint32_t precise = 0;
+                while (precise < count &&
+                       !get_op_info(text[first + precise]).is_branch()) {
+                    ++precise;
+                }
+                precise_from.push_back(precise);
+
+                out << "\n    // ";
+                write_hex(out, block.start);
+                out << " - ";
+                write_hex(out, block.end);
+                out << "\n    uint32_t ";
+                write_name(out, "block", block.start);
+                out << "(RegisterFile& reg_file, Memory& memory) {\n";
+
+                // Whether the PC holds the address of the instruction up next
+                bool pc_set = true;
+                const auto set_pc = [&](const uint32_t address) {
+                    out << "        reg_file.set_pc(";
+                    write_hex(out, address);
+                    out << ");\n";
+                };
+
+                // Instruction i, through the window when host is set
+                const auto emit_instruction = [&](const uint32_t i,
+                                                  const char* indent,
+                                                  const AccessGroup* host) {
+                    const uint32_t address = block.start + i * 4;
+                    const uint32_t raw = text[first + i];
+                    const bool reads_pc = i >= precise ||
+                                          (get_op_info(raw).flags &
+                                           OpFlag::e_pc_relative);
+                    if (reads_pc && !pc_set) set_pc(address);
+                    pc_set = reads_pc;
+
+                    char listing[Disassembler::MAX_TEXT_SIZE];
+                    Disassembler::disassemble(address, raw,
+                                              {listing, sizeof(listing)});
+                    out << indent << "// " << listing << "\n" << indent;
+
+                    const Instruction instruction(raw);
+                    const bool member = host != nullptr &&
+                                        is_aligned_access(raw) &&
+                                        instruction.get_rs() == host->base;
+                    if (member) {
+                        const int32_t offset =
+                            static_cast<int16_t>(instruction.get_imm()) -
+                            host->low;
+                        out << "access<";
+                        write_hex(out, raw);
+                        out << ", Memory>(reg_file, host + " << offset
+                            << ");\n";
+                        return;
+                    }
+
+                    out << "if (!" << (reads_pc ? "step<" : "execute<");
+                    write_hex(out, raw);
+                    out << ">(reg_file, memory)) return " << i << ";\n";
+                };
+
+                for (uint32_t i = 0; i < count; ++i) {
+                    const AccessGroup group =
+                        i < precise ? find_group(&text[first], i, precise)
+                                    : AccessGroup{i, i};
+                    if (group.end == i) {
+                        emit_instruction(i, "        ", nullptr);
+                        continue;
+                    }
+
+                    out << "        if (uint8_t* host = Recompiled::window("
+                        << "memory, reg_file.get(" << unsigned(group.base)
+                        << ").u, " << group.low << ", "
+                        << group.high - group.low << ", "
+                        << (group.write ? "true" : "false") << ", "
+                        << group.alignment << ")) {\n";
+                    for (uint32_t j = i; j < group.end; ++j) {
+                        emit_instruction(j, "            ", &group);
+                    }
+                    out << "        }\n"
+                        << "        else {\n";
+                    for (uint32_t j = i; j < group.end; ++j) {
+                        emit_instruction(j, "            ", nullptr);
+                    }
+                    out << "        }\n";
+                    i = group.end - 1;
+                }
+                if (!pc_set) set_pc(block.end);
+                out << "        return " << count << ";\n"
+                    << "    }\n";
+
+                idle.push_back(is_idle_loop(&text[first], count, block.start));
+                if (idle.back()) {
+                    emit_idle(out, &text[first], count, block.start);
+                }
+
+                const auto loop =
+                    find_counted_loop(&text[first], count, block.start);
+                loops.push_back(loop.has_value());
+                if (loop) {
+                    emit_loop(out, &text[first], count, block.start, *loop);
+                }
+            }
+
+            if (!blocks.empty()) {
+                out << "\n    const RecompiledEntry<Memory> ENTRIES[] = {\n";
+                for (std::size_t i = 0; i < blocks.size(); ++i) {
+                    const BasicBlock* block = blocks[i];
+                    out << "        {";
+                    write_hex(out, block->start);
+                    out << ", " << block->get_instruction_count() << ", "
+                        << precise_from[i] << ", ";
+                    write_name(out, "block", block->start);
+                    out << ", ";
+                    if (idle[i]) {
+                        write_name(out, "idle", block->start);
+                    }
+                    else {
+                        out << "nullptr";
+                    }
+                    out << ", ";
+                    if (loops[i]) {
+                        write_name(out, "loop", block->start);
+                    }
+                    else {
+                        out << "nullptr";
+                    }
+                    out << "},\n";
+                }
+                out << "    };\n";
+            }
+            out << "\n    const RecompiledModule<Memory> MODULE = {\n"
+                << "        Recompiled::VERSION,\n"
+                << "        typeid(Memory).name(),\n"
+                << "        " << DecodedImage::hash({text.data(), text.size()})
+                << "ull,\n"
+                << "        " << blocks.size() << ",\n"
+                << "        " << (blocks.empty() ? "nullptr" : "ENTRIES")
+                << ",\n"
+                << "    };\n"
+                << "} // namespace\n\n"
+                << "extern \"C\" const mips_emulator::RecompiledModule<\n"
+                << "    MIPS_RECOMPILED_MEMORY>*\n"
+                << "mips_emulator_recompiled_module() {\n"
+                << "    return &MODULE;\n"
+                << "}\n";
+
+            return {};
+        }
+    } // namespace Recompiler
+} // namespace mips_emulator
@@ -90,6 +90,8 @@ namespace mips_emulator {
             branch_target = target;
         }
 
+        bool has_delayed_branch() const noexcept { return branch_flag; }
+
         void update_pc() noexcept {
             inc_pc();
             pc += branch_flag * (branch_target - pc);
@@ -104,7 +106,15 @@ namespace mips_emulator {
             cause_register = cause;
         }
 
+        // Address errors also record the offending virtual address
+        void signal_exception(const Exception cause, const uint32_t instr,
+                              const uint32_t vaddr) noexcept {
+            bad_vaddr = vaddr;
+            signal_exception(cause, instr);
+        }
+
         uint32_t get_bad_instr() const noexcept { return bad_instr; }
+        uint32_t get_bad_vaddr() const noexcept { return bad_vaddr; }
         uint8_t get_cause_register() const noexcept {
             return static_cast<uint8_t>(cause_register);
         }
@@ -117,6 +127,10 @@ namespace mips_emulator {
         // exception/trap)
         Unsigned bad_instr = 0;
 
+        // bad_vaddr (BadVAddr in docs) contains the address that caused the
+        // most recent address error exception
+        Unsigned bad_vaddr = 0;
+
         // cause register contains the cause of a signaled exception
         Exception cause_register;
 
@@ -4,20 +4,14 @@ namespace mips_emulator {
     template <typename Value, typename Error>
     class Result {
     public:
-        [[nodiscard]] bool is_error() const { return is_err; }
+        [[nodiscard]] constexpr bool is_error() const { return is_err; }
 
-        [[nodiscard]] Value get_value() const { return value; }
-        [[nodiscard]] Error get_error() const { return error; }
+        [[nodiscard]] constexpr Value get_value() const { return value; }
+        [[nodiscard]] constexpr Error get_error() const { return error; }
 
-        Result(Value val) {
-            is_err = false;
-            value = val;
-        }
+        constexpr Result(Value val) : is_err(false), value(val) {}
 
-        Result(Error err) {
-            is_err = true;
-            error = err;
-        }
+        constexpr Result(Error err) : is_err(true), error(err) {}
 
     private:
         bool is_err;
@@ -30,16 +24,13 @@ namespace mips_emulator {
     template <typename Value>
     class Result<Value, void> {
     public:
-        [[nodiscard]] bool is_error() const { return is_err; }
+        [[nodiscard]] constexpr bool is_error() const { return is_err; }
 
-        [[nodiscard]] Value get_value() const { return value; }
+        [[nodiscard]] constexpr Value get_value() const { return value; }
 
-        Result() { is_err = true; }
+        constexpr Result() : is_err(true), value() {}
 
-        Result(Value val) {
-            is_err = false;
-            value = val;
-        }
+        constexpr Result(Value val) : is_err(false), value(val) {}
 
     private:
         bool is_err;
@@ -49,16 +40,13 @@ namespace mips_emulator {
     template <typename Error>
     class Result<void, Error> {
     public:
-        [[nodiscard]] bool is_error() const { return is_err; }
+        [[nodiscard]] constexpr bool is_error() const { return is_err; }
 
-        [[nodiscard]] Error get_error() const { return error; }
+        [[nodiscard]] constexpr Error get_error() const { return error; }
 
-        Result() { is_err = false; }
+        constexpr Result() : is_err(false), error() {}
 
-        Result(Error err) {
-            is_err = true;
-            error = err;
-        }
+        constexpr Result(Error err) : is_err(true), error(err) {}
 
     private:
         bool is_err;
@@ -5,20 +5,22 @@
 
 namespace mips_emulator {
 
-    template <typename MMIOHandler = NullMMIO>
+    template <typename MMIOHandler = NullMMIO,
+              Endian endian = Endian::e_little>
     class RuntimeStaticMemory
-        : public Memory<RuntimeStaticMemory<MMIOHandler>, MMIOHandler> {
+        : public Memory<RuntimeStaticMemory<MMIOHandler, endian>, MMIOHandler,
+                        false, endian> {
     public:
         RuntimeStaticMemory(const uint32_t size, const uint32_t offset = 0,
                             std::shared_ptr<MMIOHandler> mmio = nullptr)
-            : Memory<RuntimeStaticMemory<MMIOHandler>, MMIOHandler>(
-                  offset, std::move(mmio)),
+            : Memory<RuntimeStaticMemory<MMIOHandler, endian>, MMIOHandler,
+                     false, endian>(offset, std::move(mmio)),
               memory(size) {}
 
         RuntimeStaticMemory(std::vector<uint8_t> mem, const uint32_t offset = 0,
                             std::shared_ptr<MMIOHandler> mmio = nullptr)
-            : Memory<RuntimeStaticMemory<MMIOHandler>, MMIOHandler>(
-                  offset, std::move(mmio)),
+            : Memory<RuntimeStaticMemory<MMIOHandler, endian>, MMIOHandler,
+                     false, endian>(offset, std::move(mmio)),
               memory(std::move(mem)) {}
 
         uint8_t* get_memory() { return &memory[0]; }
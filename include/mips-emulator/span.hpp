@@ -6,15 +6,15 @@ namespace mips_emulator {
     template <typename T>
     class Span {
     public:
-        Span(T* data, std::size_t size) : data(data), size(size) {}
+        constexpr Span(T* data, std::size_t size) : data(data), size(size) {}
 
-        T* get_data() noexcept { data; }
-        const T* get_data() const noexcept { data; }
+        constexpr T* get_data() noexcept { return data; }
+        constexpr const T* get_data() const noexcept { return data; }
 
-        std::size_t get_size() const noexcept { return size; }
+        constexpr std::size_t get_size() const noexcept { return size; }
 
-        T& operator[](std::size_t i) { return data[i]; }
-        const T& operator[](std::size_t i) const { return data[i]; }
+        constexpr T& operator[](std::size_t i) { return data[i]; }
+        constexpr const T& operator[](std::size_t i) const { return data[i]; }
 
     private:
         T* data;
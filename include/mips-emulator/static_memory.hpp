@@ -2,16 +2,18 @@
 #include "mips-emulator/memory.hpp"
 
 namespace mips_emulator {
-    template <uint32_t SIZE, typename MMIOHandler = NullMMIO>
+    template <uint32_t SIZE, typename MMIOHandler = NullMMIO,
+              Endian endian = Endian::e_little>
     class StaticMemory
-        : public Memory<StaticMemory<SIZE, MMIOHandler>, MMIOHandler> {
+        : public Memory<StaticMemory<SIZE, MMIOHandler, endian>, MMIOHandler,
+                        false, endian> {
     public:
         static_assert(SIZE != 0, "SIZE of StaticMemory can't be zero");
 
         StaticMemory(const uint32_t offset = 0,
                      std::shared_ptr<MMIOHandler> mmio_handler = nullptr)
-            : Memory<StaticMemory<SIZE, MMIOHandler>, MMIOHandler>(
-                  offset, mmio_handler) {}
+            : Memory<StaticMemory<SIZE, MMIOHandler, endian>, MMIOHandler,
+                     false, endian>(offset, mmio_handler) {}
 
         uint8_t* get_memory() { return &memory[0]; }
         uint32_t get_size() const { return SIZE; }
@@ -0,0 +1,307 @@
+#pragma once
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/memory.hpp"
+#include "mips-emulator/span.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mips_emulator {
+    // A page of decoded text
+    struct DecodedPage {
+        static constexpr uint32_t SIZE = 4096;
+        static constexpr uint32_t MASK = SIZE - 1;
+        static constexpr uint32_t WORDS = SIZE / 4;
+
+        uint32_t address;
+        // Hash of the page's text
+        uint64_t key;
+        std::array<DecodedInstruction, WORDS> instructions;
+    };
+
+    // Inline cache of one load or store instruction. Sites almost always
+    // access the same kind of memory, so the page the last access hit is
+    // kept along with its window, or the MMIO handler serving all of it.
+    // A single compare of the tag against the page and the memory's
+    // generation picks the path, pages with neither are left to read and
+    // store.
+    struct AccessSite {
+        static constexpr uint32_t PAGE_SIZE = DecodedPage::SIZE;
+        static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+        static constexpr uint64_t get_tag(const uint32_t address,
+                                          const uint32_t generation) {
+            return (uint64_t{generation} << 32) | (address & ~PAGE_MASK);
+        }
+
+        // Never matches, page addresses are aligned
+        uint64_t tag = 1;
+        uint8_t* host = nullptr;
+        // See HasDeviceAccess
+        void* device = nullptr;
+    };
+
+    // Decoded pages shared by every emulator instance running the same
+    // image, e.g. one per host thread.
+    //
+    // NOTE: Pages are never evicted, every version of a page's text takes a
+    // page of its own. Once max_pages are published insert returns nullptr
+    // and new text runs in the interpreter, TranslationMap bounds how many
+    // versions of one page an instance publishes.
+    //
+    // Pages are keyed by their address and a hash of their text, so
+    // instances only share a page while they hold identical code there. The
+    // text itself is compared too, hash collisions are misses.
+    // Published pages are immutable and live as long as the cache, lookups
+    // are a few atomic loads and never take the lock, only decoding a new
+    // page does.
+    class TranslationCache {
+    public:
+        explicit TranslationCache(const uint32_t max_pages = 4096)
+            : capacity(max_pages), slot_count(get_slot_count(max_pages)),
+              slots(new std::atomic<const DecodedPage*>[slot_count]) {
+            for (uint32_t i = 0; i < slot_count; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+            pages.reserve(max_pages);
+        }
+
+        static_assert(std::atomic<const DecodedPage*>::is_always_lock_free,
+                      "Lookups have to be lock free");
+
+        // Page decoded from text at address, key being the hash of text
+        const DecodedPage* find(const uint32_t address, const uint64_t key,
+                                Span<const uint32_t> text) const {
+            for (uint32_t i = 0, slot = get_slot(address, key); i < slot_count;
+                 ++i, slot = (slot + 1) & (slot_count - 1)) {
+                const DecodedPage* page =
+                    slots[slot].load(std::memory_order_acquire);
+                if (page == nullptr) return nullptr;
+                if (page->address == address && page->key == key &&
+                    holds(*page, text)) {
+                    return page;
+                }
+            }
+            return nullptr;
+        }
+
+        // Returns the shared page decoded from text, decoding it unless
+        // another instance already has. Returns nullptr once the cache is
+        // full.
+        const DecodedPage* insert(const uint32_t address,
+                                  Span<const uint32_t> text) {
+            const uint64_t key = DecodedImage::hash(text);
+            if (const DecodedPage* page = find(address, key, text)) {
+                return page;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (const DecodedPage* page = find(address, key, text)) {
+                return page;
+            }
+            if (pages.size() >= capacity) return nullptr;
+
+            auto page = std::make_unique<DecodedPage>();
+            page->address = address;
+            page->key = key;
+            for (uint32_t i = 0; i < DecodedPage::WORDS; ++i) {
+                page->instructions[i] =
+                    decode_instruction(address + i * 4, text[i]);
+            }
+
+            uint32_t slot = get_slot(address, key);
+            while (slots[slot].load(std::memory_order_relaxed) != nullptr) {
+                slot = (slot + 1) & (slot_count - 1);
+            }
+            slots[slot].store(page.get(), std::memory_order_release);
+            pages.push_back(std::move(page));
+            return pages.back().get();
+        }
+
+        // Fetches and decodes the page at address, nullptr if any of its
+        // words can't be fetched
+        template <typename Memory>
+        const DecodedPage* translate(Memory& memory, const uint32_t address) {
+            std::array<uint32_t, DecodedPage::WORDS> text;
+            for (uint32_t i = 0; i < DecodedPage::WORDS; ++i) {
+                const auto result = memory.fetch(address + i * 4);
+                if (result.is_error()) return nullptr;
+                text[i] = result.get_value();
+            }
+            return insert(address, {text.data(), text.size()});
+        }
+
+        std::size_t get_size() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return pages.size();
+        }
+
+    private:
+        static uint32_t get_slot_count(const uint32_t max_pages) {
+            // At most half full
+            uint32_t count = 2;
+            while (count < max_pages * 2) count *= 2;
+            return count;
+        }
+
+        static bool holds(const DecodedPage& page, Span<const uint32_t> text) {
+            if (text.get_size() != DecodedPage::WORDS) return false;
+            for (uint32_t i = 0; i < DecodedPage::WORDS; ++i) {
+                if (page.instructions[i].raw != text[i]) return false;
+            }
+            return true;
+        }
+
+        uint32_t get_slot(const uint32_t address, const uint64_t key) const {
+            const uint64_t hash = (key ^ address) * 0x9e3779b97f4a7c15;
+            return static_cast<uint32_t>(hash >> 32) & (slot_count - 1);
+        }
+
+        // Pages published at most, the table is at most half full then
+        const uint32_t capacity;
+        const uint32_t slot_count;
+        std::unique_ptr<std::atomic<const DecodedPage*>[]> slots;
+
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<DecodedPage>> pages;
+    };
+
+    // How a TranslationMap learns that translated text was modified
+    enum class InvalidationMode : uint8_t {
+        // Translated pages are write protected on backends with code
+        // protection, stores to them drop the page
+        e_write_protect,
+        // The guest follows the architected protocol, only SYNCI, CACHE and
+        // hazard barriers (JR.HB, JALR.HB) drop pages. Pages aren't write
+        // protected so stores never leave the fast path.
+        e_explicit,
+    };
+
+    // The pages one emulator instance executes, each one shared through a
+    // TranslationCache.
+    //
+    // On backends with code protection translated pages are write protected
+    // and dropped by the first store to them, given the map is registered
+    // as the memory's CodeWriteListener. Pages that keep being written to
+    // are left to the interpreter after MAX_INVALIDATIONS.
+    //
+    // NOTE: Elsewhere, or in InvalidationMode::e_explicit, pages are looked
+    // up once and kept until the guest or the caller invalidates them. In
+    // InvalidationMode::e_explicit each retranslation that finds different
+    // text counts as an invalidation, so that a guest generating code into
+    // the same page doesn't fill the shared cache.
+    //
+    // The AccessSites of a page's loads and stores are per instance, they
+    // are allocated next to the shared page the first time one is used.
+    class TranslationMap : public CodeWriteListener {
+    public:
+        static constexpr uint32_t MAX_INVALIDATIONS = 8;
+
+        explicit TranslationMap(
+            std::shared_ptr<TranslationCache> shared,
+            const InvalidationMode invalidation_mode =
+                InvalidationMode::e_write_protect)
+            : cache(std::move(shared)), mode(invalidation_mode) {}
+
+        template <typename Memory>
+        const DecodedInstruction* lookup(Memory& memory,
+                                         const uint32_t address) {
+            if ((address & 3) != 0) return nullptr;
+
+            const uint32_t page_address = address & ~DecodedPage::MASK;
+            if (last == nullptr || last->page->address != page_address) {
+                auto it = pages.find(page_address);
+                if (it == pages.end()) {
+                    const DecodedPage* page = translate(memory, page_address);
+                    it = pages.emplace(page_address, PageState{page}).first;
+                }
+                if (it->second.page == nullptr) return nullptr;
+                last = &it->second;
+            }
+            return &last->page->instructions[(address & DecodedPage::MASK) / 4];
+        }
+
+        // Site of the instruction at address, which lookup has to have
+        // returned last
+        AccessSite& get_site(const uint32_t address) {
+            if (last->sites == nullptr) {
+                last->sites =
+                    std::make_unique<AccessSite[]>(DecodedPage::WORDS);
+            }
+            return last->sites[(address & DecodedPage::MASK) / 4];
+        }
+
+        void invalidate(const uint32_t address) {
+            pages.erase(address & ~DecodedPage::MASK);
+            last = nullptr;
+        }
+
+        // Drops every page, keeping their invalidation counts
+        void invalidate_all() {
+            pages.clear();
+            last = nullptr;
+        }
+
+        void code_written(const uint32_t page_address) override {
+            ++invalidations[page_address];
+            invalidate(page_address);
+        }
+
+        void clear() {
+            invalidate_all();
+            invalidations.clear();
+            versions.clear();
+        }
+
+        const std::shared_ptr<TranslationCache>& get_cache() const noexcept {
+            return cache;
+        }
+
+        InvalidationMode get_mode() const noexcept { return mode; }
+
+    private:
+        template <typename Memory>
+        const DecodedPage* translate(Memory& memory,
+                                     const uint32_t page_address) {
+            const auto it = invalidations.find(page_address);
+            if (it != invalidations.end() && it->second >= MAX_INVALIDATIONS) {
+                return nullptr;
+            }
+
+            const DecodedPage* page = cache->translate(memory, page_address);
+            if (mode == InvalidationMode::e_explicit && page != nullptr) {
+                const DecodedPage*& version = versions[page_address];
+                if (version != nullptr && version != page) {
+                    ++invalidations[page_address];
+                }
+                version = page;
+            }
+            if constexpr (HasCodeProtection<Memory>::value) {
+                if (mode == InvalidationMode::e_write_protect &&
+                    page != nullptr &&
+                    memory.protect_code(page_address).is_error()) {
+                    return nullptr;
+                }
+            }
+            return page;
+        }
+
+        struct PageState {
+            const DecodedPage* page = nullptr;
+            std::unique_ptr<AccessSite[]> sites = nullptr;
+        };
+
+        std::shared_ptr<TranslationCache> cache;
+        InvalidationMode mode;
+        std::unordered_map<uint32_t, PageState> pages;
+        std::unordered_map<uint32_t, uint32_t> invalidations;
+        // Page each address was last translated to, in e_explicit mode
+        std::unordered_map<uint32_t, const DecodedPage*> versions;
+        PageState* last = nullptr;
+    };
+} // namespace mips_emulator
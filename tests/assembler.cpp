@@ -0,0 +1,359 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/register_name.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string_view>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    using IOp = Instruction::ITypeOpcode;
+    using JOp = Instruction::JTypeOpcode;
+    using Func = Instruction::Func;
+    using Reg = RegisterName;
+
+    // Sums 1..10 into v0 and stores it at result
+    constexpr std::string_view FIRMWARE_SOURCE = R"(
+        # Entry point
+        start:  addiu $v0, $zero, 0
+                addiu $a0, $zero, 10
+        loop:   addu  $v0, $v0, $a0     # accumulate
+                addiu $a0, $a0, -1
+                bne   $a0, $zero, loop
+                nop
+                sw    $v0, 0x1020($zero)
+        done:   bc    done
+        result: .word 0xffffffff
+    )";
+
+    constexpr uint32_t ORIGIN = 0x1000;
+
+    constexpr auto FIRMWARE =
+        Assembler::assemble_firmware<Assembler::count_words(
+            FIRMWARE_SOURCE)>(FIRMWARE_SOURCE, ORIGIN);
+
+    static_assert(FIRMWARE.get_size() == 9);
+    static_assert(FIRMWARE.words[0] == 0x24020000);
+    static_assert(FIRMWARE.words[8] == 0xffffffff);
+    static_assert(FIRMWARE.decoded[4].is_branch());
+    static_assert(FIRMWARE.decoded[4].target == ORIGIN + 8);
+    static_assert(FIRMWARE.decoded[2].is_leader());
+    static_assert(FIRMWARE.decoded[7].target == ORIGIN + 7 * 4);
+    static_assert(!FIRMWARE.decoded[8].is_valid());
+
+    std::vector<uint32_t> assemble(const std::string_view source,
+                                   const uint32_t origin = ORIGIN) {
+        Assembler::LabelTable<16> labels;
+        std::vector<uint32_t> words;
+        const auto result =
+            Assembler::assemble(source, origin, labels, [&](uint32_t word) {
+                words.push_back(word);
+            });
+        REQUIRE_FALSE(result.is_error());
+        REQUIRE(result.get_value() == words.size() * 4);
+        return words;
+    }
+
+    AssemblyError assemble_error(const std::string_view source) {
+        Assembler::LabelTable<2> labels;
+        const auto result =
+            Assembler::assemble(source, ORIGIN, labels, [](uint32_t) {});
+        REQUIRE(result.is_error());
+        return result.get_error();
+    }
+} // namespace
+
+TEST_CASE("assemble instructions", "[Assembler]") {
+    SECTION("R-Type") {
+        REQUIRE(assemble("addu $t0, $t1, $t2\n"
+                         "mul $v0, $a0, $a1\n"
+                         "sll $t0, $t1, 4\n"
+                         "rotrv $t0, $t1, $t2\n"
+                         "clz $t0, $t1\n"
+                         "jr $ra\n"
+                         "teq $t0, $0\n"
+                         "nop") ==
+                std::vector<uint32_t>{
+                    Instruction(Func::e_addu, Reg::e_t0, Reg::e_t1, Reg::e_t2)
+                        .raw,
+                    Instruction(Func::e_sop30, Reg::e_v0, Reg::e_a0, Reg::e_a1,
+                                2)
+                        .raw,
+                    Instruction(Func::e_sll, Reg::e_t0, Reg::e_0, Reg::e_t1, 4)
+                        .raw,
+                    Instruction(Func::e_srlv, Reg::e_t0, Reg::e_t2, Reg::e_t1,
+                                1)
+                        .raw,
+                    Instruction(Func::e_clz, Reg::e_t0, Reg::e_t1, Reg::e_0, 1)
+                        .raw,
+                    Instruction(Func::e_jr, Reg::e_0, Reg::e_ra, Reg::e_0).raw,
+                    Instruction(Func::e_teq, Reg::e_0, Reg::e_t0, Reg::e_0).raw,
+                    0,
+                });
+    }
+
+    SECTION("I-Type") {
+        REQUIRE(assemble("addiu $sp, $sp, -16\n"
+                         "ori $t0, $t0, 0xffff\n"
+                         "lui $at, 0x1234\n"
+                         "lw $ra, 12($sp)\n"
+                         "sb $t0, ($a0)") ==
+                std::vector<uint32_t>{
+                    Instruction(IOp::e_addiu, Reg::e_sp, Reg::e_sp, 0xfff0).raw,
+                    Instruction(IOp::e_ori, Reg::e_t0, Reg::e_t0, 0xffff).raw,
+                    Instruction(IOp::e_aui, Reg::e_at, Reg::e_0, 0x1234).raw,
+                    Instruction(IOp::e_lw, Reg::e_ra, Reg::e_sp, 12).raw,
+                    Instruction(IOp::e_sb, Reg::e_t0, Reg::e_a0, 0).raw,
+                });
+    }
+
+    SECTION("immediate bounds") {
+        REQUIRE(assemble("li $t0, 0x7fff\n"
+                         "li $t0, -0x8000\n"
+                         "addiu $t0, $zero, 0x7fff\n"
+                         "slti $t0, $t1, -0x8000\n"
+                         "andi $t0, $t1, 0\n"
+                         "xori $t0, $t1, 0xffff\n"
+                         "lui $t0, 0xffff") ==
+                std::vector<uint32_t>{
+                    Instruction(IOp::e_addiu, Reg::e_t0, Reg::e_0, 0x7fff).raw,
+                    Instruction(IOp::e_addiu, Reg::e_t0, Reg::e_0, 0x8000).raw,
+                    Instruction(IOp::e_addiu, Reg::e_t0, Reg::e_0, 0x7fff).raw,
+                    Instruction(IOp::e_slti, Reg::e_t0, Reg::e_t1, 0x8000).raw,
+                    Instruction(IOp::e_andi, Reg::e_t0, Reg::e_t1, 0).raw,
+                    Instruction(IOp::e_xori, Reg::e_t0, Reg::e_t1, 0xffff).raw,
+                    Instruction(IOp::e_aui, Reg::e_t0, Reg::e_0, 0xffff).raw,
+                });
+    }
+
+    SECTION("branches and forward references") {
+        const auto words = assemble("beq $t0, $t1, forward\n"
+                                    "back: nop\n"
+                                    "bgez $t0, back\n"
+                                    "bc back\n"
+                                    "beqc $t1, $t0, forward\n"
+                                    "beqzc $t0, back\n"
+                                    "j forward\n"
+                                    "forward: .word back");
+        REQUIRE(words ==
+                std::vector<uint32_t>{
+                    Instruction(IOp::e_beq, Reg::e_t1, Reg::e_t0, 6).raw,
+                    0,
+                    Instruction(Instruction::RegimmITypeOp::e_bgez, Reg::e_t0,
+                                0xfffe)
+                        .raw,
+                    Instruction(JOp::e_bc, 0x3fffffd).raw,
+                    Instruction(IOp::e_pop10, Reg::e_t1, Reg::e_t0, 2).raw,
+                    Instruction(IOp::e_pop66, Reg::e_t0, 0).raw | 0x1ffffb,
+                    Instruction(JOp::e_j, (ORIGIN + 0x1c) >> 2).raw,
+                    ORIGIN + 4,
+                });
+
+        for (uint32_t i = 0; i < words.size(); ++i) {
+            const auto decoded = decode_instruction(ORIGIN + i * 4, words[i]);
+            if (!decoded.is_branch()) continue;
+            REQUIRE((decoded.target == ORIGIN + 4 ||
+                     decoded.target == ORIGIN + 0x1c));
+        }
+    }
+
+    SECTION("special3 and pc relative") {
+        REQUIRE(assemble("ext $t0, $t1, 4, 8\n"
+                         "ins $t0, $t1, 4, 8\n"
+                         "seb $t0, $t1\n"
+                         "align $t0, $t1, $t2, 2\n"
+                         "auipc $t0, 0x10\n"
+                         "lwpc $t0, -1") ==
+                std::vector<uint32_t>{
+                    Instruction(Instruction::Special3Func::e_ext, 4, 7,
+                                Reg::e_t1, Reg::e_t0)
+                        .raw,
+                    Instruction(Instruction::Special3Func::e_ins, 4, 11,
+                                Reg::e_t1, Reg::e_t0)
+                        .raw,
+                    Instruction(Instruction::Special3Func::e_bshfl,
+                                Instruction::Special3BSHFLFunc::e_seb,
+                                Reg::e_t0, Reg::e_t1)
+                        .raw,
+                    Instruction(Instruction::Special3Func::e_bshfl,
+                                Instruction::Special3BSHFLFunc::e_align_2,
+                                Reg::e_t0, Reg::e_t1, Reg::e_t2)
+                        .raw,
+                    Instruction(Reg::e_t0, Instruction::PCRelFunc2::e_auipc,
+                                0x10)
+                        .raw,
+                    Instruction(Reg::e_t0, Instruction::PCRelFunc1::e_lwpc,
+                                0x7ffff)
+                        .raw,
+                });
+    }
+}
+
+TEST_CASE("assembler errors", "[Assembler]") {
+    using E = AssemblerError;
+
+    const auto check = [](const std::string_view source, const E error,
+                          const uint32_t line) {
+        const AssemblyError result = assemble_error(source);
+        REQUIRE(result.error == error);
+        REQUIRE(result.line == line);
+    };
+
+    check("nop\nfoo $t0", E::unknown_mnemonic, 2);
+    check("addu $t0, $t1", E::invalid_operand, 1);
+    check("addu $t0, $t1, $t32", E::invalid_register, 1);
+    check("addiu $t0, $t1, 0x10000", E::out_of_range, 1);
+    // Sign extended immediates would change value
+    check("li $t0, 0x8000", E::out_of_range, 1);
+    check("li $t1, 0xffff", E::out_of_range, 1);
+    check("li $t0, -0x8001", E::out_of_range, 1);
+    check("addiu $t2, $zero, 0xffff", E::out_of_range, 1);
+    check("sltiu $t0, $t1, 0x8000", E::out_of_range, 1);
+    check("ori $t0, $t1, -1", E::out_of_range, 1);
+    check("andi $t0, $t1, 0x10000", E::out_of_range, 1);
+    check("lui $t0, -1", E::out_of_range, 1);
+    check("nop\n\nbeq $t0, $t1, missing", E::undefined_label, 3);
+    check("a: nop\na: nop", E::duplicate_label, 2);
+    check("a: b: c: nop", E::too_many_labels, 1);
+    check("bc 0x1002", E::unaligned_target, 1);
+    check("beq $0, $0, 0x40000", E::out_of_range, 1);
+    check("beqc $t0, $t0, 0x1000", E::invalid_register, 1);
+    check(".word", E::invalid_operand, 1);
+    check("nop\n.space 6", E::out_of_range, 2);
+    check("lui $t0, %hi(missing)", E::undefined_label, 1);
+
+    // Labels of failed assemblies aren't kept
+    Assembler::LabelTable<2> labels;
+    REQUIRE(Assembler::assemble("a: nop\nb: foo", ORIGIN, labels,
+                                [](uint32_t) {})
+                .is_error());
+    REQUIRE(labels.get_size() == 0);
+}
+
+TEST_CASE("run constexpr firmware", "[Assembler]") {
+    StaticMemory<0x2000> memory;
+    const Span<const uint32_t> words = {FIRMWARE.words.data(),
+                                        FIRMWARE.words.size()};
+    REQUIRE_FALSE(memory.write_words(ORIGIN, words).is_error());
+
+    // Nothing is decoded at runtime
+    DecodedImage image;
+    image.attach(ORIGIN, {FIRMWARE.decoded.data(), FIRMWARE.decoded.size()},
+                 FIRMWARE.key);
+    REQUIRE(image.get_key() == DecodedImage::hash(words));
+    REQUIRE(image.lookup(ORIGIN + 4) == &FIRMWARE.decoded[1]);
+
+    RegisterFile reg_file;
+    reg_file.set_pc(ORIGIN);
+    while (reg_file.get_pc() != ORIGIN + 0x1c) {
+        REQUIRE(Executor::step(reg_file, memory, image));
+    }
+
+    REQUIRE(reg_file.get(Reg::e_v0).u == 55);
+    REQUIRE(memory.read<uint32_t>(0x1020).get_value() == 55);
+}
+
+TEST_CASE("assemble into memory", "[Assembler]") {
+    // src is past 0x8000 into the page so %hi has to round up
+    constexpr std::string_view KERNEL = R"(
+        # Copies src to dst and sums it into v0
+        main:   lui   $a0, %hi(src)
+                addiu $a0, $a0, %lo(src)
+                lui   $a1, %hi(dst)
+                addiu $a1, $a1, %lo(dst)
+                addiu $a2, $zero, 6
+                addiu $v0, $zero, 0
+        copy:   lw    $t0, 0($a0)
+                sw    $t0, 0($a1)
+                addu  $v0, $v0, $t0
+                addiu $a0, $a0, 4
+                addiu $a1, $a1, 4
+                addiu $a2, $a2, -1
+                bnezc $a2, copy
+        done:   bc    done
+                .space 0x7fc8
+        src:    .word 1, 2, 3, 4
+                .word 0x10, 0x20
+        dst:    .space 24
+        end:
+    )";
+    constexpr uint32_t BASE = 0x10000;
+
+    PagedMemory<NullMMIO, false, Endian::e_big> memory;
+    REQUIRE_FALSE(memory.map(BASE, 0x10000, Permission::e_rwx).is_error());
+
+    Assembler::LabelMap labels;
+    const auto size = Assembler::assemble_into(memory, KERNEL, BASE, labels);
+    REQUIRE_FALSE(size.is_error());
+
+    uint32_t src = 0;
+    uint32_t done = 0;
+    uint32_t end = 0;
+    REQUIRE(labels.find("src", src));
+    REQUIRE(labels.find("done", done));
+    REQUIRE(labels.find("end", end));
+    REQUIRE(src == BASE + 0x8000);
+    REQUIRE(end == BASE + size.get_value());
+    REQUIRE(memory.read<uint32_t>(BASE).get_value() ==
+            Instruction(IOp::e_aui, Reg::e_a0, Reg::e_0, 2).raw);
+
+    RegisterFile reg_file;
+    reg_file.set_pc(BASE);
+    while (reg_file.get_pc() != done) {
+        REQUIRE(Executor::step(reg_file, memory));
+    }
+
+    REQUIRE(reg_file.get(Reg::e_v0).u == 58);
+    REQUIRE(memory.read<uint32_t>(end - 4).get_value() == 0x20);
+
+    SECTION("labels can be shared between assemblies") {
+        const auto more = Assembler::assemble_into(
+            memory, "jal main\nnop\nmain: nop", end, labels);
+        REQUIRE(more.get_error().error == AssemblerError::duplicate_label);
+
+        const auto call =
+            Assembler::assemble_into(memory, "jal main\nnop", end, labels);
+        REQUIRE(call.get_value() == 8);
+        REQUIRE(memory.read<uint32_t>(end).get_value() ==
+                Instruction(JOp::e_jal, BASE >> 2).raw);
+    }
+
+    SECTION("failed assemblies leave the labels as they were") {
+        const std::size_t count = labels.get_size();
+        const auto failed = Assembler::assemble_into(
+            memory, "extra: nop\nli $t0, 0x8000", end, labels);
+        REQUIRE(failed.get_error().error == AssemblerError::out_of_range);
+        REQUIRE(labels.get_size() == count);
+
+        // A corrected retry defines them
+        const auto retry = Assembler::assemble_into(
+            memory, "extra: nop\nli $t0, 0x7fff", end, labels);
+        REQUIRE(retry.get_value() == 8);
+        uint32_t extra = 0;
+        REQUIRE(labels.find("extra", extra));
+        REQUIRE(extra == end);
+    }
+
+    SECTION("unmapped memory") {
+        StaticMemory<0x1000> small;
+        Assembler::LabelMap other;
+        REQUIRE(Assembler::assemble_into(small, KERNEL, BASE, other)
+                    .get_error()
+                    .error == AssemblerError::write_failed);
+        REQUIRE(other.get_size() == 0);
+
+        REQUIRE_FALSE(
+            Assembler::assemble_into(memory, KERNEL, BASE, other).is_error());
+        uint32_t main = 0;
+        REQUIRE(other.find("main", main));
+        REQUIRE(main == BASE);
+    }
+}
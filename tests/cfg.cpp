@@ -0,0 +1,144 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <set>
+#include <string_view>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    constexpr uint32_t ORIGIN = 0x400;
+
+    void load(StaticMemory<0x1000>& memory, const std::string_view source) {
+        Assembler::LabelMap labels;
+        REQUIRE_FALSE(
+            Assembler::assemble_into(memory, source, ORIGIN, labels)
+                .is_error());
+    }
+
+    bool has_edge(const BasicBlock& block, const uint32_t target,
+                  const EdgeKind kind) {
+        for (const Edge& edge : block.successors) {
+            if (edge.target == target && edge.kind == kind) return true;
+        }
+        return false;
+    }
+} // namespace
+
+TEST_CASE("recover the control flow graph", "[ControlFlowGraph]") {
+    StaticMemory<0x1000> memory;
+    load(memory, R"(
+        main:   addiu $sp, $sp, -16
+                jal   square
+                nop
+                balc  twice
+                beqzc $v0, done
+                jalr  $t9
+                nop
+        done:   bc    done
+        unused: addiu $v0, $v0, 1
+        square: mul   $v0, $a0, $a0
+                jr    $ra
+                nop
+        twice:  li    $t0, 2
+        loop:   addu  $v0, $v0, $v0
+                addiu $t0, $t0, -1
+                bnezc $t0, loop
+                jr    $ra
+                nop
+    )");
+
+    const uint32_t entry = ORIGIN;
+    ControlFlowGraph cfg;
+    cfg.recover(memory, {&entry, 1});
+
+    const auto& blocks = cfg.get_blocks();
+    REQUIRE(blocks.size() == 9);
+    REQUIRE(cfg.get_functions() == std::set<uint32_t>{0x400, 0x424, 0x430});
+
+    // The call includes its delay slot and returns to the next block
+    const BasicBlock& main = blocks.at(0x400);
+    REQUIRE(main.end == 0x40c);
+    REQUIRE(main.get_instruction_count() == 3);
+    REQUIRE(main.flags == (BlockFlag::e_function | BlockFlag::e_call));
+    REQUIRE(has_edge(main, 0x424, EdgeKind::e_call));
+    REQUIRE(has_edge(main, 0x40c, EdgeKind::e_fall_through));
+
+    const BasicBlock& balc = blocks.at(0x40c);
+    REQUIRE(balc.end == 0x410);
+    REQUIRE(has_edge(balc, 0x430, EdgeKind::e_call));
+    REQUIRE(has_edge(balc, 0x410, EdgeKind::e_fall_through));
+
+    const BasicBlock& beqzc = blocks.at(0x410);
+    REQUIRE(beqzc.successors.size() == 2);
+    REQUIRE(has_edge(beqzc, 0x41c, EdgeKind::e_branch));
+    REQUIRE(has_edge(beqzc, 0x414, EdgeKind::e_fall_through));
+
+    // Indirect call
+    const BasicBlock& jalr = blocks.at(0x414);
+    REQUIRE(jalr.flags == (BlockFlag::e_call | BlockFlag::e_indirect));
+    REQUIRE(jalr.successors.size() == 1);
+    REQUIRE(has_edge(jalr, 0x41c, EdgeKind::e_fall_through));
+    REQUIRE(cfg.get_indirect_sites().size() == 1);
+    REQUIRE(cfg.get_indirect_sites()[0].address == 0x414);
+    REQUIRE(cfg.get_indirect_sites()[0].block == 0x414);
+    REQUIRE(cfg.get_indirect_sites()[0].is_call);
+
+    const BasicBlock& done = blocks.at(0x41c);
+    REQUIRE(done.successors.size() == 1);
+    REQUIRE(has_edge(done, 0x41c, EdgeKind::e_branch));
+
+    const BasicBlock& square = blocks.at(0x424);
+    REQUIRE(square.end == 0x430);
+    REQUIRE(square.flags == (BlockFlag::e_function | BlockFlag::e_return));
+    REQUIRE(square.successors.empty());
+
+    // The loop header splits the function
+    REQUIRE(blocks.at(0x430).end == 0x434);
+    REQUIRE(has_edge(blocks.at(0x430), 0x434, EdgeKind::e_fall_through));
+    REQUIRE(has_edge(blocks.at(0x434), 0x434, EdgeKind::e_branch));
+    REQUIRE(has_edge(blocks.at(0x434), 0x440, EdgeKind::e_fall_through));
+    REQUIRE(blocks.at(0x440).flags == BlockFlag::e_return);
+
+    REQUIRE(cfg.find_block(0x438) == &blocks.at(0x434));
+    REQUIRE(cfg.find_block(0x420) == nullptr);
+    REQUIRE(cfg.find_block(0x3fc) == nullptr);
+}
+
+TEST_CASE("recover from several entries", "[ControlFlowGraph]") {
+    StaticMemory<0x1000> memory;
+    load(memory, R"(
+        start:  beq   $zero, $zero, end
+                nop
+                .word 0xffffffff
+        end:    .word 0xffffffff
+        other:  j     start
+                nop
+    )");
+
+    // The last entry is outside of memory
+    const uint32_t entries[] = {0x400, 0x410, 0x2000};
+    ControlFlowGraph cfg;
+    cfg.recover(memory, {entries, 3});
+
+    const auto& blocks = cfg.get_blocks();
+    REQUIRE(blocks.size() == 4);
+
+    // beq $zero, $zero never falls through
+    REQUIRE(blocks.at(0x400).end == 0x408);
+    REQUIRE(blocks.at(0x400).successors.size() == 1);
+    REQUIRE(has_edge(blocks.at(0x400), 0x40c, EdgeKind::e_branch));
+
+    REQUIRE(blocks.at(0x40c).flags == BlockFlag::e_invalid);
+    REQUIRE(blocks.at(0x40c).end == 0x410);
+    REQUIRE(has_edge(blocks.at(0x410), 0x400, EdgeKind::e_branch));
+
+    REQUIRE(blocks.at(0x2000).flags ==
+            (BlockFlag::e_function | BlockFlag::e_invalid));
+    REQUIRE(blocks.at(0x2000).get_instruction_count() == 0);
+    REQUIRE(cfg.get_indirect_sites().empty());
+}
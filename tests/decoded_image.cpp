@@ -0,0 +1,209 @@
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/register_name.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    using IOp = Instruction::ITypeOpcode;
+    using Func = Instruction::Func;
+    using Reg = RegisterName;
+
+    constexpr uint32_t TEXT = 0x1000;
+
+    std::vector<uint32_t> build_text() {
+        return {
+            Instruction(IOp::e_addiu, Reg::e_t0, Reg::e_0, 3).raw,
+            // loop:
+            Instruction(IOp::e_addiu, Reg::e_t0, Reg::e_t0, 0xffff).raw,
+            Instruction(IOp::e_bne, Reg::e_0, Reg::e_t0, 0xfffe).raw,
+            Instruction(IOp::e_addiu, Reg::e_t1, Reg::e_t1, 1).raw,
+            Instruction(IOp::e_addiu, Reg::e_t2, Reg::e_0, 7).raw,
+            Instruction(Func::e_jr, Reg::e_0, Reg::e_ra, Reg::e_0).raw,
+            Instruction(Func::e_sll, Reg::e_0, Reg::e_0, Reg::e_0).raw,
+            0xffffffff,
+        };
+    }
+} // namespace
+
+TEST_CASE("decode instructions", "[DecodedImage]") {
+    const auto text = build_text();
+
+    DecodedImage image;
+    image.decode(TEXT, {text.data(), text.size()});
+
+    REQUIRE(image.get_base() == TEXT);
+    REQUIRE(image.get_size() == 8);
+    REQUIRE(image.get_key() == DecodedImage::hash({text.data(), text.size()}));
+
+    const DecodedInstruction* decoded = image.get_data();
+    REQUIRE(decoded[0].is_valid());
+    REQUIRE(decoded[0].get_type() == Instruction::Type::e_itype);
+    REQUIRE_FALSE(decoded[0].is_branch());
+
+    SECTION("branches") {
+        REQUIRE(decoded[2].is_branch());
+        REQUIRE(decoded[2].target == 0x1004);
+        REQUIRE(decoded[2].get_fall_through(0x1008) == 0x1010);
+
+        REQUIRE(decoded[5].is_branch());
+        REQUIRE(decoded[5].flags & DecodeFlag::e_indirect);
+
+        const DecodedInstruction bc = decode_instruction(
+            0x2000, Instruction(Instruction::JTypeOpcode::e_bc, 0x3fffffe).raw);
+        REQUIRE(bc.target == 0x1ffc);
+        REQUIRE(bc.get_fall_through(0x2000) == 0x2004);
+    }
+
+    SECTION("cache maintenance") {
+        using RegimmOp = Instruction::RegimmITypeOp;
+
+        const DecodedInstruction synci = decode_instruction(
+            0x2000, Instruction(RegimmOp::e_synci, Reg::e_a0, 0).raw);
+        REQUIRE(synci.is_valid());
+        REQUIRE_FALSE(synci.is_branch());
+        REQUIRE(synci.flags & DecodeFlag::e_sync);
+
+        const DecodedInstruction jr_hb = decode_instruction(
+            0x2000,
+            Instruction(Func::e_jr, Reg::e_0, Reg::e_ra, Reg::e_0,
+                        Instruction::HAZARD_BARRIER_HINT)
+                .raw);
+        REQUIRE(jr_hb.flags & DecodeFlag::e_indirect);
+        REQUIRE(jr_hb.flags & DecodeFlag::e_sync);
+        REQUIRE_FALSE(decoded[5].flags & DecodeFlag::e_sync);
+    }
+
+    SECTION("block leaders") {
+        std::vector<uint32_t> leaders;
+        for (uint32_t i = 0; i < image.get_size(); ++i) {
+            if (decoded[i].is_leader()) leaders.push_back(TEXT + i * 4);
+        }
+        REQUIRE(leaders == std::vector<uint32_t>{0x1000, 0x1004, 0x1010,
+                                                 0x101c});
+    }
+
+    SECTION("invalid encodings") {
+        REQUIRE_FALSE(decoded[7].is_valid());
+        REQUIRE(image.lookup(0x101c) == &decoded[7]);
+        REQUIRE(image.lookup(0x1020) == nullptr);
+        REQUIRE(image.lookup(0x1002) == nullptr);
+        REQUIRE(image.lookup(0xffc) == nullptr);
+    }
+}
+
+TEST_CASE("parallel decode matches serial decode", "[DecodedImage]") {
+    // Random words give plenty of branches with targets in other chunks
+    std::mt19937 rng(1234);
+    std::vector<uint32_t> text(64 * 1024);
+    for (uint32_t& word : text) word = rng();
+
+    DecodedImage serial;
+    serial.decode(0x400000, {text.data(), text.size()});
+
+    DecodedImage parallel;
+    parallel.decode(0x400000, {text.data(), text.size()}, 8);
+
+    REQUIRE(parallel.get_key() == serial.get_key());
+    REQUIRE(parallel.get_size() == serial.get_size());
+    REQUIRE(std::memcmp(parallel.get_data(), serial.get_data(),
+                        text.size() * sizeof(DecodedInstruction)) == 0);
+
+    uint32_t leaders = 0;
+    uint32_t invalid = 0;
+    for (uint32_t i = 0; i < parallel.get_size(); ++i) {
+        leaders += parallel.get_data()[i].is_leader();
+        invalid += !parallel.get_data()[i].is_valid();
+    }
+    REQUIRE(leaders > 1);
+    REQUIRE(invalid > 0);
+}
+
+TEST_CASE("step with a decoded image", "[DecodedImage]") {
+    StaticMemory<0x2000> memory;
+    const auto text = build_text();
+    REQUIRE_FALSE(memory.write_words(TEXT, {text.data(), text.size()})
+                      .is_error());
+
+    std::vector<uint32_t> read;
+    REQUIRE_FALSE(
+        DecodedImage::read_text(memory, TEXT, 8 * 4, read).is_error());
+    REQUIRE(read == text);
+
+    DecodedImage image;
+    image.decode(TEXT, {read.data(), read.size()});
+
+    RegisterFile reg_file;
+    reg_file.set_pc(TEXT);
+    reg_file.set_unsigned(Reg::e_ra, 0x1800);
+    while (reg_file.get_pc() != 0x1800) {
+        REQUIRE(Executor::step(reg_file, memory, image));
+    }
+
+    REQUIRE(reg_file.get(Reg::e_t0).u == 0);
+    REQUIRE(reg_file.get(Reg::e_t1).u == 3);
+    REQUIRE(reg_file.get(Reg::e_t2).u == 7);
+
+    reg_file.set_pc(0x101c);
+    REQUIRE_FALSE(Executor::step(reg_file, memory, image));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("save and load decoded images", "[DecodedImage]") {
+    const auto path = std::filesystem::temp_directory_path() /
+                      "mips_emulator_decoded_image_test.bin";
+    auto text = build_text();
+
+    DecodedImage decoded;
+    decoded.decode(TEXT, {text.data(), text.size()});
+    REQUIRE_FALSE(decoded.save(path.c_str()).is_error());
+
+    SECTION("warm start") {
+        DecodedImage image;
+        REQUIRE_FALSE(
+            image.load(path.c_str(), TEXT, {text.data(), text.size()})
+                .is_error());
+
+        REQUIRE(image.is_mapped());
+        REQUIRE(image.get_size() == decoded.get_size());
+        REQUIRE(std::memcmp(image.get_data(), decoded.get_data(),
+                            decoded.get_size() *
+                                sizeof(DecodedInstruction)) == 0);
+    }
+
+    SECTION("stale images are rejected") {
+        DecodedImage image;
+        REQUIRE(image.load(path.c_str(), 0x2000, {text.data(), text.size()})
+                    .get_error() == ImageError::key_mismatch);
+
+        text[4] = Instruction(IOp::e_addiu, Reg::e_t2, Reg::e_0, 8).raw;
+        REQUIRE(image.load(path.c_str(), TEXT, {text.data(), text.size()})
+                    .get_error() == ImageError::key_mismatch);
+        REQUIRE(image.get_size() == 0);
+    }
+
+    SECTION("invalid files") {
+        std::filesystem::resize_file(path, 40);
+
+        DecodedImage image;
+        REQUIRE(image.load(path.c_str(), TEXT, {text.data(), text.size()})
+                    .get_error() == ImageError::invalid_format);
+        REQUIRE(image.load("/nonexistent/image.bin", TEXT,
+                           {text.data(), text.size()})
+                    .get_error() == ImageError::open_failed);
+    }
+
+    std::filesystem::remove(path);
+}
+#endif
@@ -0,0 +1,206 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/disassembler.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/register_name.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    using IOp = Instruction::ITypeOpcode;
+    using Func = Instruction::Func;
+    using Reg = RegisterName;
+
+    constexpr uint32_t ORIGIN = 0x400000;
+
+    std::string disassemble(const uint32_t word,
+                            const uint32_t address = ORIGIN) {
+        char buffer[Disassembler::MAX_TEXT_SIZE];
+        const std::size_t length =
+            Disassembler::disassemble(address, word, {buffer, sizeof(buffer)});
+        REQUIRE(length < sizeof(buffer));
+        return std::string(buffer, length);
+    }
+
+    std::vector<uint32_t> assemble(const std::string_view source) {
+        Assembler::LabelTable<16> labels;
+        std::vector<uint32_t> words;
+        const auto emit = [&words](uint32_t word) { words.push_back(word); };
+        const auto result = Assembler::assemble(source, ORIGIN, labels, emit);
+        REQUIRE_FALSE(result.is_error());
+        return words;
+    }
+} // namespace
+
+TEST_CASE("disassemble instructions", "[Disassembler]") {
+    REQUIRE(disassemble(0) == "nop");
+    REQUIRE(disassemble(Instruction(Func::e_addu, Reg::e_t0, Reg::e_t1,
+                                    Reg::e_t2)
+                            .raw) == "addu $t0, $t1, $t2");
+    REQUIRE(disassemble(Instruction(Func::e_or, Reg::e_v0, Reg::e_a0,
+                                    Reg::e_0)
+                            .raw) == "move $v0, $a0");
+    REQUIRE(disassemble(Instruction(Func::e_jr, Reg::e_0, Reg::e_ra,
+                                    Reg::e_0)
+                            .raw) == "jr $ra");
+    REQUIRE(disassemble(Instruction(IOp::e_addiu, Reg::e_sp, Reg::e_sp,
+                                    0xfff0)
+                            .raw) == "addiu $sp, $sp, -16");
+    REQUIRE(disassemble(Instruction(IOp::e_ori, Reg::e_t0, Reg::e_t0, 0xffff)
+                            .raw) == "ori $t0, $t0, 0xffff");
+    REQUIRE(disassemble(Instruction(IOp::e_lw, Reg::e_ra, Reg::e_sp, 12)
+                            .raw) == "lw $ra, 12($sp)");
+    REQUIRE(disassemble(Instruction(IOp::e_bne, Reg::e_t0, Reg::e_0, 0xfffe)
+                            .raw) == "bne $zero, $t0, 0x003ffffc");
+    REQUIRE(disassemble(Instruction(Instruction::JTypeOpcode::e_jal,
+                                    0x100000)
+                            .raw,
+                        0x10000000) == "jal 0x10400000");
+
+    // Unknown encodings are kept as data
+    REQUIRE(disassemble(0xffffffff) == ".word 0xffffffff");
+    REQUIRE(disassemble(Instruction(Func::e_add, Reg::e_t0, Reg::e_t1,
+                                    Reg::e_t2, 3)
+                            .raw) == ".word 0x012a40e0");
+}
+
+TEST_CASE("disassembly assembles back", "[Disassembler]") {
+    // Covers every form the assembler accepts
+    const std::vector<uint32_t> words = assemble(R"(
+        start:  add $t0, $t1, $t2
+                addu $t0, $t1, $t2
+                sub $t0, $t1, $t2
+                subu $t0, $t1, $t2
+                mul $v0, $a0, $a1
+                muh $v0, $a0, $a1
+                mulu $v0, $a0, $a1
+                muhu $v0, $a0, $a1
+                div $v0, $a0, $a1
+                mod $v0, $a0, $a1
+                divu $v0, $a0, $a1
+                modu $v0, $a0, $a1
+                and $t0, $t1, $t2
+                or $t0, $t1, $t2
+                xor $t0, $t1, $t2
+                nor $t0, $t1, $t2
+                slt $t0, $t1, $t2
+                sltu $t0, $t1, $t2
+                seleqz $t0, $t1, $t2
+                selnez $t0, $t1, $t2
+                sllv $t0, $t1, $t2
+                srlv $t0, $t1, $t2
+                rotrv $t0, $t1, $t2
+                srav $t0, $t1, $t2
+                sll $t0, $t1, 31
+                srl $t0, $t1, 1
+                rotr $t0, $t1, 7
+                sra $t0, $t1, 2
+                clz $t0, $t1
+                clo $t0, $t1
+                move $t0, $t1
+                jr $ra
+                jalr $t9
+                jr.hb $ra
+                jalr.hb $t9
+                teq $t0, $t1
+                tge $t0, $t1
+                tgeu $t0, $t1
+                tlt $t0, $t1
+                tltu $t0, $t1
+                tne $t0, $t1
+                nop
+                addiu $t0, $t1, -32768
+                slti $t0, $t1, 5
+                sltiu $t0, $t1, -1
+                andi $t0, $t1, 0xff00
+                ori $t0, $t1, 1
+                xori $t0, $t1, 0x8000
+                aui $t0, $t1, 0xffff
+                lui $t0, 0x1234
+                li $t0, -1
+                lb $t0, -1($sp)
+                lbu $t0, 1($sp)
+                lh $t0, 2($sp)
+                lhu $t0, 4($sp)
+                lw $t0, 32767($sp)
+                sb $t0, 0($a0)
+                sh $t0, -2($a0)
+                sw $t0, 8($gp)
+                beq $t0, $t1, start
+                bne $t0, $t1, end
+                blez $t0, start
+                bgtz $t0, end
+                bgez $t0, start
+                bltz $t0, end
+                j start
+                jal end
+                blezalc $t0, start
+                bgezalc $t0, start
+                bgeuc $t0, $t1, end
+                bgtzalc $t0, start
+                bltzalc $t0, start
+                bltuc $t1, $t0, end
+                beqzalc $t0, start
+                beqc $t0, $t1, end
+                bovc $t1, $t0, start
+                bnezalc $t0, start
+                bnec $t0, $t1, end
+                bnvc $t0, $t0, start
+                blezc $t0, start
+                bgezc $t0, start
+                bgec $t0, $t1, end
+                bgtzc $t0, start
+                bltzc $t0, start
+                bltc $t0, $t1, end
+                beqzc $t0, start
+                bnezc $t0, end
+                jic $t0, -4
+                jialc $t0, 16
+                bc start
+                balc end
+                addiupc $t0, -4
+                lwpc $t0, 262143
+                auipc $t0, 0x10
+                aluipc $t0, 0xffff
+                bitswap $t0, $t1
+                wsbh $t0, $t1
+                seb $t0, $t1
+                seh $t0, $t1
+                align $t0, $t1, $t2, 3
+                ext $t0, $t1, 4, 28
+                ins $t0, $t1, 31, 1
+                synci -4($a0)
+                cache 20, 255($a1)
+        end:    nop
+    )");
+
+    // Every mnemonic but the two directives, nop is used twice
+    REQUIRE(words.size() == std::size(Assembler::MNEMONICS) - 1);
+
+    std::string listing;
+    for (uint32_t i = 0; i < words.size(); ++i) {
+        std::string text = disassemble(words[i], ORIGIN + i * 4);
+        REQUIRE(text.find(".word") == std::string::npos);
+        listing += text + "\n";
+    }
+    REQUIRE(assemble(listing) == words);
+}
+
+TEST_CASE("disassemble into small buffers", "[Disassembler]") {
+    const uint32_t word =
+        Instruction(Func::e_addu, Reg::e_t0, Reg::e_t1, Reg::e_t2).raw;
+
+    char buffer[8];
+    REQUIRE(Disassembler::disassemble(0, word, {buffer, sizeof(buffer)}) ==
+            7);
+    REQUIRE(std::string(buffer) == "addu $t");
+
+    REQUIRE(Disassembler::disassemble(0, word, {buffer, 1}) == 0);
+    REQUIRE(buffer[0] == '\0');
+    REQUIRE(Disassembler::disassemble(0, word, {nullptr, 0}) == 0);
+}
@@ -0,0 +1,271 @@
+#include "mips-emulator/elf_loader.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/register_name.hpp"
+#include "mips-emulator/runtime_static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    using IOp = Instruction::ITypeOpcode;
+
+    struct TestSegment {
+        uint32_t offset;
+        uint32_t address;
+        uint32_t file_size;
+        uint32_t memory_size;
+        uint32_t flags;
+    };
+
+    template <Endian endian, typename T>
+    void put(std::vector<uint8_t>& file, const std::size_t offset,
+             const T value) {
+        const T converted = from_host<endian>(value);
+        std::memcpy(file.data() + offset, &converted, sizeof(T));
+    }
+
+    // Builds an ELF32 MIPS executable with the given PT_LOAD segments.
+    // Bytes not covered by the headers are filled with 0xee.
+    template <Endian endian>
+    std::vector<uint8_t> build_elf(const uint32_t entry,
+                                   const std::vector<TestSegment>& segments,
+                                   const std::size_t size) {
+        std::vector<uint8_t> file(size, 0xee);
+        std::memset(file.data(), 0, 52 + 32 * segments.size());
+
+        const uint8_t ident[] = {0x7f, 'E', 'L', 'F', 1,
+                                 endian == Endian::e_little ? 1 : 2, 1};
+        std::memcpy(file.data(), ident, sizeof(ident));
+
+        put<endian, uint16_t>(file, 16, ElfLoader::ET_EXEC);
+        put<endian, uint16_t>(file, 18, ElfLoader::EM_MIPS);
+        put<endian, uint32_t>(file, 20, 1);
+        put<endian, uint32_t>(file, 24, entry);
+        put<endian, uint32_t>(file, 28, 52);
+        put<endian, uint16_t>(file, 40, 52);
+        put<endian, uint16_t>(file, 42, 32);
+        put<endian, uint16_t>(file, 44, static_cast<uint16_t>(segments.size()));
+
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            const std::size_t header = 52 + i * 32;
+            const TestSegment& segment = segments[i];
+            put<endian, uint32_t>(file, header, ElfLoader::PT_LOAD);
+            put<endian, uint32_t>(file, header + 4, segment.offset);
+            put<endian, uint32_t>(file, header + 8, segment.address);
+            put<endian, uint32_t>(file, header + 12, segment.address);
+            put<endian, uint32_t>(file, header + 16, segment.file_size);
+            put<endian, uint32_t>(file, header + 20, segment.memory_size);
+            put<endian, uint32_t>(file, header + 24, segment.flags);
+            put<endian, uint32_t>(file, header + 28, 0x1000);
+        }
+
+        return file;
+    }
+
+    constexpr uint32_t RX = ElfLoader::PF_R | ElfLoader::PF_X;
+    constexpr uint32_t RW = ElfLoader::PF_R | ElfLoader::PF_W;
+
+    // .text and .data share a page, .bss continues past it, a read only
+    // segment isn't page congruent and a page aligned data segment has a
+    // partial last page
+    const std::vector<TestSegment> SEGMENTS = {
+        {0x1000, 0x400000, 0x10, 0x10, RX},
+        {0x1010, 0x400010, 0x8, 0x2000, RW},
+        {0x1100, 0x500000, 0x8, 0x8, ElfLoader::PF_R},
+        {0x2000, 0x600000, 0x1010, 0x1100, RW},
+    };
+
+    template <Endian endian>
+    std::vector<uint8_t> build_program() {
+        std::vector<uint8_t> file =
+            build_elf<endian>(0x400000, SEGMENTS, 0x3100);
+
+        // addiu t0, zero, 5; lw t1, 0x10(t2)
+        put<endian, uint32_t>(
+            file, 0x1000,
+            Instruction(IOp::e_addiu, RegisterName::e_t0, RegisterName::e_0, 5)
+                .raw);
+        put<endian, uint32_t>(
+            file, 0x1004,
+            Instruction(IOp::e_lw, RegisterName::e_t1, RegisterName::e_t2, 0x10)
+                .raw);
+        put<endian, uint32_t>(file, 0x1010, 0xcafef00d);
+        put<endian, uint32_t>(file, 0x1100, 0x12345678);
+        put<endian, uint32_t>(file, 0x2000, 0xdeadbeef);
+        return file;
+    }
+
+    std::filesystem::path write_temp(const char* name,
+                                     const std::vector<uint8_t>& contents) {
+        const auto path = std::filesystem::temp_directory_path() / name;
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(contents.data()),
+                   static_cast<std::streamsize>(contents.size()));
+        return path;
+    }
+
+    template <typename Memory>
+    void check_program(Memory& memory, RegisterFile& reg_file) {
+        REQUIRE(reg_file.get_pc() == 0x400000);
+
+        REQUIRE(memory.template read<uint32_t>(0x400010).get_value() ==
+                0xcafef00d);
+        REQUIRE(memory.template read<uint32_t>(0x400018).get_value() == 0);
+        REQUIRE(memory.template read<uint32_t>(0x400ffc).get_value() == 0);
+        REQUIRE(memory.template read<uint32_t>(0x402008).get_value() == 0);
+        REQUIRE(memory.template read<uint32_t>(0x500000).get_value() ==
+                0x12345678);
+        REQUIRE(memory.template read<uint32_t>(0x600000).get_value() ==
+                0xdeadbeef);
+        REQUIRE(memory.template read<uint32_t>(0x601000).get_value() ==
+                0xeeeeeeee);
+        REQUIRE(memory.template read<uint32_t>(0x601010).get_value() == 0);
+        REQUIRE(memory.template read<uint32_t>(0x6010fc).get_value() == 0);
+
+        reg_file.set_unsigned(RegisterName::e_t2, 0x400000);
+        REQUIRE(Executor::step(reg_file, memory));
+        REQUIRE(Executor::step(reg_file, memory));
+        REQUIRE(reg_file.get(RegisterName::e_t0).u == 5);
+        REQUIRE(reg_file.get(RegisterName::e_t1).u == 0xcafef00d);
+    }
+
+    template <typename Memory>
+    void check_permissions(Memory& memory) {
+        REQUIRE(memory.get_permissions(0x400000) == Permission::e_rwx);
+        REQUIRE(memory.get_permissions(0x401000) == Permission::e_rw);
+        REQUIRE(memory.get_permissions(0x402000) == Permission::e_rw);
+        REQUIRE_FALSE(memory.is_mapped(0x403000, 1));
+        REQUIRE(memory.get_permissions(0x500000) == Permission::e_read);
+        REQUIRE(memory.get_permissions(0x601000) == Permission::e_rw);
+
+        REQUIRE(memory.template store<uint32_t>(0x500000, 0).get_error() ==
+                MemoryError::permission_denied);
+    }
+} // namespace
+
+TEST_CASE("parse elf headers", "[ElfLoader]") {
+    const auto file = build_program<Endian::e_little>();
+
+    SECTION("segments") {
+        ElfImage image;
+        REQUIRE_FALSE(ElfLoader::parse({file.data(), file.size()}, image)
+                          .is_error());
+
+        REQUIRE(image.endian == Endian::e_little);
+        REQUIRE(image.entry == 0x400000);
+        REQUIRE(image.segments.size() == 4);
+        REQUIRE(image.segments[1].address == 0x400010);
+        REQUIRE(image.segments[1].memory_size == 0x2000);
+        REQUIRE(image.segments[1].perms == Permission::e_rw);
+        REQUIRE(image.segments[2].perms == Permission::e_read);
+    }
+
+    SECTION("invalid files") {
+        ElfImage image;
+
+        auto bad_magic = file;
+        bad_magic[1] = 'X';
+        REQUIRE(ElfLoader::parse({bad_magic.data(), bad_magic.size()}, image)
+                    .get_error() == ElfError::invalid_header);
+
+        auto elf64 = file;
+        elf64[4] = 2;
+        REQUIRE(ElfLoader::parse({elf64.data(), elf64.size()}, image)
+                    .get_error() == ElfError::unsupported_format);
+
+        REQUIRE(ElfLoader::parse({file.data(), 0x2000}, image).get_error() ==
+                ElfError::invalid_segment);
+
+        const auto overlapping = build_elf<Endian::e_little>(
+            0, {{0x1000, 0x1000, 0x10, 0x100, RX}, {0x1000, 0x1080, 0, 4, RW}},
+            0x2000);
+        REQUIRE(ElfLoader::parse({overlapping.data(), overlapping.size()},
+                                 image)
+                    .get_error() == ElfError::invalid_segment);
+    }
+}
+
+TEST_CASE("load elf into flat memory", "[ElfLoader]") {
+    auto memory =
+        std::make_unique<RuntimeStaticMemory<NullMMIO, Endian::e_big>>(
+            0x700000);
+    RegisterFile reg_file;
+
+    const auto file = build_program<Endian::e_big>();
+    REQUIRE(ElfLoader::load(*memory, reg_file, {file.data(), file.size()})
+                .get_value() == 0x400000);
+    check_program(*memory, reg_file);
+
+    RuntimeStaticMemory<> little(0x700000);
+    REQUIRE(ElfLoader::load(little, reg_file, {file.data(), file.size()})
+                .get_error() == ElfError::endianness_mismatch);
+}
+
+TEST_CASE("load elf into paged memory", "[ElfLoader]") {
+    RegisterFile reg_file;
+
+    SECTION("copied") {
+        PagedMemory<> memory;
+        const auto file = build_program<Endian::e_little>();
+        REQUIRE_FALSE(
+            ElfLoader::load(memory, reg_file, {file.data(), file.size()})
+                .is_error());
+
+        check_permissions(memory);
+        check_program(memory, reg_file);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    SECTION("mapped") {
+        const auto path = write_temp("mips_emulator_elf_loader_test.elf",
+                                     build_program<Endian::e_big>());
+
+        {
+            PagedMemory<NullMMIO, false, Endian::e_big> memory;
+            REQUIRE_FALSE(
+                ElfLoader::load(memory, reg_file, path.c_str()).is_error());
+
+            check_permissions(memory);
+            check_program(memory, reg_file);
+
+            // File backed pages are used in place
+            auto host = memory.ptr_from_address(0x600000);
+            REQUIRE_FALSE(host.is_error());
+            REQUIRE(std::memcmp(host.get_value(), "\xde\xad\xbe\xef", 4) == 0);
+
+            REQUIRE_FALSE(memory.store<uint32_t>(0x600000, 1).is_error());
+            REQUIRE(memory.read<uint32_t>(0x600000).get_value() == 1);
+
+            PagedMemory<> little;
+            REQUIRE(ElfLoader::load(little, reg_file, path.c_str())
+                        .get_error() == ElfError::endianness_mismatch);
+        }
+
+        // Neither stores nor .bss zeroing reach the file
+        std::ifstream stream(path, std::ios::binary);
+        const std::vector<uint8_t> contents(
+            (std::istreambuf_iterator<char>(stream)),
+            std::istreambuf_iterator<char>());
+        REQUIRE(contents == build_program<Endian::e_big>());
+
+        std::filesystem::remove(path);
+    }
+#endif
+
+    SECTION("missing file") {
+        PagedMemory<> memory;
+        REQUIRE(ElfLoader::load(memory, reg_file, "/nonexistent/program.elf")
+                    .get_error() == ElfError::open_failed);
+    }
+}
@@ -74,4 +74,20 @@ TEST_CASE("bgez", "[Executor]") {
         test({10, INT32_MAX, true});
         test({10, 12000, true});
     }
-}
\ No newline at end of file
+}
+
+// Synchronize Caches to Make Instruction Writes Effective
+TEST_CASE("synci", "[Executor]") {
+    RegisterFile reg_file;
+    reg_file.set_unsigned(RegisterName::e_t0, 0x1000);
+    const Instruction instr(IOp::e_synci, RegisterName::e_t0, 0xfffc);
+
+    reg_file.inc_pc(); // Emulate step
+    REQUIRE(Executor::handle_regimm_itype_instr(instr, reg_file));
+
+    // Neither branches nor writes registers
+    REQUIRE(reg_file.get_pc() == 4);
+    reg_file.update_pc();
+    REQUIRE(reg_file.get_pc() == 8);
+    REQUIRE(reg_file.get(RegisterName::e_t0).u == 0x1000);
+}
@@ -0,0 +1,118 @@
+#include "mips-emulator/guest_ptr.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+using namespace mips_emulator;
+
+namespace {
+    // Guest side struct iovec
+    struct Iovec {
+        uint32_t base;
+        uint32_t len;
+    };
+
+    enum class Kind : uint16_t {
+        e_leaf = 1,
+        e_node = 0x0102,
+    };
+
+    struct Node {
+        uint32_t next;
+        Kind kind;
+        int16_t value;
+        Iovec buffer;
+    };
+} // namespace
+
+TEST_CASE("guest pointer member access", "[GuestPtr]") {
+    StaticMemory<256, NullMMIO, Endian::e_big> memory;
+    REQUIRE_FALSE(memory.fill(0, 256, 0).is_error());
+
+    REQUIRE_FALSE(memory.store<uint32_t>(0x40, 0x80).is_error());
+    REQUIRE_FALSE(memory.store<uint16_t>(0x44, 0x0102).is_error());
+    REQUIRE_FALSE(memory.store<int16_t>(0x46, -5).is_error());
+    REQUIRE_FALSE(memory.store<uint32_t>(0x48, 0x1000).is_error());
+    REQUIRE_FALSE(memory.store<uint32_t>(0x4c, 0x20).is_error());
+
+    const auto node_result = guest_ptr<Node>(memory, 0x40);
+    REQUIRE_FALSE(node_result.is_error());
+    const auto node = node_result.get_value();
+
+    SECTION("get") {
+        REQUIRE(node.get_address() == 0x40);
+        REQUIRE(node.get(&Node::next) == 0x80);
+        REQUIRE(node.get(&Node::kind) == Kind::e_node);
+        REQUIRE(node.get(&Node::value) == -5);
+
+        const auto buffer = node.field(&Node::buffer);
+        REQUIRE(buffer.get_address() == 0x48);
+        REQUIRE(buffer.get(&Iovec::base) == 0x1000);
+        REQUIRE(buffer.get(&Iovec::len) == 0x20);
+    }
+
+    SECTION("set") {
+        node.set(&Node::value, static_cast<int16_t>(300));
+        node.field(&Node::buffer).set(&Iovec::len, 0x12345678u);
+
+        REQUIRE(memory.read<int16_t>(0x46).get_value() == 300);
+        REQUIRE(memory.read<uint32_t>(0x4c).get_value() == 0x12345678);
+        REQUIRE(memory.read<uint8_t>(0x4c).get_value() == 0x12);
+    }
+
+    SECTION("out of bounds") {
+        REQUIRE(guest_ptr<Node>(memory, 0xf8).is_error());
+        REQUIRE(guest_ptr<uint32_t>(memory, 0x100).is_error());
+    }
+}
+
+TEST_CASE("guest span", "[GuestPtr]") {
+    PagedMemory<> memory;
+    REQUIRE_FALSE(memory.map(0x1000, 0x2000, Permission::e_rw).is_error());
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        REQUIRE_FALSE(
+            memory.store<uint32_t>(0x1100 + i * 8, 0x2000 + i).is_error());
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1104 + i * 8, i).is_error());
+    }
+
+    SECTION("walk iovecs") {
+        const auto iovecs_result = guest_span<Iovec>(memory, 0x1100, 4);
+        REQUIRE_FALSE(iovecs_result.is_error());
+        const auto iovecs = iovecs_result.get_value();
+
+        REQUIRE(iovecs.get_size() == 4);
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < iovecs.get_size(); ++i) {
+            REQUIRE(iovecs[i].get(&Iovec::base) == 0x2000 + i);
+            total += iovecs[i].get(&Iovec::len);
+        }
+        REQUIRE(total == 6);
+
+        iovecs[3].store({0xaaaa, 0xbbbb});
+        REQUIRE(memory.read<uint32_t>(0x1118).get_value() == 0xaaaa);
+        REQUIRE(iovecs[3].load().len == 0xbbbb);
+    }
+
+    SECTION("ranges crossing separately backed pages are rejected") {
+        REQUIRE_FALSE(guest_ptr<uint32_t>(memory, 0x1ffc).is_error());
+        REQUIRE(guest_ptr<Iovec>(memory, 0x1ffc).get_error() ==
+                MemoryError::discontiguous_range);
+        REQUIRE(guest_span<uint32_t>(memory, 0x1ff0, 8).get_error() ==
+                MemoryError::discontiguous_range);
+        REQUIRE(guest_span<uint32_t>(memory, 0x2ff0, 8).get_error() ==
+                MemoryError::out_of_bounds_access);
+
+        // They can still be copied
+        REQUIRE_FALSE(memory.store<uint32_t>(0x2000, 0x1234).is_error());
+        uint8_t bytes[sizeof(Iovec)];
+        REQUIRE_FALSE(memory.read_block(0x1ffc, {bytes, sizeof(bytes)})
+                          .is_error());
+        Iovec iovec;
+        std::memcpy(&iovec, bytes, sizeof(iovec));
+        REQUIRE(iovec.len == 0x1234);
+    }
+}
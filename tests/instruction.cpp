@@ -3,6 +3,8 @@
 
 #include <catch2/catch.hpp>
 
+#include <random>
+
 using namespace mips_emulator;
 
 using Type = Instruction::Type;
@@ -282,6 +284,12 @@ TEST_CASE("Special3 Type", "[Instruction]") {
         REQUIRE(t.raw == 0x7c094620);
     }
 
+    SECTION("get_type cache") {
+        // CACHE 4, 4($a1)
+        const Instruction inst(0x7ca40225);
+        REQUIRE(instr_type_matches(inst, Type::e_special3_type_cache));
+    }
+
     SECTION("get_type align") {
         Instruction t(Func::e_bshfl, BSHFLFunc::e_align_1, RegisterName::e_t0,
                       RegisterName::e_t2, RegisterName::e_t1);
@@ -300,7 +308,7 @@ TEST_CASE("Regimm I Type", "[Instruction]") {
     using IOp = Instruction::RegimmITypeOp;
 
     SECTION("get_type") {
-        IOp instr[] = {IOp::e_bgez, IOp::e_bltz};
+        IOp instr[] = {IOp::e_bgez, IOp::e_bltz, IOp::e_synci};
 
         for (auto const v : instr) {
             const auto inst = Instruction(v, RegisterName::e_t0, 3);
@@ -365,4 +373,33 @@ TEST_CASE("PCrel Type 2", "[Instruction]") {
         Instruction t(RegisterName::e_t0, Func::e_aluipc, 0x0123);
         REQUIRE(t.raw == 0xed1f0123); // Actually 0xed180123
     }
-}
\ No newline at end of file
+}
+TEST_CASE("field accessors", "[Instruction]") {
+    static_assert(Instruction(0x8fbf0014).get_opcode() == 35);
+    static_assert(Instruction(0x8fbf0014).get_rs() == 29);
+    static_assert(Instruction(0x8fbf0014).get_rt() == 31);
+    static_assert(Instruction(0x8fbf0014).get_imm() == 0x14);
+
+    // The accessors read the same bits as the bit field structs
+    std::mt19937 rng(7);
+    for (int i = 0; i < 4096; ++i) {
+        const Instruction instr(static_cast<uint32_t>(rng()));
+
+        REQUIRE(instr.get_opcode() == instr.general.op);
+        REQUIRE(instr.get_rs() == instr.rtype.rs);
+        REQUIRE(instr.get_rt() == instr.rtype.rt);
+        REQUIRE(instr.get_rd() == instr.rtype.rd);
+        REQUIRE(instr.get_shamt() == instr.rtype.shamt);
+        REQUIRE(instr.get_func() == instr.rtype.func);
+        REQUIRE(instr.get_imm() == instr.itype.imm);
+        REQUIRE(instr.get_long_imm() == instr.longimm_itype.imm);
+        REQUIRE(instr.get_address() == instr.jtype.address);
+        REQUIRE(instr.get_regimm_op() == instr.regimm_itype.op);
+        REQUIRE(instr.get_bshfl_func() == instr.special3_type_bshfl.func);
+        REQUIRE(instr.get_lsb() == instr.special3_type_ext.lsb);
+        REQUIRE(instr.get_msb() == instr.special3_type_ins.msb);
+        REQUIRE(instr.get_pcrel_imm() == instr.pcrel_type1.imm);
+        REQUIRE(instr.get_pcrel_func1() == instr.pcrel_type1.func);
+        REQUIRE(instr.get_pcrel_func2() == instr.pcrel_type2.func);
+    }
+}
@@ -0,0 +1,114 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/decoded_image.hpp"
+#include "mips-emulator/disassembler.hpp"
+#include "mips-emulator/instruction_info.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string_view>
+
+using namespace mips_emulator;
+
+namespace {
+    using Func = Instruction::Func;
+    using IOp = Instruction::ITypeOpcode;
+
+    // The table is usable in constant expressions
+    static_assert(decode_op(0) == Op::e_sll);
+    static_assert(decode_op(Assembler::rtype(Func::e_sop30, 2, 4, 5, 3)) ==
+                  Op::e_muh);
+    static_assert(decode_op(Assembler::rtype(Func::e_srl, 2, 1, 5, 3)) ==
+                  Op::e_rotr);
+    static_assert(decode_op(Assembler::itype(IOp::e_pop10, 5, 0, 1)) ==
+                  Op::e_beqzalc);
+    static_assert(decode_op(Assembler::itype(IOp::e_pop10, 4, 5, 1)) ==
+                  Op::e_bovc);
+    static_assert(get_op_info(Op::e_lhu).access_size == 2);
+    static_assert(get_op_info(Op::e_bgezalc).flags & OpFlag::e_link);
+    static_assert(!get_op_info(Op::e_beq).is_compact());
+    static_assert(get_op_info(0xffffffff).can_trap());
+
+    // Mnemonics the assembler uses for aliases
+    std::string_view base_name(const std::string_view name) {
+        if (name == "nop") return "sll";
+        if (name == "move") return "or";
+        if (name == "lui") return "aui";
+        if (name == "li") return "addiu";
+        if (name == "jr.hb") return "jr";
+        if (name == "jalr.hb") return "jalr";
+        return name;
+    }
+} // namespace
+
+TEST_CASE("instruction metadata table", "[InstructionInfo]") {
+    for (std::size_t i = 0; i < OP_COUNT; ++i) {
+        REQUIRE_FALSE(OP_INFO[i].name.empty());
+        if (OP_INFO[i].accesses_memory()) {
+            REQUIRE(OP_INFO[i].access_size != 0);
+        }
+        if (OP_INFO[i].is_branch()) {
+            REQUIRE(OP_INFO[i].has_delay_slot() != OP_INFO[i].is_compact());
+        }
+    }
+}
+
+TEST_CASE("metadata agrees with the decoders", "[InstructionInfo]") {
+    std::mt19937 rng(42);
+    uint32_t valid = 0;
+
+    for (uint32_t i = 0; i < 1 << 16; ++i) {
+        const uint32_t word = rng();
+        const Op op = decode_op(word);
+        const OpInfo& info = get_op_info(op);
+
+        const Assembler::Mnemonic* mnemonic =
+            Disassembler::find_mnemonic(word);
+        if (mnemonic != nullptr) {
+            REQUIRE(info.name == base_name(mnemonic->name));
+        }
+
+        if (op == Op::e_invalid) continue;
+        ++valid;
+
+        const DecodedInstruction decoded = decode_instruction(0x1000, word);
+        REQUIRE(decoded.is_valid());
+        REQUIRE(decoded.is_branch() == info.is_branch());
+        REQUIRE(static_cast<bool>(decoded.flags & DecodeFlag::e_compact) ==
+                info.is_compact());
+        REQUIRE(static_cast<bool>(decoded.flags & DecodeFlag::e_indirect) ==
+                static_cast<bool>(info.flags & OpFlag::e_indirect));
+        REQUIRE(static_cast<bool>(decoded.flags & DecodeFlag::e_access) ==
+                (info.accesses_memory() &&
+                 !(info.flags & OpFlag::e_pc_relative)));
+    }
+
+    REQUIRE(valid > 100);
+}
+
+TEST_CASE("register use", "[InstructionInfo]") {
+    const auto use = [](const std::string_view source) {
+        Assembler::LabelTable<1> labels;
+        uint32_t word = 0;
+        REQUIRE_FALSE(Assembler::assemble(source, 0, labels,
+                                          [&](uint32_t w) { word = w; })
+                          .is_error());
+        return get_register_use(word);
+    };
+
+    const RegisterUse addu = use("addu $t0, $t1, $t2");
+    REQUIRE(addu.reads == ((1u << 9) | (1u << 10)));
+    REQUIRE(addu.writes == 1u << 8);
+
+    const RegisterUse sw = use("sw $ra, 4($sp)");
+    REQUIRE(sw.reads == ((1u << 31) | (1u << 29)));
+    REQUIRE(sw.writes == 0);
+
+    const RegisterUse balc = use("balc 0x100");
+    REQUIRE(balc.reads == 0);
+    REQUIRE(balc.writes == 1u << 31);
+
+    REQUIRE(use("ext $t0, $t1, 0, 8").writes == 1u << 8);
+    REQUIRE(use("addiu $zero, $t1, 1").writes == 0);
+    REQUIRE(use("auipc $v0, 1").writes == 1u << 2);
+}
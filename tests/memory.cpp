@@ -0,0 +1,251 @@
+#include "mips-emulator/endian.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/register_name.hpp"
+#include "mips-emulator/runtime_static_memory.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <vector>
+
+using namespace mips_emulator;
+
+using IOp = Instruction::ITypeOpcode;
+
+// Byte wide device registers at [BASE, BASE + SIZE)
+struct DeviceRegisters {
+    static constexpr uint32_t BASE = 0x80;
+    static constexpr uint32_t SIZE = 0x10;
+
+    uint8_t regs[SIZE] = {};
+    uint32_t accesses = 0;
+
+    template <typename T>
+    std::optional<T> read(const uint32_t address) {
+        if (address < BASE || address >= BASE + SIZE) return std::nullopt;
+        ++accesses;
+        return regs[address - BASE];
+    }
+
+    template <typename T>
+    bool store(const uint32_t address, const T value) {
+        if (address < BASE || address >= BASE + SIZE) return false;
+        ++accesses;
+        regs[address - BASE] = static_cast<uint8_t>(value);
+        return true;
+    }
+};
+
+struct RangedDeviceRegisters : DeviceRegisters {
+    bool overlaps(const uint32_t address, const uint32_t size) {
+        return address < BASE + SIZE && address + size > BASE;
+    }
+};
+
+TEST_CASE("byte swap", "[Memory]") {
+    REQUIRE(byte_swap<uint8_t>(0x12) == 0x12);
+    REQUIRE(byte_swap<uint16_t>(0x1234) == 0x3412);
+    REQUIRE(byte_swap<uint32_t>(0x12345678) == 0x78563412);
+    REQUIRE(byte_swap<int16_t>(-2) == static_cast<int16_t>(0xfeff));
+
+    // Odd counts exercise both the vector and the scalar tail
+    std::vector<uint32_t> words;
+    for (uint32_t i = 0; i < 11; ++i) words.push_back(0x01020304 * (i + 1));
+
+    std::vector<uint8_t> bytes(words.size() * 4 + 1);
+    copy_words_from_host<Endian::e_big>(&bytes[1], words.data(),
+                                        words.size());
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        REQUIRE(bytes[1 + i * 4 + 0] == ((words[i] >> 24) & 0xff));
+        REQUIRE(bytes[1 + i * 4 + 1] == ((words[i] >> 16) & 0xff));
+        REQUIRE(bytes[1 + i * 4 + 2] == ((words[i] >> 8) & 0xff));
+        REQUIRE(bytes[1 + i * 4 + 3] == (words[i] & 0xff));
+    }
+}
+
+TEST_CASE("little endian memory", "[Memory]") {
+    StaticMemory<256> memory;
+
+    REQUIRE_FALSE(memory.store<uint32_t>(0, 0x11223344).is_error());
+    REQUIRE(memory.read<uint8_t>(0).get_value() == 0x44);
+    REQUIRE(memory.read<uint16_t>(2).get_value() == 0x1122);
+    REQUIRE(memory.get_memory()[0] == 0x44);
+}
+
+TEST_CASE("big endian memory", "[Memory]") {
+    StaticMemory<256, NullMMIO, Endian::e_big> memory;
+
+    SECTION("store word") {
+        REQUIRE_FALSE(memory.store<uint32_t>(0, 0x11223344).is_error());
+        REQUIRE(memory.read<uint32_t>(0).get_value() == 0x11223344);
+        REQUIRE(memory.read<uint8_t>(0).get_value() == 0x11);
+        REQUIRE(memory.read<uint16_t>(2).get_value() == 0x3344);
+        REQUIRE(memory.get_memory()[0] == 0x11);
+        REQUIRE(memory.get_memory()[3] == 0x44);
+    }
+
+    SECTION("signed loads") {
+        REQUIRE_FALSE(memory.store<int16_t>(4, -2).is_error());
+        REQUIRE(memory.read<int16_t>(4).get_value() == -2);
+        REQUIRE(memory.read<uint8_t>(5).get_value() == 0xfe);
+    }
+
+    SECTION("step big endian program") {
+        RegisterFile reg_file;
+        reg_file.set_unsigned(RegisterName::e_t0, 0x40);
+
+        const uint32_t program[] = {
+            Instruction(IOp::e_addiu, RegisterName::e_t1, RegisterName::e_0,
+                        0x1234)
+                .raw,
+            Instruction(IOp::e_sh, RegisterName::e_t1, RegisterName::e_t0, 0)
+                .raw,
+            Instruction(IOp::e_lbu, RegisterName::e_t2, RegisterName::e_t0, 0)
+                .raw,
+        };
+        REQUIRE_FALSE(memory.write_words(0, {program, 3}).is_error());
+        REQUIRE(memory.fetch(0).get_value() == program[0]);
+
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(Executor::step(reg_file, memory));
+        }
+
+        REQUIRE(reg_file.get(RegisterName::e_t2).u == 0x12);
+    }
+}
+
+TEST_CASE("write words", "[Memory]") {
+    RuntimeStaticMemory<> memory(64, 0x100);
+    const uint32_t words[] = {1, 2, 3, 4};
+
+    SECTION("in bounds") {
+        REQUIRE_FALSE(memory.write_words(0x110, {words, 4}).is_error());
+        for (uint32_t i = 0; i < 4; ++i) {
+            REQUIRE(memory.read<uint32_t>(0x110 + i * 4).get_value() ==
+                    words[i]);
+        }
+    }
+
+    SECTION("out of bounds") {
+        REQUIRE(memory.write_words(0xf0, {words, 4}).is_error());
+        REQUIRE(memory.write_words(0x131, {words, 4}).is_error());
+    }
+}
+
+TEST_CASE("bulk transfers", "[Memory]") {
+    RuntimeStaticMemory<> memory(256, 0x100);
+
+    std::vector<uint8_t> data(100);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = i * 3;
+
+    SECTION("write and read block") {
+        REQUIRE_FALSE(
+            memory.write_block(0x110, {data.data(), data.size()}).is_error());
+        REQUIRE(memory.read<uint8_t>(0x111).get_value() == 3);
+
+        std::vector<uint8_t> out(data.size());
+        REQUIRE_FALSE(
+            memory.read_block(0x110, {out.data(), out.size()}).is_error());
+        REQUIRE(out == data);
+    }
+
+    SECTION("fill") {
+        REQUIRE_FALSE(memory.fill(0x120, 16, 0xab).is_error());
+        REQUIRE(memory.read<uint32_t>(0x120).get_value() == 0xabababab);
+        REQUIRE(memory.read<uint32_t>(0x12c).get_value() == 0xabababab);
+        REQUIRE(memory.read<uint8_t>(0x130).get_value() == 0);
+    }
+
+    SECTION("out of bounds is rejected without writing") {
+        REQUIRE(memory.write_block(0x1d0, {data.data(), data.size()})
+                    .is_error());
+        REQUIRE(memory.read<uint8_t>(0x1d0).get_value() == 0);
+
+        REQUIRE(memory.fill(0xff, 2, 1).is_error());
+        REQUIRE(memory.fill(0x1ff, 2, 1).is_error());
+        REQUIRE_FALSE(memory.fill(0x100, 256, 1).is_error());
+    }
+}
+
+TEST_CASE("bulk transfers with MMIO", "[Memory]") {
+    std::vector<uint8_t> data(0x20, 0x5a);
+
+    SECTION("ranges away from devices skip the handler") {
+        auto device = std::make_shared<RangedDeviceRegisters>();
+        StaticMemory<256, RangedDeviceRegisters> memory(0, device);
+
+        REQUIRE_FALSE(
+            memory.write_block(0x10, {data.data(), data.size()}).is_error());
+        REQUIRE(device->accesses == 0);
+
+        REQUIRE_FALSE(
+            memory.write_block(0x78, {data.data(), data.size()}).is_error());
+        REQUIRE(device->accesses == DeviceRegisters::SIZE);
+        REQUIRE(device->regs[0] == 0x5a);
+        REQUIRE(memory.read_no_mmio<uint8_t>(0x78).get_value() == 0x5a);
+    }
+
+    SECTION("handlers without a range always use the handler") {
+        auto device = std::make_shared<DeviceRegisters>();
+        StaticMemory<256, DeviceRegisters> memory(0, device);
+
+        REQUIRE_FALSE(memory.fill(0x84, 4, 0x11).is_error());
+        REQUIRE(device->regs[4] == 0x11);
+
+        std::vector<uint8_t> out(8);
+        REQUIRE_FALSE(
+            memory.read_block(0x80, {out.data(), out.size()}).is_error());
+        REQUIRE(out[4] == 0x11);
+        REQUIRE(out[0] == 0);
+    }
+}
+
+TEST_CASE("access windows", "[Memory]") {
+    SECTION("ranges away from devices") {
+        auto device = std::make_shared<RangedDeviceRegisters>();
+        StaticMemory<256, RangedDeviceRegisters> memory(0, device);
+
+        REQUIRE(memory.get_window(0x10, 0x20, true) ==
+                memory.get_memory() + 0x10);
+        REQUIRE(memory.get_window(0x78, 0x10, false) == nullptr);
+        REQUIRE(memory.get_window(0xf0, 0x10, false) == nullptr);
+
+        // Only ranges outside of memory are left to the device alone
+        REQUIRE(memory.get_device(0x10, 0x20) == nullptr);
+        REQUIRE(memory.get_device(0xf0, 0x20) == nullptr);
+        REQUIRE(memory.get_device(0x1000, 0x1000) == device.get());
+    }
+
+    SECTION("handlers without a range") {
+        auto device = std::make_shared<DeviceRegisters>();
+        StaticMemory<256, DeviceRegisters> memory(0, device);
+        REQUIRE(memory.get_window(0x10, 4, false) == nullptr);
+        REQUIRE(memory.get_device(0x1000, 4) == device.get());
+    }
+}
+
+TEST_CASE("pollable reads", "[Memory]") {
+    struct StatusRegister : RangedDeviceRegisters {
+        bool is_pollable(const uint32_t address) { return address == BASE; }
+    };
+
+    SECTION("devices decide for their registers") {
+        auto device = std::make_shared<StatusRegister>();
+        StaticMemory<256, StatusRegister> memory(0, device);
+
+        REQUIRE(memory.is_pollable(0x10, 4));
+        REQUIRE(memory.is_pollable(DeviceRegisters::BASE, 1));
+        REQUIRE_FALSE(memory.is_pollable(DeviceRegisters::BASE + 1, 1));
+    }
+
+    SECTION("devices without polling never are") {
+        auto device = std::make_shared<RangedDeviceRegisters>();
+        StaticMemory<256, RangedDeviceRegisters> memory(0, device);
+
+        REQUIRE(memory.is_pollable(0x10, 4));
+        REQUIRE_FALSE(memory.is_pollable(DeviceRegisters::BASE, 1));
+    }
+}
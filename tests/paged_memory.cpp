@@ -0,0 +1,530 @@
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/guest_ptr.hpp"
+#include "mips-emulator/instruction.hpp"
+#include "mips-emulator/mapped_file.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/register_file.hpp"
+#include "mips-emulator/register_name.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace mips_emulator;
+
+using IOp = Instruction::ITypeOpcode;
+
+TEST_CASE("map and access", "[PagedMemory]") {
+    PagedMemory<> memory;
+
+    SECTION("unmapped access fails") {
+        const auto read_result = memory.read<uint32_t>(0x1000);
+        REQUIRE(read_result.is_error());
+        REQUIRE(read_result.get_error() == MemoryError::out_of_bounds_access);
+
+        const auto store_result = memory.store<uint32_t>(0x1000, 1);
+        REQUIRE(store_result.is_error());
+    }
+
+    SECTION("mapped pages are zero initialized") {
+        REQUIRE_FALSE(memory.map(0x1000, 0x2000, Permission::e_rw).is_error());
+
+        REQUIRE(memory.is_mapped(0x1000, 0x2000));
+        REQUIRE_FALSE(memory.is_mapped(0x0, 0x1001));
+        REQUIRE_FALSE(memory.is_mapped(0x2000, 0x2000));
+
+        for (uint32_t address = 0x1000; address < 0x3000; address += 0x100) {
+            const auto read_result = memory.read<uint32_t>(address);
+            REQUIRE_FALSE(read_result.is_error());
+            REQUIRE(read_result.get_value() == 0);
+        }
+    }
+
+    SECTION("store then read") {
+        REQUIRE_FALSE(memory.map(0x1000, 0x1000, Permission::e_rw).is_error());
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1010, 0xdeadbeef).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1010).get_value() == 0xdeadbeef);
+        REQUIRE(memory.read<uint16_t>(0x1010).get_value() == 0xbeef);
+        REQUIRE(memory.read<uint8_t>(0x1013).get_value() == 0xde);
+    }
+
+    SECTION("unaligned access across a page boundary") {
+        REQUIRE_FALSE(memory.map(0x1000, 0x2000, Permission::e_rw).is_error());
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1ffe, 0x11223344).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1ffe).get_value() == 0x11223344);
+        REQUIRE(memory.read<uint16_t>(0x1ffe).get_value() == 0x3344);
+        REQUIRE(memory.read<uint16_t>(0x2000).get_value() == 0x1122);
+    }
+
+    SECTION("straddling access into an unmapped page fails") {
+        REQUIRE_FALSE(memory.map(0x1000, 0x1000, Permission::e_rw).is_error());
+
+        REQUIRE(memory.store<uint32_t>(0x1ffe, 0x11223344).is_error());
+        REQUIRE(memory.read<uint16_t>(0x1ffe).get_value() == 0);
+    }
+}
+
+TEST_CASE("page permissions", "[PagedMemory]") {
+    PagedMemory<> memory;
+    REQUIRE_FALSE(memory.map(0x0, 0x1000, Permission::e_rx).is_error());
+    REQUIRE_FALSE(memory.map(0x1000, 0x1000, Permission::e_rw).is_error());
+
+    SECTION("read only page rejects stores") {
+        const auto store_result = memory.store<uint32_t>(0x10, 1);
+        REQUIRE(store_result.is_error());
+        REQUIRE(store_result.get_error() == MemoryError::permission_denied);
+        REQUIRE(memory.read<uint32_t>(0x10).get_value() == 0);
+    }
+
+    SECTION("non executable page rejects fetches") {
+        REQUIRE_FALSE(memory.fetch(0x0).is_error());
+
+        const auto fetch_result = memory.fetch(0x1000);
+        REQUIRE(fetch_result.is_error());
+        REQUIRE(fetch_result.get_error() == MemoryError::permission_denied);
+    }
+
+    SECTION("protect changes permissions") {
+        REQUIRE_FALSE(memory.protect(0x0, 0x1000, Permission::e_rw).is_error());
+        REQUIRE(memory.get_permissions(0x0) == Permission::e_rw);
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x10, 7).is_error());
+        REQUIRE(memory.fetch(0x10).is_error());
+
+        REQUIRE_FALSE(memory.protect(0x0, 0x1000, Permission::e_none)
+                          .is_error());
+        REQUIRE(memory.read<uint32_t>(0x10).is_error());
+        REQUIRE(memory.read<uint32_t>(0x10).get_error() ==
+                MemoryError::permission_denied);
+
+        REQUIRE(memory.protect(0x3000, 0x1000, Permission::e_rw).is_error());
+    }
+}
+
+TEST_CASE("permission faults raise address errors", "[Executor]") {
+    PagedMemory<> memory;
+    RegisterFile reg_file;
+
+    REQUIRE_FALSE(memory.map(0x0, 0x1000, Permission::e_rx).is_error());
+    REQUIRE_FALSE(memory.map(0x1000, 0x1000, Permission::e_read).is_error());
+    REQUIRE_FALSE(memory.protect(0x0, 0x1000, Permission::e_rwx).is_error());
+
+    reg_file.set_unsigned(RegisterName::e_t0, 0x1000);
+    reg_file.set_pc(0);
+
+    SECTION("store to read only page") {
+        Instruction instr(IOp::e_sw, RegisterName::e_t1, RegisterName::e_t0,
+                          0x20);
+        REQUIRE_FALSE(memory.store<uint32_t>(0, instr.raw).is_error());
+        REQUIRE_FALSE(memory.protect(0x0, 0x1000, Permission::e_rx).is_error());
+
+        REQUIRE_FALSE(Executor::step(reg_file, memory));
+        REQUIRE(reg_file.get_cause_register() ==
+                static_cast<uint8_t>(RegisterFile::Exception::e_ad_es));
+        REQUIRE(reg_file.get_bad_instr() == instr.raw);
+        REQUIRE(reg_file.get_bad_vaddr() == 0x1020);
+    }
+
+    SECTION("load from read only page") {
+        Instruction instr(IOp::e_lw, RegisterName::e_t1, RegisterName::e_t0,
+                          0x20);
+        REQUIRE_FALSE(memory.store<uint32_t>(0, instr.raw).is_error());
+
+        REQUIRE(Executor::step(reg_file, memory));
+        REQUIRE(reg_file.get_pc() == 4);
+    }
+
+    SECTION("fetch from non executable page") {
+        reg_file.set_pc(0x1000);
+
+        REQUIRE_FALSE(Executor::step(reg_file, memory));
+        REQUIRE(reg_file.get_cause_register() ==
+                static_cast<uint8_t>(RegisterFile::Exception::e_ad_el));
+        REQUIRE(reg_file.get_bad_vaddr() == 0x1000);
+    }
+}
+
+TEST_CASE("big endian pages", "[PagedMemory]") {
+    PagedMemory<NullMMIO, false, Endian::e_big> memory;
+    REQUIRE_FALSE(memory.map(0x1000, 0x2000, Permission::e_rwx).is_error());
+
+    SECTION("word access") {
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1000, 0x11223344).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1000).get_value() == 0x11223344);
+        REQUIRE(memory.read<uint8_t>(0x1000).get_value() == 0x11);
+        REQUIRE(memory.fetch(0x1000).get_value() == 0x11223344);
+    }
+
+    SECTION("across a page boundary") {
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1ffe, 0x11223344).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1ffe).get_value() == 0x11223344);
+        REQUIRE(memory.read<uint16_t>(0x1ffe).get_value() == 0x1122);
+    }
+
+    SECTION("write words across pages") {
+        std::vector<uint32_t> words(0x500);
+        for (uint32_t i = 0; i < words.size(); ++i) words[i] = i * 0x01010101;
+
+        REQUIRE_FALSE(memory.write_words(0x1800, {words.data(), words.size()})
+                          .is_error());
+        for (uint32_t i = 0; i < words.size(); ++i) {
+            REQUIRE(memory.read<uint32_t>(0x1800 + i * 4).get_value() ==
+                    words[i]);
+        }
+
+        REQUIRE(memory.write_words(0x2800, {words.data(), words.size()})
+                    .is_error());
+    }
+}
+
+TEST_CASE("paged bulk transfers", "[PagedMemory]") {
+    PagedMemory<> memory;
+    REQUIRE_FALSE(memory.map(0x1000, 0x1000, Permission::e_rx).is_error());
+    REQUIRE_FALSE(memory.map(0x2000, 0x1000, Permission::e_rw).is_error());
+
+    std::vector<uint8_t> data(0x1800);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = i & 0xff;
+
+    SECTION("across pages and permissions") {
+        REQUIRE_FALSE(
+            memory.write_block(0x1400, {data.data(), data.size()}).is_error());
+        REQUIRE(memory.read<uint8_t>(0x1401).get_value() == 1);
+        REQUIRE(memory.read<uint8_t>(0x2bff).get_value() == 0xff);
+
+        std::vector<uint8_t> out(data.size());
+        REQUIRE_FALSE(
+            memory.read_block(0x1400, {out.data(), out.size()}).is_error());
+        REQUIRE(out == data);
+    }
+
+    SECTION("fill") {
+        REQUIRE_FALSE(memory.fill(0x1ff0, 0x20, 0xcc).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1ffe).get_value() == 0xcccccccc);
+        REQUIRE(memory.read<uint8_t>(0x2010).get_value() == 0);
+    }
+
+    SECTION("unmapped range is rejected without writing") {
+        REQUIRE(memory.write_block(0x2800, {data.data(), data.size()})
+                    .is_error());
+        REQUIRE(memory.read<uint8_t>(0x2800).get_value() == 0);
+        REQUIRE(memory.fill(0xff0, 0x20, 1).is_error());
+    }
+}
+
+TEST_CASE("map host buffer", "[PagedMemory]") {
+    PagedMemory<> memory;
+    std::vector<uint8_t> buffer(0x2000);
+    buffer[0x10] = 0x42;
+
+    SECTION("guest accesses hit the buffer in place") {
+        REQUIRE_FALSE(
+            memory.map_host(0x10000, buffer.data(), 0x2000, Permission::e_rw)
+                .is_error());
+
+        REQUIRE(memory.read<uint8_t>(0x10010).get_value() == 0x42);
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x11ffc, 0xcafef00d).is_error());
+        REQUIRE(buffer[0x1ffc] == 0x0d);
+        REQUIRE(buffer[0x1fff] == 0xca);
+
+        // Contiguous host buffers can be viewed across pages
+        REQUIRE_FALSE(memory.ptr_from_range(0x10ff0, 0x20).is_error());
+    }
+
+    SECTION("read only mapping") {
+        REQUIRE_FALSE(
+            memory.map_host(0x10000, buffer.data(), 0x2000, Permission::e_read)
+                .is_error());
+
+        REQUIRE(memory.store<uint8_t>(0x10010, 1).is_error());
+        REQUIRE(buffer[0x10] == 0x42);
+    }
+
+    SECTION("misaligned mappings are rejected") {
+        REQUIRE(memory.map_host(0x10010, buffer.data(), 0x1000,
+                                Permission::e_rw)
+                    .is_error());
+        REQUIRE(memory.map_host(0x10000, buffer.data(), 0x1800,
+                                Permission::e_rw)
+                    .is_error());
+    }
+
+    SECTION("unmap") {
+        auto owned = std::make_shared<std::vector<uint8_t>>(0x1000);
+        std::weak_ptr<std::vector<uint8_t>> weak = owned;
+
+        REQUIRE_FALSE(memory.map_host(0x10000, owned->data(), 0x1000,
+                                      Permission::e_rw, owned)
+                          .is_error());
+        owned.reset();
+        REQUIRE_FALSE(weak.expired());
+
+        REQUIRE_FALSE(memory.unmap(0x10000, 0x1000).is_error());
+        REQUIRE(weak.expired());
+        REQUIRE(memory.read<uint8_t>(0x10000).is_error());
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("map file", "[PagedMemory]") {
+    const auto path = std::filesystem::temp_directory_path() /
+                      "mips_emulator_map_file_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        const char contents[] = "mips";
+        file.write(contents, 4);
+    }
+
+    SECTION("read only") {
+        PagedMemory<> memory;
+        auto file =
+            MappedFile::open(path.c_str(), MappedFile::Mode::e_read_only);
+        REQUIRE(file != nullptr);
+
+        REQUIRE(memory.map_file(0x4000, file, Permission::e_rw).get_error() ==
+                MemoryError::permission_denied);
+        REQUIRE_FALSE(
+            memory.map_file(0x4000, file, Permission::e_read).is_error());
+
+        REQUIRE(memory.read<uint8_t>(0x4000).get_value() == 'm');
+        REQUIRE(memory.read<uint8_t>(0x4003).get_value() == 's');
+        REQUIRE(memory.read<uint8_t>(0x4004).get_value() == 0);
+        REQUIRE(memory.read<uint8_t>(0x4fff).get_value() == 0);
+        REQUIRE(memory.read<uint8_t>(0x5000).is_error());
+    }
+
+    SECTION("stores reach the file when read write") {
+        {
+            PagedMemory<> memory;
+            REQUIRE_FALSE(
+                memory
+                    .map_file(0x4000,
+                              MappedFile::open(path.c_str(),
+                                               MappedFile::Mode::e_read_write),
+                              Permission::e_rw)
+                    .is_error());
+            REQUIRE_FALSE(memory.store<uint8_t>(0x4000, 'M').is_error());
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        const std::string contents((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+        REQUIRE(contents == "Mips");
+    }
+
+    SECTION("copy on write stores stay private") {
+        {
+            PagedMemory<> memory;
+            REQUIRE_FALSE(
+                memory
+                    .map_file(0x4000,
+                              MappedFile::open(
+                                  path.c_str(),
+                                  MappedFile::Mode::e_copy_on_write),
+                              Permission::e_rw)
+                    .is_error());
+            REQUIRE_FALSE(memory.store<uint8_t>(0x4000, 'M').is_error());
+            REQUIRE(memory.read<uint8_t>(0x4000).get_value() == 'M');
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        const std::string contents((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+        REQUIRE(contents == "mips");
+    }
+
+    std::filesystem::remove(path);
+}
+#endif
+
+namespace {
+    // Fills every word of a page with its own guest address
+    class AddressPageProvider : public PageProvider {
+    public:
+        bool populate(const uint32_t page_address,
+                      Span<uint8_t> page) override {
+            ++populated;
+            if (page_address == failing_page) return false;
+
+            for (uint32_t i = 0; i < page.get_size(); i += 4) {
+                const uint32_t value = page_address + i;
+                std::memcpy(&page[i], &value, sizeof(value));
+            }
+            return true;
+        }
+
+        uint32_t populated = 0;
+        uint32_t failing_page = ~0U;
+    };
+} // namespace
+
+TEST_CASE("demand paging", "[PagedMemory]") {
+    PagedMemory<> memory;
+    auto provider = std::make_shared<AddressPageProvider>();
+
+    // 1 GiB of guest memory, only touched pages are ever allocated
+    REQUIRE_FALSE(
+        memory.map_lazy(0x40000000, 0x40000000, Permission::e_rw, provider)
+            .is_error());
+    REQUIRE(memory.is_mapped(0x40000000, 0x40000000));
+    REQUIRE(provider->populated == 0);
+
+    SECTION("first touch populates the page once") {
+        REQUIRE(memory.read<uint32_t>(0x40001010).get_value() == 0x40001010);
+        REQUIRE(memory.read<uint32_t>(0x40001020).get_value() == 0x40001020);
+        REQUIRE(provider->populated == 1);
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x7ffffffc, 1).is_error());
+        REQUIRE(memory.read<uint32_t>(0x7ffffffc).get_value() == 1);
+        REQUIRE(memory.read<uint32_t>(0x7ffffff8).get_value() == 0x7ffffff8);
+        REQUIRE(provider->populated == 2);
+    }
+
+    SECTION("host side accesses populate pages") {
+        std::vector<uint8_t> out(0x2000);
+        REQUIRE_FALSE(memory.read_block(0x40000800, {out.data(), out.size()})
+                          .is_error());
+        REQUIRE(provider->populated == 3);
+        REQUIRE(out[0] == 0x00);
+        REQUIRE(out[1] == 0x08);
+    }
+
+    SECTION("denied accesses don't populate") {
+        REQUIRE_FALSE(
+            memory.protect(0x40000000, 0x1000, Permission::e_read).is_error());
+        REQUIRE(memory.store<uint32_t>(0x40000000, 1).get_error() ==
+                MemoryError::permission_denied);
+        REQUIRE(provider->populated == 0);
+
+        REQUIRE(memory.read<uint32_t>(0x40000004).get_value() == 0x40000004);
+        REQUIRE(memory.store<uint32_t>(0x40000000, 1).is_error());
+    }
+
+    SECTION("failing provider fails the access") {
+        provider->failing_page = 0x40002000;
+        REQUIRE(memory.read<uint32_t>(0x40002000).is_error());
+        REQUIRE(memory.read<uint32_t>(0x40003000).get_value() == 0x40003000);
+    }
+
+    SECTION("the provider is released with its pages") {
+        std::weak_ptr<AddressPageProvider> weak = provider;
+        provider.reset();
+        REQUIRE(memory.read<uint32_t>(0x40000000).get_value() == 0x40000000);
+
+        REQUIRE_FALSE(memory.unmap(0x40000000, 0x40000000).is_error());
+        REQUIRE(weak.expired());
+    }
+}
+
+namespace {
+    class RecordingListener : public CodeWriteListener {
+    public:
+        void code_written(const uint32_t page_address) override {
+            pages.push_back(page_address);
+        }
+
+        std::vector<uint32_t> pages;
+    };
+} // namespace
+
+TEST_CASE("code page write protection", "[PagedMemory]") {
+    PagedMemory<> memory;
+    RecordingListener listener;
+    memory.set_code_write_listener(&listener);
+    REQUIRE_FALSE(memory.map(0x1000, 0x3000, Permission::e_rwx).is_error());
+
+    REQUIRE(memory.protect_code(0x5000).is_error());
+    REQUIRE_FALSE(memory.protect_code(0x1abc).is_error());
+    REQUIRE(memory.is_code(0x1000));
+    REQUIRE_FALSE(memory.is_code(0x2000));
+
+    SECTION("data stores don't notify") {
+        REQUIRE_FALSE(memory.store<uint32_t>(0x2000, 1).is_error());
+        REQUIRE(memory.read<uint32_t>(0x1000).get_value() == 0);
+        REQUIRE(memory.fetch(0x1000).get_value() == 0);
+        REQUIRE(listener.pages.empty());
+    }
+
+    SECTION("the first store to code notifies") {
+        REQUIRE_FALSE(memory.store<uint16_t>(0x1002, 0xabcd).is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000});
+        REQUIRE_FALSE(memory.is_code(0x1000));
+        REQUIRE(memory.read<uint16_t>(0x1002).get_value() == 0xabcd);
+
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1004, 1).is_error());
+        REQUIRE(listener.pages.size() == 1);
+    }
+
+    SECTION("stores straddling into code notify") {
+        REQUIRE_FALSE(memory.protect_code(0x2000).is_error());
+        REQUIRE_FALSE(memory.store<uint32_t>(0x1ffe, 0x12345678).is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000, 0x2000});
+    }
+
+    SECTION("denied stores keep the protection") {
+        REQUIRE_FALSE(
+            memory.protect(0x1000, 0x1000, Permission::e_rx).is_error());
+        REQUIRE(memory.store<uint32_t>(0x1000, 1).get_error() ==
+                MemoryError::permission_denied);
+        REQUIRE(memory.is_code(0x1000));
+        REQUIRE(listener.pages.empty());
+    }
+
+    SECTION("host side writes and unmapping notify") {
+        const uint32_t word = 0x24020001;
+        REQUIRE_FALSE(memory.write_words(0x1ff0, {&word, 1}).is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000});
+
+        REQUIRE_FALSE(memory.protect_code(0x3000).is_error());
+        REQUIRE_FALSE(memory.unmap(0x2000, 0x2000).is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000, 0x3000});
+    }
+
+    SECTION("guest pointers notify") {
+        const auto ptr = guest_ptr<uint32_t>(memory, 0x1ffc);
+        REQUIRE_FALSE(ptr.is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000});
+        REQUIRE_FALSE(memory.is_code(0x1000));
+        ptr.get_value().store(0x24020001);
+        REQUIRE(memory.fetch(0x1ffc).get_value() == 0x24020001);
+
+        REQUIRE_FALSE(memory.protect_code(0x2000).is_error());
+        REQUIRE_FALSE(guest_span<uint32_t>(memory, 0x2000, 4).is_error());
+        REQUIRE(listener.pages == std::vector<uint32_t>{0x1000, 0x2000});
+    }
+}
+
+TEST_CASE("page access windows", "[PagedMemory]") {
+    PagedMemory<> memory;
+    REQUIRE_FALSE(memory.map(0x1000, 0x2000, Permission::e_rw).is_error());
+    REQUIRE_FALSE(memory.map(0x3000, 0x1000, Permission::e_rx).is_error());
+    REQUIRE_FALSE(memory.store<uint32_t>(0x1ff8, 0x12345678).is_error());
+
+    uint8_t* window = memory.get_window(0x1ff0, 0x10, true);
+    REQUIRE(window != nullptr);
+    std::memcpy(window, "\x01\x00\x00\x00", 4);
+    REQUIRE(memory.read<uint32_t>(0x1ff0).get_value() == 1);
+    REQUIRE(std::memcmp(window + 8, "\x78\x56\x34\x12", 4) == 0);
+
+    // Pages are windowed one at a time
+    REQUIRE(memory.get_window(0x1ff0, 0x14, false) == nullptr);
+    REQUIRE(memory.get_window(0x1000, 0, false) == nullptr);
+    REQUIRE(memory.get_window(0x5000, 4, false) == nullptr);
+
+    // Lazy pages are left to the slow path until populated
+    REQUIRE(memory.get_window(0x3000, 4, false) == nullptr);
+    REQUIRE_FALSE(memory.read<uint32_t>(0x3000).is_error());
+    REQUIRE(memory.get_window(0x3000, 4, false) != nullptr);
+    REQUIRE(memory.get_window(0x3000, 4, true) == nullptr);
+
+    // Code pages have to notify on stores
+    REQUIRE_FALSE(memory.protect_code(0x1000).is_error());
+    REQUIRE(memory.get_window(0x1000, 4, false) != nullptr);
+    REQUIRE(memory.get_window(0x1000, 4, true) == nullptr);
+}
@@ -0,0 +1,75 @@
+#include "recompiler_fixture.hpp"
+
+#include "mips-emulator/recompiled_cache.hpp"
+#include "mips-emulator/register_file.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <random>
+
+using namespace mips_emulator;
+
+TEST_CASE("recompiled library cache", "[RecompiledCache]") {
+    using Memory = RecompilerFixture::Memory;
+
+    // Characters the shell would expand or end quotes at
+    const auto directory =
+        std::filesystem::temp_directory_path() /
+        ("mips_emulator_cache_$HOME`'\"_" +
+         std::to_string(std::random_device()()));
+    std::filesystem::create_directories(directory);
+
+    const auto make_cache = [&directory]() {
+        return RecompiledCache<Memory>(directory.string(),
+                                       "mips_emulator::StaticMemory<0x2000>",
+                                       "mips-emulator/static_memory.hpp");
+    };
+    const auto run = [](const RecompiledLibrary<Memory>& library,
+                        Memory& memory) {
+        RegisterFile reg_file;
+        reg_file.set_pc(RecompilerFixture::ORIGIN);
+        REQUIRE(library.run(reg_file, memory, 200));
+        return reg_file.get(RegisterName::e_v0).u;
+    };
+
+    Memory memory;
+    Assembler::LabelMap labels;
+    REQUIRE(RecompilerFixture::load(memory, labels));
+    const uint32_t entry = RecompilerFixture::ORIGIN;
+
+    // The first run builds the library
+    auto cache = make_cache();
+    const uint64_t key = cache.get_key(memory, {&entry, 1});
+    RecompiledLibrary<Memory> library;
+    const auto first = cache.load(library, memory, {&entry, 1});
+    REQUIRE_FALSE(first.is_error());
+    REQUIRE_FALSE(first.get_value());
+    REQUIRE(std::filesystem::exists(cache.get_path(key)));
+    REQUIRE(run(library, memory) == 165);
+
+    // Later runs open it as is
+    Memory restarted;
+    Assembler::LabelMap restarted_labels;
+    REQUIRE(RecompilerFixture::load(restarted, restarted_labels));
+    auto restarted_cache = make_cache();
+    RecompiledLibrary<Memory> restarted_library;
+    const auto second =
+        restarted_cache.load(restarted_library, restarted, {&entry, 1});
+    REQUIRE_FALSE(second.is_error());
+    REQUIRE(second.get_value());
+    REQUIRE(run(restarted_library, restarted) == 165);
+
+    // Different text gets a library of its own, li $a0, 5
+    REQUIRE_FALSE(restarted.store<uint32_t>(entry, 0x24040005).is_error());
+    REQUIRE(restarted_cache.get_key(restarted, {&entry, 1}) != key);
+    const auto third =
+        restarted_cache.load(restarted_library, restarted, {&entry, 1});
+    REQUIRE_FALSE(third.is_error());
+    REQUIRE_FALSE(third.get_value());
+    REQUIRE(run(restarted_library, restarted) == 45);
+
+    library.close();
+    restarted_library.close();
+    std::filesystem::remove_all(directory);
+}
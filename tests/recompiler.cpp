@@ -0,0 +1,296 @@
+#include "recompiler_fixture.hpp"
+
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/executor.hpp"
+#include "mips-emulator/recompiled.hpp"
+#include "mips-emulator/recompiler.hpp"
+#include "mips-emulator/register_file.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace mips_emulator;
+
+using FixtureMemory = RecompilerFixture::Memory;
+
+// Generated from the fixture at build time and linked into the tests
+extern "C" const RecompiledModule<FixtureMemory>*
+mips_emulator_recompiled_module();
+
+namespace {
+    using Reg = RegisterName;
+
+    uint32_t find_label(const Assembler::LabelMap& labels,
+                        const std::string_view name) {
+        uint32_t address = 0;
+        REQUIRE(labels.find(name, address));
+        return address;
+    }
+
+    // Name of the kind of function the recompiler emits for the block at
+    // label, e.g. idle_00001048
+    std::string function_name(const Assembler::LabelMap& labels,
+                              const std::string_view kind,
+                              const std::string_view label) {
+        char address[16];
+        std::snprintf(address, sizeof(address), "_%08x",
+                      find_label(labels, label));
+        return std::string(kind) + address;
+    }
+} // namespace
+
+TEST_CASE("emit recompiled source", "[Recompiler]") {
+    FixtureMemory memory;
+    Assembler::LabelMap labels;
+    REQUIRE(RecompilerFixture::load(memory, labels));
+
+    ControlFlowGraph cfg;
+    const uint32_t entry = RecompilerFixture::ORIGIN;
+    cfg.recover(memory, {&entry, 1});
+
+    std::ostringstream out;
+    REQUIRE_FALSE(Recompiler::emit(out, cfg, memory, "Memory", "memory.hpp")
+                      .is_error());
+    const std::string source = out.str();
+
+    // One function per block, the indirect call target isn't known
+    for (const auto& [start, block] : cfg.get_blocks()) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "uint32_t block_%08x(", start);
+        REQUIRE(source.find(name) != std::string::npos);
+    }
+    char triple[32];
+    std::snprintf(triple, sizeof(triple), "block_%08x",
+                  find_label(labels, "triple"));
+    REQUIRE(source.find(triple) == std::string::npos);
+
+    // The PC is only set ahead of the branch
+    REQUIRE(source.find("            // lw $t0, 0($a1)\n"
+                        "            if (!execute<0x8ca80000>(reg_file, "
+                        "memory)) return 1;") != std::string::npos);
+    REQUIRE(source.find("        reg_file.set_pc(0x00001024);\n"
+                        "        // jalr $t9\n"
+                        "        if (!step<0x0320f809>(reg_file, memory)) "
+                        "return 3;") != std::string::npos);
+
+    // Accesses off $a1 are checked once
+    REQUIRE(source.find("        if (uint8_t* host = Recompiled::window("
+                        "memory, reg_file.get(5).u, 0, 8, true, 4)) {\n"
+                        "            // lw $t0, 0($a1)\n"
+                        "            access<0x8ca80000, Memory>(reg_file, "
+                        "host + 0);\n"
+                        "            // sw $a0, 4($a1)\n"
+                        "            access<0xaca40004, Memory>(reg_file, "
+                        "host + 4);\n") != std::string::npos);
+
+    // Only the polling loops are idle
+    REQUIRE(source.find("bool " + function_name(labels, "idle", "wait") +
+                        "(const RegisterFile& reg_file, Memory& memory) {\n"
+                        "        return poll<0x8c0a1804>(reg_file, memory);\n"
+                        "    }\n") != std::string::npos);
+    REQUIRE(source.find("bool " + function_name(labels, "idle", "done") +
+                        "(const RegisterFile&, Memory&) {\n"
+                        "        return true;\n"
+                        "    }\n") != std::string::npos);
+    REQUIRE(source.find(function_name(labels, "idle", "sum")) ==
+            std::string::npos);
+
+    // fill and sum run their iterations natively, fill's store through a
+    // window stepping with $t3
+    REQUIRE(source.find(function_name(labels, "loop", "fill")) !=
+            std::string::npos);
+    REQUIRE(source.find("        uint8_t* host0 = stride_window(memory, "
+                        "reg_file.get(11).u, 0, 4, 4, true, count);\n") !=
+            std::string::npos);
+    REQUIRE(source.find("            access<0xad6b0000, Memory>(reg_file, "
+                        "host0);\n"
+                        "            host0 += 4;\n") != std::string::npos);
+    REQUIRE(source.find(function_name(labels, "loop", "sum")) !=
+            std::string::npos);
+    REQUIRE(source.find(function_name(labels, "loop", "wait")) ==
+            std::string::npos);
+
+    REQUIRE(source.find("mips_emulator_recompiled_module()") !=
+            std::string::npos);
+}
+
+TEST_CASE("run a recompiled module", "[Recompiler]") {
+    FixtureMemory memory;
+    Assembler::LabelMap labels;
+    REQUIRE(RecompilerFixture::load(memory, labels));
+    const uint32_t done = find_label(labels, "done");
+    const uint32_t triple = find_label(labels, "triple");
+
+    RecompiledLibrary<FixtureMemory> library;
+    REQUIRE_FALSE(library.attach(*mips_emulator_recompiled_module())
+                      .is_error());
+    REQUIRE_FALSE(library.verify(memory).is_error());
+    REQUIRE(library.lookup(RecompilerFixture::ORIGIN) != nullptr);
+    REQUIRE(library.lookup(triple) == nullptr);
+
+    RegisterFile reg_file;
+    reg_file.set_pc(RecompilerFixture::ORIGIN);
+    REQUIRE(library.run(reg_file, memory, 1000));
+    REQUIRE(reg_file.get_pc() == done);
+
+    // Same state as the interpreter
+    FixtureMemory expected_memory;
+    Assembler::LabelMap expected_labels;
+    REQUIRE(RecompilerFixture::load(expected_memory, expected_labels));
+    RegisterFile expected;
+    expected.set_pc(RecompilerFixture::ORIGIN);
+    while (expected.get_pc() != done) {
+        REQUIRE(Executor::step(expected, expected_memory));
+    }
+
+    REQUIRE(reg_file.get(Reg::e_v0).u == 165);
+    for (uint8_t i = 0; i < 32; ++i) {
+        REQUIRE(reg_file.get(i).u == expected.get(i).u);
+    }
+    REQUIRE(memory.read<uint32_t>(0x1800).get_value() == 165);
+    for (uint32_t address = 0x1900; address < 0x1a00; address += 4) {
+        REQUIRE(memory.read<uint32_t>(address).get_value() == address);
+    }
+}
+
+TEST_CASE("idle loops end the run", "[Recompiler]") {
+    FixtureMemory memory;
+    Assembler::LabelMap labels;
+    REQUIRE(RecompilerFixture::load(memory, labels));
+    REQUIRE_FALSE(memory.store<uint32_t>(0x1804, 1).is_error());
+
+    RecompiledLibrary<FixtureMemory> library;
+    REQUIRE_FALSE(library.attach(*mips_emulator_recompiled_module())
+                      .is_error());
+
+    RegisterFile reg_file;
+    reg_file.set_pc(RecompilerFixture::ORIGIN);
+    REQUIRE(library.run(reg_file, memory, UINT64_MAX));
+    REQUIRE(reg_file.get_pc() == find_label(labels, "wait"));
+    REQUIRE(library.is_idle(reg_file, memory));
+    REQUIRE(reg_file.get(Reg::e_t2).u == 1);
+
+    // Released by the host between runs
+    REQUIRE_FALSE(memory.store<uint32_t>(0x1804, 0).is_error());
+    REQUIRE(library.run(reg_file, memory, UINT64_MAX));
+    REQUIRE(reg_file.get_pc() == find_label(labels, "done"));
+    REQUIRE(library.is_idle(reg_file, memory));
+    REQUIRE(reg_file.get(Reg::e_v0).u == 165);
+
+    reg_file.set_pc(find_label(labels, "sum"));
+    REQUIRE_FALSE(library.is_idle(reg_file, memory));
+}
+
+TEST_CASE("counted loop bounds", "[Recompiler]") {
+    // The iteration leaving the loop is left to the block
+    REQUIRE(Recompiled::iterations(10, 0, -1, true, UINT64_MAX) == 9);
+    REQUIRE(Recompiled::iterations(0x1900, 0x1a00, 4, true, UINT64_MAX) ==
+            63);
+    REQUIRE(Recompiled::iterations(0, 3, 1, false, UINT64_MAX) == 3);
+    REQUIRE(Recompiled::iterations(0x1900, 0x1a00, 4, true, 10) == 10);
+    REQUIRE(Recompiled::iterations(1, 0, -1, true, UINT64_MAX) == 0);
+    // Never reaches the bound
+    REQUIRE(Recompiled::iterations(0, 10, 4, true, UINT64_MAX) == 0);
+    // Reaches it once it wraps around, like the guest counter
+    REQUIRE(Recompiled::iterations(10, 0, 1, true, 1000) == 1000);
+    REQUIRE(Recompiled::iterations(10, 0, 1, true, UINT64_MAX) ==
+            0xfffffff5);
+    REQUIRE(Recompiled::iterations(0xfffffffe, 2, 1, false, UINT64_MAX) ==
+            4);
+
+    // Windows end with the page of the first access, accesses outside of
+    // memory have none
+    FixtureMemory memory;
+    uint64_t count = 10;
+    REQUIRE(Recompiled::stride_window(memory, 0x0fe0, 0x10, 4, 4, true,
+                                      count) == memory.get_memory() + 0x0ff0);
+    REQUIRE(count == 4);
+    count = 10;
+    REQUIRE(Recompiled::stride_window(memory, 0x1010, 0, -4, 4, true,
+                                      count) == memory.get_memory() + 0x1010);
+    REQUIRE(count == 5);
+    count = 10;
+    REQUIRE(Recompiled::stride_window(memory, 0x2000, 0, 4, 4, false,
+                                      count) == nullptr);
+}
+
+TEST_CASE("reject mismatched modules", "[Recompiler]") {
+    FixtureMemory memory;
+    Assembler::LabelMap labels;
+    REQUIRE(RecompilerFixture::load(memory, labels));
+
+    RecompiledLibrary<FixtureMemory> library;
+    REQUIRE(library.verify(memory).get_error() ==
+            RecompiledError::missing_module);
+    REQUIRE(library.open("missing-recompiled-library.so").get_error() ==
+            RecompiledError::open_failed);
+
+    // The text changed since it was recompiled
+    REQUIRE_FALSE(library.attach(*mips_emulator_recompiled_module())
+                      .is_error());
+    REQUIRE_FALSE(
+        memory.store<uint32_t>(RecompilerFixture::ORIGIN, 0).is_error());
+    REQUIRE(library.verify(memory).get_error() ==
+            RecompiledError::key_mismatch);
+
+    RecompiledModule<FixtureMemory> module = *mips_emulator_recompiled_module();
+    module.version = 0;
+    REQUIRE(library.attach(module).get_error() ==
+            RecompiledError::version_mismatch);
+    module.version = Recompiled::VERSION;
+    module.memory_type = "other";
+    REQUIRE(library.attach(module).get_error() ==
+            RecompiledError::memory_mismatch);
+}
+
+TEST_CASE("faults in recompiled blocks are precise", "[Recompiler]") {
+    RecompiledLibrary<FixtureMemory> library;
+    REQUIRE_FALSE(library.attach(*mips_emulator_recompiled_module())
+                      .is_error());
+
+    // Runs until the first fault with the interpreter and the library
+    const auto compare = [&](const Reg reg) {
+        FixtureMemory memory;
+        FixtureMemory expected_memory;
+        Assembler::LabelMap labels;
+        Assembler::LabelMap expected_labels;
+        REQUIRE(RecompilerFixture::load(memory, labels));
+        REQUIRE(RecompilerFixture::load(expected_memory, expected_labels));
+
+        RegisterFile reg_file;
+        reg_file.set_pc(RecompilerFixture::ORIGIN);
+        reg_file.set_unsigned(reg, 0x10000);
+        RegisterFile expected = reg_file;
+
+        REQUIRE_FALSE(library.run(reg_file, memory, 200));
+        while (Executor::step(expected, expected_memory)) {
+        }
+
+        REQUIRE(reg_file.get_pc() == expected.get_pc());
+        REQUIRE(reg_file.has_delayed_branch() ==
+                expected.has_delayed_branch());
+        REQUIRE(reg_file.get_bad_instr() == expected.get_bad_instr());
+        REQUIRE(reg_file.get_bad_vaddr() == 0x10000);
+        REQUIRE(reg_file.get_cause_register() ==
+                expected.get_cause_register());
+        for (uint8_t i = 0; i < 32; ++i) {
+            REQUIRE(reg_file.get(i).u == expected.get(i).u);
+        }
+        return reg_file.get_pc();
+    };
+
+    SECTION("deferred PC") {
+        REQUIRE(compare(Reg::e_a1) == RecompilerFixture::ORIGIN + 8);
+    }
+
+    SECTION("delay slot") {
+        Assembler::LabelMap labels;
+        FixtureMemory memory;
+        REQUIRE(RecompilerFixture::load(memory, labels));
+        REQUIRE(compare(Reg::e_a2) == find_label(labels, "triple"));
+    }
+}
@@ -0,0 +1,33 @@
+#include "recompiler_fixture.hpp"
+
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/recompiler.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+using namespace mips_emulator;
+
+// Recompiles the fixture program for the recompiled library tests
+int main(int argc, char** argv) {
+    if (argc != 2) return EXIT_FAILURE;
+
+    RecompilerFixture::Memory memory;
+    Assembler::LabelMap labels;
+    if (!RecompilerFixture::load(memory, labels)) return EXIT_FAILURE;
+
+    ControlFlowGraph cfg;
+    const uint32_t entry = RecompilerFixture::ORIGIN;
+    cfg.recover(memory, {&entry, 1});
+
+    std::ofstream stream(argv[1]);
+    const auto result = Recompiler::emit(stream, cfg, memory,
+                                         "mips_emulator::StaticMemory<0x2000>",
+                                         "mips-emulator/static_memory.hpp");
+    if (result.is_error() || !stream.flush()) {
+        std::fprintf(stderr, "failed to write %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/static_memory.hpp"
+
+#include <string_view>
+
+namespace mips_emulator::RecompilerFixture {
+    using Memory = StaticMemory<0x2000>;
+
+    constexpr uint32_t ORIGIN = 0x1000;
+
+    // triple is only reached through jalr, so it's left to the interpreter.
+    // The accesses fault when $a1 or $a2 point outside of memory, the ones
+    // off $a1 share a window. fill and sum are counted loops, wait spins
+    // while the host holds 0x1804 set.
+    constexpr std::string_view SOURCE = R"(
+        main:   addiu $a0, $zero, 10
+                lw    $t0, 0($a1)
+                sw    $a0, 4($a1)
+                addiu $v0, $zero, 0
+                jal   sum
+                nop
+                move  $s0, $v0
+                lui   $t9, %hi(triple)
+                addiu $t9, $t9, %lo(triple)
+                jalr  $t9
+                lw    $t1, 0($a2)
+                sw    $v0, 0x1800($zero)
+                addiu $t3, $zero, 0x1900
+                addiu $t4, $zero, 0x1a00
+        fill:   sw    $t3, 0($t3)
+                addiu $t3, $t3, 4
+                bne   $t3, $t4, fill
+                nop
+        wait:   lw    $t2, 0x1804($zero)
+                bnezc $t2, wait
+        done:   bc    done
+        sum:    addu  $v0, $v0, $a0
+                addiu $a0, $a0, -1
+                bnezc $a0, sum
+                jr    $ra
+                nop
+        triple: addu  $v1, $s0, $s0
+                addu  $v0, $v1, $s0
+                jr    $ra
+                nop
+    )";
+
+    // Clears memory first, the loads read outside of the text
+    inline bool load(Memory& memory, Assembler::LabelMap& labels) {
+        return !memory.fill(0, memory.get_size(), 0).is_error() &&
+               !Assembler::assemble_into(memory, SOURCE, ORIGIN, labels)
+                    .is_error();
+    }
+} // namespace mips_emulator::RecompilerFixture
@@ -0,0 +1,382 @@
+#include "mips-emulator/assembler.hpp"
+#include "mips-emulator/emulator.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/static_memory.hpp"
+#include "mips-emulator/translation_cache.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace mips_emulator;
+
+namespace {
+    using TestMemory = StaticMemory<0x4000>;
+
+    constexpr uint32_t ORIGIN = 0x1000;
+
+    // Sums a0 down to 1 into v0
+    constexpr std::string_view KERNEL = R"(
+        main:   addiu $v0, $zero, 0
+        loop:   addu  $v0, $v0, $a0
+                addiu $a0, $a0, -1
+                bnezc $a0, loop
+        done:   bc    done
+    )";
+
+    // Clears memory so that the rest of the page is identical everywhere
+    void load(TestMemory& memory, const std::string_view source) {
+        REQUIRE_FALSE(memory.fill(0, memory.get_size(), 0).is_error());
+        Assembler::LabelMap labels;
+        REQUIRE_FALSE(Assembler::assemble_into(memory, source, ORIGIN, labels)
+                          .is_error());
+    }
+} // namespace
+
+TEST_CASE("share decoded pages", "[TranslationCache]") {
+    TranslationCache cache;
+    TestMemory first;
+    TestMemory second;
+    TestMemory other;
+    load(first, KERNEL);
+    load(second, KERNEL);
+    load(other, "nop");
+
+    const DecodedPage* page = cache.translate(first, ORIGIN);
+    REQUIRE(page != nullptr);
+    REQUIRE(page->address == ORIGIN);
+    REQUIRE(page->instructions[3].is_branch());
+    REQUIRE(page->instructions[3].target == ORIGIN + 4);
+
+    // Identical text shares the page, other text at the same address doesn't
+    REQUIRE(cache.translate(second, ORIGIN) == page);
+    REQUIRE(cache.translate(other, ORIGIN) != page);
+    REQUIRE(cache.get_size() == 2);
+
+    // Even when its hash collides with the page's
+    std::array<uint32_t, DecodedPage::WORDS> text = {};
+    for (uint32_t i = 0; i < DecodedPage::WORDS; ++i) {
+        text[i] = page->instructions[i].raw;
+    }
+    REQUIRE(cache.find(ORIGIN, page->key, {text.data(), text.size()}) ==
+            page);
+    text[0] ^= 1;
+    REQUIRE(cache.find(ORIGIN, page->key, {text.data(), text.size()}) ==
+            nullptr);
+
+    // Pages that aren't entirely inside of memory aren't translated
+    REQUIRE(cache.translate(first, 0x3800) == nullptr);
+
+    TranslationCache small(1);
+    REQUIRE(small.translate(first, ORIGIN) != nullptr);
+    REQUIRE(small.translate(other, ORIGIN) == nullptr);
+}
+
+TEST_CASE("emulators share a translation cache", "[TranslationCache]") {
+    constexpr uint32_t INSTANCES = 8;
+    auto cache = std::make_shared<TranslationCache>();
+
+    std::vector<std::unique_ptr<Emulator<TestMemory>>> emulators;
+    for (uint32_t i = 0; i < INSTANCES; ++i) {
+        auto emulator = std::make_unique<Emulator<TestMemory>>();
+        load(emulator->get_memory(), KERNEL);
+        emulator->share_translations(cache);
+
+        RegisterFile& reg_file = emulator->get_register_file();
+        reg_file.set_pc(ORIGIN);
+        reg_file.set_unsigned(RegisterName::e_a0, 100 + i);
+        emulators.push_back(std::move(emulator));
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<char> ok(INSTANCES, false);
+    for (uint32_t i = 0; i < INSTANCES; ++i) {
+        threads.emplace_back([&, i]() {
+            Emulator<TestMemory>& emulator = *emulators[i];
+            ok[i] = true;
+            while (emulator.get_register_file().get_pc() != ORIGIN + 16) {
+                if (!emulator.step()) {
+                    ok[i] = false;
+                    break;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    for (uint32_t i = 0; i < INSTANCES; ++i) {
+        REQUIRE(ok[i]);
+        const uint32_t n = 100 + i;
+        REQUIRE(emulators[i]->get_register_file().get(RegisterName::e_v0).u ==
+                n * (n + 1) / 2);
+    }
+
+    // Decoded once for all of them
+    REQUIRE(cache->get_size() == 1);
+}
+
+TEST_CASE("self modifying code drops translations", "[TranslationCache]") {
+    // Patches the addiu at patch to add 2 instead of 1, then runs it again
+    constexpr std::string_view PATCHING = R"(
+        main:   addiu $v0, $zero, 0
+        patch:  addiu $v0, $v0, 1
+                bnezc $t0, done
+                lui   $t2, %hi(patch)
+                lw    $t3, %lo(patch)($t2)
+                addiu $t3, $t3, 1
+                sw    $t3, %lo(patch)($t2)
+                addiu $t0, $zero, 1
+                bc    patch
+        done:   bc    done
+    )";
+
+    auto cache = std::make_shared<TranslationCache>();
+    Emulator<PagedMemory<>> emulator;
+    PagedMemory<>& memory = emulator.get_memory();
+    REQUIRE_FALSE(memory.map(ORIGIN, 0x1000, Permission::e_rwx).is_error());
+    Assembler::LabelMap labels;
+    REQUIRE_FALSE(Assembler::assemble_into(memory, PATCHING, ORIGIN, labels)
+                      .is_error());
+    uint32_t done = 0;
+    REQUIRE(labels.find("done", done));
+
+    emulator.share_translations(cache);
+    emulator.get_register_file().set_pc(ORIGIN);
+    REQUIRE(emulator.step());
+    REQUIRE(memory.is_code(ORIGIN));
+
+    while (emulator.get_register_file().get_pc() != done) {
+        REQUIRE(emulator.step());
+    }
+
+    // The first pass added 1, the patched one 2
+    REQUIRE(emulator.get_register_file().get(RegisterName::e_v0).u == 3);
+    REQUIRE(cache->get_size() == 2);
+    REQUIRE(memory.is_code(ORIGIN));
+}
+
+TEST_CASE("explicit invalidation", "[TranslationCache]") {
+    // Same patch, made visible with the given instructions before jumping
+    // back to the patched addiu
+    const auto run = [](const std::string_view sync) {
+        const std::string source = std::string(R"(
+            main:   addiu $v0, $zero, 0
+            patch:  addiu $v0, $v0, 1
+                    bnezc $t0, done
+                    lui   $t2, %hi(patch)
+                    lw    $t3, %lo(patch)($t2)
+                    addiu $t3, $t3, 1
+                    sw    $t3, %lo(patch)($t2)
+                    addiu $t0, $zero, 1
+                    addiu $t4, $t2, %lo(patch)
+        )") + std::string(sync) + R"(
+            done:   bc    done
+        )";
+
+        auto cache = std::make_shared<TranslationCache>();
+        Emulator<PagedMemory<>> emulator;
+        PagedMemory<>& memory = emulator.get_memory();
+        REQUIRE_FALSE(
+            memory.map(ORIGIN, 0x1000, Permission::e_rwx).is_error());
+        Assembler::LabelMap labels;
+        REQUIRE_FALSE(Assembler::assemble_into(memory, source, ORIGIN, labels)
+                          .is_error());
+        uint32_t done = 0;
+        REQUIRE(labels.find("done", done));
+
+        emulator.share_translations(cache, InvalidationMode::e_explicit);
+        emulator.get_register_file().set_pc(ORIGIN);
+        while (emulator.get_register_file().get_pc() != done) {
+            REQUIRE(emulator.step());
+        }
+
+        // Stores never have to check for code
+        REQUIRE_FALSE(memory.is_code(ORIGIN));
+        return emulator.get_register_file().get(RegisterName::e_v0).u;
+    };
+
+    SECTION("synci") {
+        REQUIRE(run(R"(
+                    synci %lo(patch)($t2)
+                    jr    $t4
+                    nop
+        )") == 3);
+    }
+
+    SECTION("cache") {
+        REQUIRE(run(R"(
+                    cache 0x10, 0($t4)
+                    jr    $t4
+                    nop
+        )") == 3);
+    }
+
+    SECTION("hazard barrier") {
+        REQUIRE(run(R"(
+                    jr.hb $t4
+                    nop
+        )") == 3);
+    }
+
+    SECTION("stale without the protocol") {
+        REQUIRE(run(R"(
+                    jr    $t4
+                    nop
+        )") == 2);
+    }
+}
+
+namespace {
+    // Counter read at BASE, below which pages are mapped
+    struct Counter {
+        static constexpr uint32_t BASE = 0x8000;
+
+        uint32_t value = 0;
+
+        template <typename T>
+        std::optional<T> read(const uint32_t address) {
+            if (address != BASE) return std::nullopt;
+            return static_cast<T>(++value);
+        }
+
+        template <typename T>
+        bool store(const uint32_t, const T) {
+            return false;
+        }
+    };
+
+    // Counts the accesses that go through the generic read and store
+    struct ProbedMemory : PagedMemory<Counter> {
+        using PagedMemory::PagedMemory;
+
+        uint32_t probes = 0;
+
+        template <typename T>
+        Result<T, MemoryError> read(const uint32_t address) {
+            ++probes;
+            return PagedMemory::read<T>(address);
+        }
+
+        template <typename T>
+        Result<void, MemoryError> store(const uint32_t address, const T value) {
+            ++probes;
+            return PagedMemory::store<T>(address, value);
+        }
+    };
+} // namespace
+
+TEST_CASE("generated code is bounded in the cache", "[TranslationCache]") {
+    // Patches the addiu at patch 19 times, each one made visible by SYNCI
+    constexpr std::string_view GENERATING = R"(
+        main:   addiu $v0, $zero, 0
+                addiu $t0, $zero, 20
+                lui   $t2, %hi(patch)
+                addiu $t4, $t2, %lo(patch)
+        patch:  addiu $v0, $v0, 1
+                addiu $t0, $t0, -1
+                beqzc $t0, done
+                lw    $t3, 0($t4)
+                addiu $t3, $t3, 1
+                sw    $t3, 0($t4)
+                synci 0($t4)
+                bc    patch
+        done:   bc    done
+    )";
+
+    auto cache = std::make_shared<TranslationCache>();
+    Emulator<PagedMemory<>> emulator;
+    PagedMemory<>& memory = emulator.get_memory();
+    REQUIRE_FALSE(memory.map(ORIGIN, 0x1000, Permission::e_rwx).is_error());
+    Assembler::LabelMap labels;
+    REQUIRE_FALSE(Assembler::assemble_into(memory, GENERATING, ORIGIN, labels)
+                      .is_error());
+    uint32_t done = 0;
+    REQUIRE(labels.find("done", done));
+
+    emulator.share_translations(cache, InvalidationMode::e_explicit);
+    emulator.get_register_file().set_pc(ORIGIN);
+    while (emulator.get_register_file().get_pc() != done) {
+        REQUIRE(emulator.step());
+    }
+
+    // 1 + 2 + ... + 20, the page is left to the interpreter once it was
+    // retranslated MAX_INVALIDATIONS times
+    REQUIRE(emulator.get_register_file().get(RegisterName::e_v0).u == 210);
+    REQUIRE(cache->get_size() == TranslationMap::MAX_INVALIDATIONS + 1);
+}
+
+TEST_CASE("loads and stores cache their page", "[TranslationCache]") {
+    constexpr std::string_view POLLING = R"(
+        main:   ori   $a1, $zero, 0x4000
+                ori   $a2, $zero, 0x8000
+        store:  sw    $a0, 0($a1)
+                lw    $t0, 0($a1)
+                addu  $v0, $v0, $t0
+        poll:   lw    $t1, 0($a2)
+                addu  $v1, $v1, $t1
+                addiu $a0, $a0, -1
+                bnezc $a0, store
+        done:   bc    done
+    )";
+
+    auto counter = std::make_shared<Counter>();
+    ProbedMemory memory(counter);
+    REQUIRE_FALSE(memory.map(ORIGIN, 0x1000, Permission::e_rx).is_error());
+    REQUIRE_FALSE(memory.map(0x4000, 0x1000, Permission::e_rw).is_error());
+    Assembler::LabelMap labels;
+    REQUIRE_FALSE(Assembler::assemble_into(memory, POLLING, ORIGIN, labels)
+                      .is_error());
+    uint32_t store = 0;
+    uint32_t poll = 0;
+    uint32_t done = 0;
+    REQUIRE(labels.find("store", store));
+    REQUIRE(labels.find("poll", poll));
+    REQUIRE(labels.find("done", done));
+
+    TranslationMap map(std::make_shared<TranslationCache>());
+    RegisterFile reg_file;
+    reg_file.set_pc(ORIGIN);
+    reg_file.set_unsigned(RegisterName::e_a0, 3);
+    while (reg_file.get_pc() != done) {
+        REQUIRE(Executor::step(reg_file, memory, map));
+    }
+    REQUIRE(reg_file.get(RegisterName::e_v0).u == 6);
+    REQUIRE(reg_file.get(RegisterName::e_v1).u == 6);
+    REQUIRE(counter->value == 3);
+    // Only the first store, which populates the page
+    REQUIRE(memory.probes == 1);
+
+    // RAM sites hold their page, the device site holds the handler
+    const auto site = [&](const uint32_t address) -> AccessSite& {
+        REQUIRE(map.lookup(memory, address) != nullptr);
+        return map.get_site(address);
+    };
+    REQUIRE(site(store).host != nullptr);
+    REQUIRE(site(store).tag ==
+            AccessSite::get_tag(0x4000, memory.get_generation()));
+    REQUIRE(site(store + 4).host != nullptr);
+    REQUIRE(site(poll).host == nullptr);
+    REQUIRE(site(poll).device == counter.get());
+    REQUIRE(site(poll).tag ==
+            AccessSite::get_tag(Counter::BASE, memory.get_generation()));
+
+    // Registers the device declines fault like they do through read
+    reg_file.set_pc(poll);
+    reg_file.set_unsigned(RegisterName::e_a2, Counter::BASE + 4);
+    REQUIRE_FALSE(Executor::step(reg_file, memory, map));
+    REQUIRE(reg_file.get_bad_vaddr() == Counter::BASE + 4);
+    REQUIRE(memory.probes == 1);
+
+    // Permission changes reach cached sites
+    REQUIRE_FALSE(memory.protect(0x4000, 0x1000, Permission::e_read)
+                      .is_error());
+    reg_file.set_pc(store);
+    REQUIRE_FALSE(Executor::step(reg_file, memory, map));
+    REQUIRE(reg_file.get_bad_vaddr() == 0x4000);
+}
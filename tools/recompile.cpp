@@ -0,0 +1,90 @@
+#include "mips-emulator/cfg.hpp"
+#include "mips-emulator/elf_loader.hpp"
+#include "mips-emulator/paged_memory.hpp"
+#include "mips-emulator/recompiler.hpp"
+#include "mips-emulator/register_file.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace mips_emulator;
+
+// Recompiles the code reachable from the entry point of an ELF executable,
+// and from any extra addresses such as function symbols, to C++. The output
+// builds into a library that RecompiledLibrary loads, see
+// mips_emulator_add_recompiled_library in tools/CMakeLists.txt.
+//
+// Usage: mips_emulator_recompile <input.elf> <output.cpp> [address...]
+
+namespace {
+    template <Endian endian>
+    int recompile(const std::vector<uint8_t>& file, const char* output,
+                  std::vector<uint32_t>& entries, const char* memory_type) {
+        PagedMemory<NullMMIO, false, endian> memory;
+        RegisterFile reg_file;
+        const auto load_result =
+            ElfLoader::load(memory, reg_file, {file.data(), file.size()});
+        if (load_result.is_error()) {
+            std::fprintf(stderr, "failed to load the executable\n");
+            return EXIT_FAILURE;
+        }
+        entries.insert(entries.begin(), load_result.get_value());
+
+        ControlFlowGraph cfg;
+        cfg.recover(memory, {entries.data(), entries.size()});
+        std::printf("%zu blocks, %zu functions, %zu unresolved sites\n",
+                    cfg.get_blocks().size(), cfg.get_functions().size(),
+                    cfg.get_indirect_sites().size());
+
+        std::ofstream stream(output);
+        const auto emit_result =
+            Recompiler::emit(stream, cfg, memory, memory_type,
+                             "mips-emulator/paged_memory.hpp");
+        if (emit_result.is_error() || !stream.flush()) {
+            std::fprintf(stderr, "failed to write %s\n", output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <input.elf> <output.cpp> "
+                             "[address...]\n",
+                     argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream stream(argv[1], std::ios::binary);
+    if (!stream) {
+        std::fprintf(stderr, "failed to open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    const std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)),
+                                    std::istreambuf_iterator<char>());
+
+    std::vector<uint32_t> entries;
+    for (int i = 3; i < argc; ++i) {
+        entries.push_back(std::strtoul(argv[i], nullptr, 0));
+    }
+
+    ElfImage image;
+    if (ElfLoader::parse({file.data(), file.size()}, image).is_error()) {
+        std::fprintf(stderr, "%s is not a MIPS executable\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (image.endian == Endian::e_big) {
+        return recompile<Endian::e_big>(
+            file, argv[2], entries,
+            "mips_emulator::PagedMemory<mips_emulator::NullMMIO, false, "
+            "mips_emulator::Endian::e_big>");
+    }
+    return recompile<Endian::e_little>(file, argv[2], entries,
+                                       "mips_emulator::PagedMemory<>");
+}